@@ -0,0 +1,134 @@
+/*
+  Channel lookups as every send does them (name to id, then the count
+  for the cursor), on a bus the size of a small, a mid-sized and a
+  large interface.
+
+  "scan" is the std::map<int, Channel> Channels used to be, walked and
+  compared name by name.  "index" is Channels as it is now.  The names
+  looked up are drawn at random from the bus, with one in eight not on
+  it (a selection control whose channel the mixer has not named yet).
+
+  usage: channels [lookups per run]
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "channel.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static volatile int Sink;
+
+// ====================================================================
+// What Channels did before the index
+// ====================================================================
+struct ScanChannels
+{
+   std::map<int, Channel> channels;
+
+   void SetChannelName(int id, const std::string & name)
+   {
+      channels[id].SetName(name);
+   }
+
+   int GetChannelID(const std::string & name)
+   {
+      std::map<int, Channel>::iterator iter;
+      for (iter = channels.begin(); iter != channels.end(); iter++)
+      {
+         if (iter->second.GetName() == name)
+         {
+            return iter->first;
+         }
+      }
+      return -1;
+   }
+
+   int GetCount()
+   {
+      return channels.size();
+   }
+};
+
+static std::string
+Name(int id)
+{
+   // Like TotalMix's: a few words, a number at the end
+   static const char *Kinds[] = { "Mic", "Line", "SPDIF", "ADAT", "AN", "AES", "Phones" };
+
+   return std::string(Kinds[id % 7]) + " " + std::to_string(id);
+}
+
+template<typename T>
+static double
+Run(T & chans, const std::vector<std::string> & names, const std::vector<int> & order)
+{
+   Clock::time_point start = Clock::now();
+   int sum = 0;
+   for (size_t i = 0; i < order.size(); i++)
+   {
+      sum += chans.GetChannelID(names[order[i]]) + chans.GetCount();
+   }
+   Sink = sum;
+
+   return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / order.size();
+}
+
+int
+main(int argc, char **argv)
+{
+   int lookups = argc > 1 ? atoi(argv[1]) : 2000000;
+   static const int Sizes[] = { 30, 64, 196 };
+
+   printf("%-8s %12s %12s %8s\n", "channels", "scan ns", "index ns", "speedup");
+   for (size_t s = 0; s < sizeof(Sizes) / sizeof(Sizes[0]); s++)
+   {
+      int count = Sizes[s];
+
+      ScanChannels scan;
+      Channels index;
+      std::vector<std::string> names;
+      for (int id = 1; id <= count; id++)
+      {
+         names.push_back(Name(id));
+         scan.SetChannelName(id, names.back());
+         index.SetChannelName(id, names.back().c_str());
+      }
+
+      // One in eight is not on the bus
+      int missing = count / 7;
+      for (int i = 0; i < missing; i++)
+      {
+         names.push_back(Name(count + 1 + i));
+      }
+
+      std::vector<int> order(lookups);
+      srand(1);
+      for (int i = 0; i < lookups; i++)
+      {
+         order[i] = rand() % names.size();
+      }
+
+      // Both have to agree before the times mean anything
+      for (size_t i = 0; i < names.size(); i++)
+      {
+         if (scan.GetChannelID(names[i]) != index.GetChannelID(names[i]))
+         {
+            printf("mismatch on %s\n", names[i].c_str());
+            return 1;
+         }
+      }
+
+      double scanNs = Run(scan, names, order);
+      double indexNs = Run(index, names, order);
+
+      printf("%-8d %12.1f %12.1f %7.1fx\n", count, scanNs, indexNs, scanNs / indexNs);
+   }
+
+   return 0;
+}
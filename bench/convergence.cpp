@@ -0,0 +1,232 @@
+/*
+  How long Tuba takes to get the mixer where the user put it, and to
+  know it has, when the network between them loses, duplicates,
+  reorders, delays or rate limits datagrams.
+
+  A Mixer drives a TotalMixSim through an ImpairProxy, all on loopback.
+  Each trial moves every control to a random value and then runs frames
+  (16 ms apart, as the view does) until both the simulator holds the new
+  values ("applied") and the Mixer's state agrees with the simulator
+  ("converged"), or the timeout passes.  Trials that time out are left
+  out of the times; "agree" is how many of them ended with the Mixer's
+  state at least matching the simulator's, which is all the refresh can
+  do for a write that never arrived.
+
+  usage: convergence [trials per scenario] [timeout ms]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mixer.h"
+#include "proxy.h"
+#include "simulator.h"
+#include "stats.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Scenario
+{
+   const char *name;
+   Impairment up;
+   Impairment down;
+};
+
+// The faders a trial moves, two on page 1, the rest on page 2
+static const struct
+{
+   int page;
+   int bus;
+   const char *name;
+   const char *param;
+}
+Faders[] =
+{
+   { 1, BUS_OUTPUT, "Main",      "volume"  },
+   { 1, BUS_INPUT,  "Mic 1",     "volume"  },
+   { 2, BUS_INPUT,  "SPDIF",     "gain"    },
+   { 2, BUS_OUTPUT, "Speaker B", "eqGain1" },
+   { 2, BUS_OUTPUT, "Main",      "eqGain2" },
+};
+
+#define FADERS ((int) (sizeof(Faders) / sizeof(Faders[0])))
+
+static std::vector<Scenario>
+Scenarios()
+{
+   std::vector<Scenario> list;
+   Scenario s;
+
+   s = Scenario(); s.name = "clean";                                       list.push_back(s);
+   s = Scenario(); s.name = "loss 5% up";    s.up.loss = 0.05;             list.push_back(s);
+   s = Scenario(); s.name = "loss 5% down";  s.down.loss = 0.05;           list.push_back(s);
+   s = Scenario(); s.name = "loss 5% both";  s.up.loss = s.down.loss = 0.05; list.push_back(s);
+   s = Scenario(); s.name = "dup 20%";       s.up.duplicate = s.down.duplicate = 0.2; list.push_back(s);
+   s = Scenario(); s.name = "reorder 20%";   s.up.reorder = s.down.reorder = 0.2; list.push_back(s);
+   s = Scenario(); s.name = "delay 20+20ms"; s.up.delayMs = s.down.delayMs = 10.0;
+                                             s.up.jitterMs = s.down.jitterMs = 20.0; list.push_back(s);
+   s = Scenario(); s.name = "rate 50/s";     s.up.rate = s.down.rate = 50.0; list.push_back(s);
+
+   return list;
+}
+
+static void
+Frame(Mixer & mixer)
+{
+   mixer.Frame(false);
+   std::this_thread::sleep_for(std::chrono::milliseconds(16));
+}
+
+// ====================================================================
+// Every fader's value on the simulator, and whether the Mixer's state
+// has the same
+// ====================================================================
+static bool
+Compare(Mixer & mixer, TotalMixSim & sim, const std::vector<int> & ctrls, const float *target, bool & agree)
+{
+   bool applied = true;
+   agree = true;
+
+   for (int i = 0; i < FADERS; i++)
+   {
+      const Binding & b = mixer.GetBinding(ctrls[i]);
+      float value;
+      if (!sim.GetValue(b.bus, b.channel, b.paramId, value))
+      {
+         return agree = false;
+      }
+      applied = applied && fabs(value - target[i]) < 1e-4;
+
+      const MixerState::Entry *e = mixer.GetState().Get(b.bus, b.channel, b.paramId);
+      agree = agree && e != NULL && fabs(e->value - value) < 1e-4;
+   }
+
+   return applied;
+}
+
+static void
+Run(const Scenario & scenario, int trials, int timeoutMs, unsigned int seed)
+{
+   TotalMixSim sim;
+   for (int b = 0; b < BUS_COUNT; b++)
+   {
+      sim.SetChannels(b, TotalMixSim::Generate(b, 32));
+   }
+   sim.SetLatency(1.0, 1.0);
+   sim.SetSeed(seed);
+
+   ImpairProxy proxy;
+   proxy.SetSeed(seed);
+   proxy.SetImpairment(ImpairProxy::UP, scenario.up);
+   proxy.SetImpairment(ImpairProxy::DOWN, scenario.down);
+
+   Mixer mixer;
+   std::vector<int> ctrls;
+   for (int i = 0; i < FADERS; i++)
+   {
+      ctrls.push_back(mixer.AddControl(Faders[i].page, Faders[i].bus, Faders[i].name, Faders[i].param));
+      mixer.Watch(ctrls.back());
+   }
+   mixer.SetRequestWindow(4);
+   mixer.SetRefreshIntervals(2000, 250, 50);
+   mixer.SetSendRate(100.0, 4);
+
+   if (!sim.Start(0) || !proxy.Start(0, "127.0.0.1", sim.GetPort()) ||
+       !mixer.Start(0, "127.0.0.1", proxy.GetPort()))
+   {
+      fprintf(stderr, "%s: unable to start: %s%s%s\n", scenario.name,
+              sim.GetError().c_str(), proxy.GetError().c_str(), mixer.GetError().c_str());
+      exit(1);
+   }
+
+   Clock::time_point start = Clock::now();
+   while (!mixer.IsReady() && Clock::now() - start < std::chrono::milliseconds(timeoutMs))
+   {
+      Frame(mixer);
+   }
+   if (!mixer.IsReady())
+   {
+      printf("%-14s never ready\n", scenario.name);
+      return;
+   }
+   double ready = Ms(Clock::now() - start);
+
+   std::vector<double> applied;
+   std::vector<double> converged;
+   int agreed = 0;
+   srand(seed);
+
+   for (int t = 0; t < trials; t++)
+   {
+      float target[FADERS];
+      for (int i = 0; i < FADERS; i++)
+      {
+         target[i] = (rand() % 1000 + 1) / 1001.0f;
+         mixer.SendFader(ctrls[i], target[i]);
+      }
+
+      bool done = false;
+      bool agree = false;
+      bool reached = false;
+      Clock::time_point sent = Clock::now();
+      while (!done && Clock::now() - sent < std::chrono::milliseconds(timeoutMs))
+      {
+         Frame(mixer);
+
+         bool now = Compare(mixer, sim, ctrls, target, agree);
+         if (now && !reached)
+         {
+            reached = true;
+            applied.push_back(Ms(Clock::now() - sent));
+         }
+         if (now && agree)
+         {
+            done = true;
+            converged.push_back(Ms(Clock::now() - sent));
+         }
+      }
+
+      if (!done && agree)
+      {
+         agreed++;
+      }
+   }
+
+   ImpairProxy::Counters up = proxy.GetCounters(ImpairProxy::UP);
+   ImpairProxy::Counters down = proxy.GetCounters(ImpairProxy::DOWN);
+
+   printf("%-14s %6.0f %5zu/%-3d %7.0f %7.0f %5zu/%-3d %7.0f %7.0f %7.0f %5d %6lu %6lu\n", scenario.name, ready,
+          applied.size(), trials, Percentile(applied, 0.5), Percentile(applied, 0.95),
+          converged.size(), trials, Percentile(converged, 0.5), Percentile(converged, 0.95),
+          converged.empty() ? 0.0 : *std::max_element(converged.begin(), converged.end()),
+          agreed, up.lost + up.limited, down.lost + down.limited);
+
+   mixer.Stop();
+   proxy.Stop();
+   sim.Stop();
+}
+
+int
+main(int argc, char **argv)
+{
+   int trials = argc > 1 ? atoi(argv[1]) : 20;
+   int timeoutMs = argc > 2 ? atoi(argv[2]) : 3000;
+
+   printf("%d trials of %d faders per scenario, %d ms timeout, times in ms\n\n", trials, FADERS, timeoutMs);
+   printf("%-14s %6s %9s %7s %7s %9s %7s %7s %7s %5s %6s %6s\n", "scenario", "ready",
+          "applied", "p50", "p95", "converged", "p50", "p95", "max", "agree", "up-", "down-");
+
+   std::vector<Scenario> scenarios = Scenarios();
+   for (size_t i = 0; i < scenarios.size(); i++)
+   {
+      Run(scenarios[i], trials, timeoutMs, 1 + (unsigned int) i);
+   }
+
+   return 0;
+}
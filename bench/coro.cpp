@@ -0,0 +1,193 @@
+/*
+  Cost of writing an exchange as a coroutine (AsyncSocket, coro.h)
+  instead of a hand written EventLoop callback.
+
+  A client sends a small packet to an echo socket and waits for the
+  answer, over and over, on one EventLoop thread. The callback client
+  sends the next packet from its receive handler; the coroutine client
+  is a loop of co_await sendTo() / co_await recv(). Runs alternate and
+  the best of each is kept, so the difference is the coroutine overhead
+  per round trip rather than noise from the loopback.
+
+  The dispatch rows take the kernel out: a std::function call per
+  "packet" against resuming a coroutine suspended on an awaiter.
+
+  usage: coro [round trips per run] [runs]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+#include "oscpkt.h"
+#include "udp.h"
+#include "eventloop.h"
+#include "coro.h"
+
+using namespace oscpkt;
+
+typedef std::chrono::steady_clock Clock;
+
+static double
+Seconds(Clock::time_point start)
+{
+   return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// ====================================================================
+// Loopback round trips
+// ====================================================================
+struct Echo
+{
+   EventLoop loop;
+   UdpSocket echo;
+   UdpSocket client;
+   SockAddr dest;
+   PacketWriter pw;
+
+   Echo()
+   :  loop(16, 2048)
+   {
+      echo.bindTo(0);
+      client.bindTo(0);
+      dest = echo.local_addr;
+      ((struct sockaddr_in *)&dest.addr())->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      loop.add(echo, [](UdpSocket & s, PacketSlot & ps) { s.sendPacketTo(ps.data, ps.size, ps.addr); });
+
+      Message msg("/2/trackname");
+      msg.pushStr("Mic 1");
+      pw.addMessage(msg);
+   }
+};
+
+static double
+RunCallbacks(size_t trips)
+{
+   Echo e;
+   size_t done = 0;
+   e.loop.add(e.client, [&](UdpSocket &, PacketSlot &)
+   {
+      if (++done < trips)
+      {
+         e.client.sendPacketTo(e.pw.packetData(), e.pw.packetSize(), e.dest);
+      }
+      else
+      {
+         e.loop.stop();
+      }
+   });
+
+   Clock::time_point start = Clock::now();
+   e.client.sendPacketTo(e.pw.packetData(), e.pw.packetSize(), e.dest);
+   e.loop.run();
+   return Seconds(start) / trips;
+}
+
+static Task<void>
+PingPong(Echo & e, AsyncSocket & as, size_t trips)
+{
+   for (size_t i = 0; i < trips; i++)
+   {
+      co_await as.sendTo(e.pw, e.dest);
+      if (!co_await as.recv(1000))
+      {
+         break;
+      }
+   }
+   e.loop.stop();
+}
+
+static double
+RunCoroutine(size_t trips)
+{
+   Echo e;
+   AsyncSocket as(e.loop, e.client);
+
+   Clock::time_point start = Clock::now();
+   spawn(PingPong(e, as, trips));
+   e.loop.run();
+   return Seconds(start) / trips;
+}
+
+// ====================================================================
+// Dispatch only
+// ====================================================================
+struct Resumer
+{
+   std::coroutine_handle<> waiter;
+
+   bool await_ready() { return false; }
+   void await_suspend(std::coroutine_handle<> h) { waiter = h; }
+   void await_resume() {}
+};
+
+static Task<void>
+Consumer(Resumer & r, size_t & count)
+{
+   for (;;)
+   {
+      co_await r;
+      count++;
+   }
+}
+
+static double
+DispatchCallbacks(size_t n)
+{
+   size_t count = 0;
+   std::function<void (PacketSlot &)> handler = [&count](PacketSlot &) { count++; };
+   PacketSlot ps;
+
+   Clock::time_point start = Clock::now();
+   for (size_t i = 0; i < n; i++)
+   {
+      handler(ps);
+   }
+   double t = Seconds(start) / n;
+   return count == n ? t : 0.0;
+}
+
+static double
+DispatchCoroutine(size_t n)
+{
+   size_t count = 0;
+   Resumer r;
+   Task<void> task = Consumer(r, count);
+   spawn(std::move(task));
+
+   Clock::time_point start = Clock::now();
+   for (size_t i = 0; i < n; i++)
+   {
+      r.waiter.resume();
+   }
+   double t = Seconds(start) / n;
+   // The consumer never returns, its frame is leaked on purpose
+   return count == n ? t : 0.0;
+}
+
+int
+main(int argc, char **argv)
+{
+   size_t trips = argc > 1 ? (size_t) atol(argv[1]) : 100000;
+   int runs = argc > 2 ? atoi(argv[2]) : 5;
+
+   double cb = 1e9, co = 1e9, dcb = 1e9, dco = 1e9;
+   for (int i = 0; i < runs; i++)
+   {
+      cb = std::min(cb, RunCallbacks(trips));
+      co = std::min(co, RunCoroutine(trips));
+      dcb = std::min(dcb, DispatchCallbacks(trips * 100));
+      dco = std::min(dco, DispatchCoroutine(trips * 100));
+   }
+
+   printf("%-22s %12s\n", "", "ns/trip");
+   printf("%-22s %12.1f\n", "round trip callbacks", cb * 1e9);
+   printf("%-22s %12.1f\n", "round trip coroutine", co * 1e9);
+   printf("%-22s %12.1f\n", "  overhead", (co - cb) * 1e9);
+   printf("%-22s %12.2f\n", "dispatch callbacks", dcb * 1e9);
+   printf("%-22s %12.2f\n", "dispatch coroutine", dco * 1e9);
+
+   return 0;
+}
@@ -0,0 +1,453 @@
+/*
+  End to end latency of what the view sends: faders (SendFader, page 1
+  and page 2), toggles (SendToggle) and channel selections
+  (SendSelect), through a Mixer to a TotalMixSim on loopback.
+
+  The datagrams pass an ImpairProxy with nothing impaired, whose tap
+  timestamps them on the wire.  Changes are made one at a time, at a
+  random point between two frames (as the view's events come), and for
+  each one the bench records:
+
+    wire   change to the first datagram it caused on the wire
+    echo   change to the mixer's echo of it being applied to the
+           Mixer's state (none for page 1, the mixer does not echo it)
+
+  along with the datagrams and bytes each way until then.  "sustained"
+  keeps one change in flight on every page 2 fader, the next one made
+  as soon as the echo of the last is in, and counts the changes the
+  mixer confirmed per second.
+
+  Prints JSON, for keeping alongside the commit it was run at.
+
+  usage: fader_latency [changes per kind] [frame ms] [sustained seconds]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mixer.h"
+#include "proxy.h"
+#include "simulator.h"
+#include "stats.h"
+
+typedef std::chrono::steady_clock Clock;
+
+enum
+{
+   KIND_FADER1,
+   KIND_FADER2,
+   KIND_TOGGLE,
+   KIND_SELECT,
+
+   KINDS
+};
+
+static const char *KindNames[] = { "fader_page1", "fader_page2", "toggle", "select" };
+
+// The controls, several per kind so that changes move between channels
+// and buses as they would in use
+static const struct
+{
+   int kind;
+   int page;
+   int bus;
+   const char *name;
+   const char *param;
+}
+Controls[] =
+{
+   { KIND_FADER1, 1, BUS_OUTPUT, "Main",      "volume"   },
+   { KIND_FADER1, 1, BUS_OUTPUT, "Speaker B", "volume"   },
+   { KIND_FADER1, 1, BUS_INPUT,  "Mic 1",     "volume"   },
+   { KIND_FADER2, 2, BUS_INPUT,  "SPDIF",     "gain"     },
+   { KIND_FADER2, 2, BUS_OUTPUT, "Speaker B", "eqGain1"  },
+   { KIND_FADER2, 2, BUS_OUTPUT, "Main",      "eqGain2"  },
+   { KIND_FADER2, 2, BUS_INPUT,  "Mic 2",     "volume"   },
+   { KIND_TOGGLE, 2, BUS_OUTPUT, "Main",      "eqEnable" },
+   { KIND_TOGGLE, 2, BUS_INPUT,  "Mic 1",     "eqEnable" },
+   { KIND_SELECT, 2, BUS_OUTPUT, "Main",      ""         },
+   { KIND_SELECT, 2, BUS_OUTPUT, "Speaker B", ""         },
+   { KIND_SELECT, 2, BUS_INPUT,  "SPDIF",     ""         },
+   { KIND_SELECT, 2, BUS_INPUT,  "Mic 2",     ""         },
+};
+
+#define CONTROLS ((int) (sizeof(Controls) / sizeof(Controls[0])))
+
+// A datagram as the tap saw it
+struct Wire
+{
+   Clock::time_point when;
+   int direction;
+   size_t size;
+};
+
+struct Results
+{
+   std::vector<double> wire;
+   std::vector<double> echo;
+   unsigned long packets[ImpairProxy::DIRECTIONS];
+   unsigned long bytes[ImpairProxy::DIRECTIONS];
+   int changes;
+   int timeouts;
+};
+
+static std::mutex WireLock;
+static std::vector<Wire> Wires;
+
+// What the echo listener is waiting for
+static struct
+{
+   int bus;
+   int channel;
+   int param;                    // -1 for any burst of the channel, a selection
+   float value;
+   bool seen;
+   Clock::time_point when;
+}
+Expect;
+
+static const double SendRate = 100.0;
+
+static Clock::duration FrameTime;
+static Clock::time_point NextFrame;
+
+// ====================================================================
+// Wait for the frame boundary and run a frame
+// ====================================================================
+static void
+Tick(Mixer & mixer)
+{
+   std::this_thread::sleep_until(NextFrame);
+   mixer.Frame(false);
+
+   NextFrame += FrameTime;
+   if (NextFrame < Clock::now())
+   {
+      NextFrame = Clock::now();
+   }
+}
+
+static void
+OnEcho(int bus, int channel, const ParamValues & values)
+{
+   if (Expect.seen || bus != Expect.bus || channel != Expect.channel)
+   {
+      return;
+   }
+
+   if (Expect.param >= 0 && (!values.Has(Expect.param) || values.value[Expect.param] != Expect.value))
+   {
+      return;
+   }
+
+   Expect.seen = true;
+   Expect.when = Clock::now();
+}
+
+static float
+Target(float old)
+{
+   float value;
+   do
+   {
+      value = (rand() % 1000 + 1) / 1001.0f;
+   }
+   while (value == old);
+
+   return value;
+}
+
+// ====================================================================
+// One change of ctrl, made between two frames, followed until its echo
+// ====================================================================
+static void
+Change(Mixer & mixer, TotalMixSim & sim, int ctrl, Results & r)
+{
+   const Binding & b = mixer.GetBinding(ctrl);
+   int kind = Controls[ctrl].kind;
+
+   float old = 0.0f;
+   sim.GetValue(b.bus, b.channel, b.paramId, old);
+
+   Expect.bus = b.bus;
+   Expect.channel = b.channel;
+   Expect.param = b.paramId;
+   Expect.seen = false;
+
+   if (FrameTime.count() > 0)
+   {
+      std::this_thread::sleep_for(FrameTime * (rand() % 1000) / 1000);
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(WireLock);
+      Wires.clear();
+   }
+
+   Clock::time_point start = Clock::now();
+   switch (kind)
+   {
+      case KIND_FADER1:
+      case KIND_FADER2:
+         Expect.value = Target(old);
+         mixer.SendFader(ctrl, Expect.value);
+      break;
+
+      case KIND_TOGGLE:
+         Expect.value = old >= 0.5f ? 0.0f : 1.0f;
+         mixer.SendToggle(ctrl);
+      break;
+
+      case KIND_SELECT:
+         mixer.SendSelect(b.bus, b.name);
+      break;
+   }
+
+   // Page 1 is not echoed, two frames after it went out is as done as
+   // it gets
+   int after = -1;
+   Clock::time_point limit = start + std::chrono::seconds(1);
+   while (!Expect.seen && after != 0 && Clock::now() < limit)
+   {
+      Tick(mixer);
+
+      if (kind == KIND_FADER1)
+      {
+         std::lock_guard<std::mutex> lock(WireLock);
+         after = after < 0 && !Wires.empty() ? 2 : after > 0 ? after - 1 : after;
+      }
+   }
+
+   std::lock_guard<std::mutex> lock(WireLock);
+
+   r.changes++;
+   if (kind == KIND_FADER1 ? after != 0 : !Expect.seen)
+   {
+      r.timeouts++;
+      return;
+   }
+
+   bool first = true;
+   for (size_t i = 0; i < Wires.size(); i++)
+   {
+      if (first && Wires[i].direction == ImpairProxy::UP)
+      {
+         r.wire.push_back(Ms(Wires[i].when - start));
+         first = false;
+      }
+      r.packets[Wires[i].direction]++;
+      r.bytes[Wires[i].direction] += Wires[i].size;
+   }
+
+   if (Expect.seen)
+   {
+      r.echo.push_back(Ms(Expect.when - start));
+   }
+}
+
+static void
+PrintLatency(const char *name, const std::vector<double> & v, bool last)
+{
+   if (v.empty())
+   {
+      printf("      \"%s\": null%s\n", name, last ? "" : ",");
+      return;
+   }
+
+   double sum = 0.0;
+   for (size_t i = 0; i < v.size(); i++)
+   {
+      sum += v[i];
+   }
+
+   printf("      \"%s\": { \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f }%s\n",
+          name, sum / v.size(), Percentile(v, 0.5), Percentile(v, 0.9), Percentile(v, 0.99),
+          *std::max_element(v.begin(), v.end()), last ? "" : ",");
+}
+
+static void
+PrintResults(const char *name, const Results & r)
+{
+   int n = r.changes - r.timeouts;
+   printf("    \"%s\": {\n", name);
+   printf("      \"changes\": %d,\n", r.changes);
+   printf("      \"timeouts\": %d,\n", r.timeouts);
+   printf("      \"packets_per_change\": %.2f,\n", n ? (double) r.packets[ImpairProxy::UP] / n : 0.0);
+   printf("      \"bytes_per_change\": %.1f,\n", n ? (double) r.bytes[ImpairProxy::UP] / n : 0.0);
+   printf("      \"reply_packets_per_change\": %.2f,\n", n ? (double) r.packets[ImpairProxy::DOWN] / n : 0.0);
+   printf("      \"reply_bytes_per_change\": %.1f,\n", n ? (double) r.bytes[ImpairProxy::DOWN] / n : 0.0);
+   PrintLatency("wire_ms", r.wire, false);
+   PrintLatency("echo_ms", r.echo, true);
+   printf("    },\n");
+}
+
+int
+main(int argc, char **argv)
+{
+   int changes = argc > 1 ? atoi(argv[1]) : 100;
+   int frameMs = argc > 2 ? atoi(argv[2]) : 16;
+   double seconds = argc > 3 ? atof(argv[3]) : 3.0;
+
+   FrameTime = std::chrono::milliseconds(frameMs);
+
+   TotalMixSim sim;
+   for (int b = 0; b < BUS_COUNT; b++)
+   {
+      sim.SetChannels(b, TotalMixSim::Generate(b, 32));
+   }
+
+   ImpairProxy proxy;
+   proxy.SetTap([](int direction, const char *, size_t size)
+   {
+      Wire w;
+      w.when = Clock::now();
+      w.direction = direction;
+      w.size = size;
+
+      std::lock_guard<std::mutex> lock(WireLock);
+      Wires.push_back(w);
+   });
+
+   // Nothing watched, so that the refresh stays off the wire
+   Mixer mixer;
+   for (int i = 0; i < CONTROLS; i++)
+   {
+      mixer.AddControl(Controls[i].page, Controls[i].bus, Controls[i].name, Controls[i].param);
+   }
+   mixer.SetEchoListener(OnEcho);
+   mixer.SetRequestWindow(4);
+   mixer.SetSendRate(SendRate, 4);
+
+   if (!sim.Start(0) || !proxy.Start(0, "127.0.0.1", sim.GetPort()) ||
+       !mixer.Start(0, "127.0.0.1", proxy.GetPort()))
+   {
+      fprintf(stderr, "unable to start: %s%s%s\n", sim.GetError().c_str(), proxy.GetError().c_str(), mixer.GetError().c_str());
+      return 1;
+   }
+
+   NextFrame = Clock::now();
+   Clock::time_point limit = NextFrame + std::chrono::seconds(5);
+   while (!mixer.IsReady() && Clock::now() < limit)
+   {
+      Tick(mixer);
+   }
+   if (!mixer.IsReady())
+   {
+      fprintf(stderr, "the mixer never answered\n");
+      return 1;
+   }
+
+   Results results[KINDS];
+   for (int k = 0; k < KINDS; k++)
+   {
+      results[k] = Results();
+      for (int i = 0, c = 0; i < changes; c = (c + 1) % CONTROLS)
+      {
+         if (Controls[c].kind == k)
+         {
+            Change(mixer, sim, c, results[k]);
+            i++;
+         }
+      }
+   }
+
+   // One change in flight per page 2 fader
+   std::vector<int> faders;
+   for (int i = 0; i < CONTROLS; i++)
+   {
+      if (Controls[i].kind == KIND_FADER2)
+      {
+         faders.push_back(i);
+      }
+   }
+   std::vector<float> pending(faders.size(), -1.0f);
+   std::vector<bool> echoed(faders.size(), false);
+
+   mixer.SetEchoListener([&](int bus, int channel, const ParamValues & values)
+   {
+      for (size_t f = 0; f < faders.size(); f++)
+      {
+         const Binding & b = mixer.GetBinding(faders[f]);
+         if (b.bus == bus && b.channel == channel && values.Has(b.paramId) && values.value[b.paramId] == pending[f])
+         {
+            echoed[f] = true;
+         }
+      }
+   });
+
+   {
+      std::lock_guard<std::mutex> lock(WireLock);
+      Wires.clear();
+   }
+
+   unsigned long confirmed = 0;
+   Clock::time_point start = Clock::now();
+   Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+   while (Clock::now() < end)
+   {
+      for (size_t f = 0; f < faders.size(); f++)
+      {
+         if (pending[f] >= 0.0f && !echoed[f])
+         {
+            continue;
+         }
+
+         if (echoed[f])
+         {
+            confirmed++;
+         }
+         pending[f] = Target(pending[f]);
+         echoed[f] = false;
+         mixer.SendFader(faders[f], pending[f]);
+      }
+
+      Tick(mixer);
+   }
+   double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+   unsigned long packets = 0;
+   unsigned long bytes = 0;
+   {
+      std::lock_guard<std::mutex> lock(WireLock);
+      for (size_t i = 0; i < Wires.size(); i++)
+      {
+         if (Wires[i].direction == ImpairProxy::UP)
+         {
+            packets++;
+            bytes += Wires[i].size;
+         }
+      }
+   }
+
+   mixer.Stop();
+   proxy.Stop();
+   sim.Stop();
+
+   printf("{\n");
+   printf("  \"bench\": \"fader_latency\",\n");
+   printf("  \"frame_ms\": %d,\n", frameMs);
+   printf("  \"send_rate\": %.0f,\n", SendRate);
+   printf("  \"results\": {\n");
+   for (int k = 0; k < KINDS; k++)
+   {
+      PrintResults(KindNames[k], results[k]);
+   }
+   printf("    \"sustained\": {\n");
+   printf("      \"seconds\": %.3f,\n", elapsed);
+   printf("      \"faders\": %zu,\n", faders.size());
+   printf("      \"changes\": %lu,\n", confirmed);
+   printf("      \"changes_per_second\": %.1f,\n", confirmed / elapsed);
+   printf("      \"packets_per_second\": %.1f,\n", packets / elapsed);
+   printf("      \"bytes_per_second\": %.1f\n", bytes / elapsed);
+   printf("    }\n");
+   printf("  }\n");
+   printf("}\n");
+
+   return 0;
+}
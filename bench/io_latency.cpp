@@ -0,0 +1,263 @@
+/*
+  Input-to-wire latency of fader packets, with the network work done on
+  the UI thread (as MyFrame::OnSocket used to) or on an IoThread.
+
+  A fake mixer floods the app with level meter packets and timestamps
+  every fader packet it receives. A fake input device produces fader
+  moves at random times. The UI thread handles them between "repaints",
+  which either cost nothing or keep the thread busy for a while.
+
+  usage: io_latency [seconds per run] [repaint ms]
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "oscpkt.h"
+#include "udp.h"
+#include "spscring.h"
+#include "iothread.h"
+
+using namespace oscpkt;
+
+typedef std::chrono::steady_clock Clock;
+
+static int64_t
+Now()
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static SockAddr
+Loopback(const UdpSocket & sock)
+{
+   SockAddr addr = sock.local_addr;
+   ((struct sockaddr_in *)&addr.addr())->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   return addr;
+}
+
+// ====================================================================
+// Receives the fader packets and sends meter bursts back every ms
+// ====================================================================
+struct FakeMixer
+{
+   UdpSocket sock;
+   SockAddr app;
+   std::atomic<bool> running;
+   std::vector<int64_t> latencies;
+   int burst;
+
+   void Run()
+   {
+      std::vector<char> buffers(64 * 2048);
+      std::vector<PacketSlot> slots;
+      for (size_t i = 0; i < 64; i++)
+      {
+         slots.push_back(PacketSlot(&buffers[i * 2048], 2048));
+      }
+
+      // What the mixer sends the most: level meters the app does not use
+      PacketWriter meters;
+      Message msg;
+      float levels[16] = { 0 };
+      meters.startBundle();
+      for (int i = 0; i < 4; i++)
+      {
+         msg.init("/1/levelInput").pushFloats(levels, 16);
+         meters.addMessage(msg);
+      }
+      meters.endBundle();
+      std::vector<PacketSlot> out(burst);
+      for (int i = 0; i < burst; i++)
+      {
+         out[i].data = meters.packetData();
+         out[i].size = meters.packetSize();
+         out[i].addr = app;
+      }
+
+      int64_t next = Now();
+      while (running)
+      {
+         size_t n = sock.receiveBatch(&slots[0], slots.size(), 1);
+         int64_t now = Now();
+         for (size_t i = 0; i < n; i++)
+         {
+            PacketViewReader pr(slots[i].data, slots[i].size);
+            const MessageView *m;
+            while (pr.isOk() && (m = pr.popMessage()) != 0)
+            {
+               int64_t stamp;
+               float value;
+               if (m->arg().popFloat(value).popInt64(stamp).isOkNoMoreArgs())
+               {
+                  latencies.push_back(now - stamp);
+               }
+            }
+         }
+         if (burst && now >= next)
+         {
+            sock.sendBatch(&out[0], out.size());
+            next = now + 1000000;
+         }
+      }
+   }
+};
+
+// ====================================================================
+// One run: the UI loop with either inline or threaded network work
+// ====================================================================
+static void
+Run(bool threaded, double seconds, int repaint_ms, int burst)
+{
+   FakeMixer mixer;
+   mixer.sock.bindTo(0);
+   mixer.burst = burst;
+   mixer.running = true;
+
+   UdpSocket app;
+   IoThread io;
+   if (threaded)
+   {
+      io.AddRoute("/2/*");
+      io.Start(0, "127.0.0.1", mixer.sock.boundPort());
+      mixer.app = mixer.sock.local_addr;
+      ((struct sockaddr_in *)&mixer.app.addr())->sin_port = htons(io.GetLocalPort());
+      ((struct sockaddr_in *)&mixer.app.addr())->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   }
+   else
+   {
+      app.bindTo(0);
+      mixer.app = Loopback(app);
+   }
+   SockAddr dest = Loopback(mixer.sock);
+   std::thread mixerThread(&FakeMixer::Run, &mixer);
+
+   // The input device, fader moves every 1 to 4 ms
+   SpscRing<int64_t> inputs(1024);
+   std::atomic<bool> moving(true);
+   std::thread inputThread([&]()
+   {
+      srand(1);
+      while (moving)
+      {
+         std::this_thread::sleep_for(std::chrono::microseconds(1000 + rand() % 3000));
+         int64_t *slot = inputs.Back();
+         if (slot)
+         {
+            *slot = Now();
+            inputs.Push();
+         }
+      }
+   });
+
+   CompiledPattern listen("/2/*");
+   PacketWriter pw;
+   Message msg;
+   int64_t stop = Now() + (int64_t)(seconds * 1e9);
+   int64_t nextFrame = Now();
+   while (Now() < stop)
+   {
+      bool busy = false;
+
+      // Network first, like the socket notifications queued in front of
+      // the fader events
+      if (threaded)
+      {
+         while (io.Front())
+         {
+            io.Pop();
+            busy = true;
+         }
+      }
+      else
+      {
+         while (app.receiveNextPacket(0))
+         {
+            PacketViewReader pr(app.packetData(), app.packetSize());
+            const MessageView *m;
+            while (pr.isOk() && (m = pr.popMessage()) != 0)
+            {
+               m->match(listen);
+            }
+            busy = true;
+         }
+      }
+
+      int64_t *stamp;
+      while ((stamp = inputs.Front()) != NULL)
+      {
+         pw.init();
+         msg.init("/2/volume").pushFloat(0.5f).pushInt64(*stamp);
+         pw.addMessage(msg);
+         if (threaded)
+         {
+            io.Send(pw.packetData(), pw.packetSize());
+         }
+         else
+         {
+            app.sendPacketTo(pw.packetData(), pw.packetSize(), dest);
+         }
+         inputs.Pop();
+         busy = true;
+      }
+
+      if (Now() >= nextFrame)
+      {
+         // Repaint, the thread is not available for anything else
+         int64_t end = Now() + repaint_ms * 1000000LL;
+         while (Now() < end)
+         {
+         }
+         nextFrame += 16666667;
+         busy = true;
+      }
+
+      if (!busy)
+      {
+         std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+   }
+
+   moving = false;
+   inputThread.join();
+   std::this_thread::sleep_for(std::chrono::milliseconds(50));
+   mixer.running = false;
+   mixerThread.join();
+   io.Stop();
+
+   std::vector<int64_t> & l = mixer.latencies;
+   std::sort(l.begin(), l.end());
+   if (l.empty())
+   {
+      printf("%-8s %8d %8s\n", threaded ? "thread" : "inline", repaint_ms, "no samples");
+      return;
+   }
+   printf("%-8s %8d %8zu %10.1f %10.1f %10.1f\n",
+          threaded ? "thread" : "inline",
+          repaint_ms,
+          l.size(),
+          l[l.size() / 2] / 1000.0,
+          l[(l.size() * 99) / 100] / 1000.0,
+          l.back() / 1000.0);
+}
+
+int
+main(int argc, char **argv)
+{
+   double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+   int repaint = argc > 2 ? atoi(argv[2]) : 8;
+
+   printf("%-8s %8s %8s %10s %10s %10s\n", "mode", "paint ms", "samples", "p50 us", "p99 us", "max us");
+   for (int load = 0; load < 2; load++)
+   {
+      Run(false, seconds, load ? repaint : 0, 16);
+      Run(true, seconds, load ? repaint : 0, 16);
+   }
+
+   return 0;
+}
@@ -0,0 +1,148 @@
+/*
+  Time spent on one page 2 echo burst: the values of a channel followed
+  by its trackname, which five controls then look their values up in.
+
+  "map" is what ParamQueries and MyFrame used to do: key each value by
+  the name at the end of its address in a std::map, and find every
+  control's parameter in it by name.  "state" turns the address into a
+  parameter id (what the I/O thread now does as it parses), collects the
+  burst in a ParamValues and applies it to a MixerState, where each
+  control reads its entry by index and compares versions.
+
+  The bursts repeat the same values half of the time, as the echoes of
+  polls do, and the last column is how many of those the controls would
+  have taken as news.
+
+  usage: mixerstate [bursts]
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "mixerstate.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static const char *Addresses[] =
+{
+   "/2/volume", "/2/pan", "/2/mute", "/2/solo", "/2/gain",
+   "/2/eqEnable", "/2/eqGain1", "/2/eqGain2", "/2/eqGain3",
+};
+
+#define ADDRESSES ((int) (sizeof(Addresses) / sizeof(Addresses[0])))
+
+// What the controls of a channel read out of a burst
+static const char *Wanted[] = { "volume", "gain", "eqEnable", "eqGain1", "eqGain3" };
+
+#define WANTED ((int) (sizeof(Wanted) / sizeof(Wanted[0])))
+
+static volatile float Sink;
+
+static float
+Value(int burst, int i)
+{
+   // Every other burst repeats the one before
+   return (float) (((burst / 2) * 7 + i) % 1000) / 1000.0f;
+}
+
+static void
+Report(const char *name, Clock::duration elapsed, long bursts, long news)
+{
+   double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+
+   printf("%-6s %12.1f %12ld\n", name, ns / bursts, news);
+}
+
+static void
+RunMap(long bursts)
+{
+   std::map<std::string, float> values;
+   std::map<std::string, float> shown;
+   long news = 0;
+
+   Clock::time_point start = Clock::now();
+   for (long n = 0; n < bursts; n++)
+   {
+      values.clear();
+      for (int i = 0; i < ADDRESSES; i++)
+      {
+         const char *name = strrchr(Addresses[i], '/') + 1;
+         values[name] = Value((int) n, i);
+      }
+
+      // The trackname: every control finds its parameter by name
+      for (int w = 0; w < WANTED; w++)
+      {
+         std::map<std::string, float>::const_iterator it = values.find(Wanted[w]);
+         if (it == values.end())
+         {
+            continue;
+         }
+
+         std::map<std::string, float>::iterator s = shown.find(Wanted[w]);
+         if (s == shown.end() || s->second != it->second)
+         {
+            shown[Wanted[w]] = it->second;
+            news++;
+         }
+         Sink = it->second;
+      }
+   }
+   Report("map", Clock::now() - start, bursts, news);
+}
+
+static void
+RunState(long bursts)
+{
+   MixerState state;
+   ParamValues values;
+   int wanted[WANTED];
+   uint32_t seen[WANTED] = { 0 };
+   long news = 0;
+
+   for (int w = 0; w < WANTED; w++)
+   {
+      wanted[w] = MixerState::ParamId(Wanted[w]);
+   }
+
+   Clock::time_point start = Clock::now();
+   for (long n = 0; n < bursts; n++)
+   {
+      values.Clear();
+      for (int i = 0; i < ADDRESSES; i++)
+      {
+         values.Set(MixerState::ParamId(Addresses[i]), Value((int) n, i));
+      }
+
+      // The trackname: the burst lands in the state, every control reads
+      // its entry
+      state.Apply(0, 5, values);
+      for (int w = 0; w < WANTED; w++)
+      {
+         const MixerState::Entry *e = state.Get(0, 5, wanted[w]);
+         if (e->version > seen[w])
+         {
+            seen[w] = e->version;
+            news++;
+         }
+         Sink = e->value;
+      }
+   }
+   Report("state", Clock::now() - start, bursts, news);
+}
+
+int
+main(int argc, char **argv)
+{
+   long bursts = argc > 1 ? atol(argv[1]) : 1000000;
+
+   printf("%-6s %12s %12s\n", "store", "ns/burst", "news");
+   RunMap(bursts);
+   RunState(bursts);
+
+   return 0;
+}
@@ -0,0 +1,427 @@
+/*
+  Bytes per fader move with the full rewind every bundle used to do,
+  against TrackCursor's delta navigation, and against StripBank's
+  page 1 strip addresses.
+
+  A TotalMix stand-in runs on its own thread over loopback: page 2 bus
+  selection, track+ / track- and parameter writes, with the trackname
+  echo after every move of its cursor, and page 1 bus selection,
+  bank+ / bank- and per strip volumes, with the strip names echoed
+  after every bank move. Each scenario is a series of
+  fader moves; every move waits for its echo (like a user would not
+  move faster than the mixer answers), and at the end the stand-in's
+  values are checked against what was sent. The "user" scenario also
+  moves the stand-in's cursor and bank by themselves now and then, like
+  somebody clicking in the TotalMix window.
+
+  usage: navigation [moves per scenario]
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "oscpkt.h"
+#include "udp.h"
+#include "bank.h"
+#include "cursor.h"
+
+using namespace oscpkt;
+
+static const char *BusNames[] = { "Input", "Output", "Playback" };
+static const char *ModeNames[] = { "rewind", "delta", "strip" };
+
+enum
+{
+   MODE_REWIND,
+   MODE_DELTA,
+   MODE_STRIP
+};
+
+#define WIDTH 8
+
+static std::vector<std::string>
+Names(int bus)
+{
+   std::vector<std::string> names;
+   for (int i = 1; i <= 16; i++)
+   {
+      char name[16];
+      snprintf(name, sizeof(name), "%s %d", bus == 0 ? "AN" : bus == 1 ? "Out" : "Play", i);
+      names.push_back(name);
+   }
+   if (bus == 0)
+   {
+      names[8] = "Mic 1";
+      names[9] = "Mic 2";
+      names[12] = "SPDIF";
+   }
+   else if (bus == 1)
+   {
+      names[0] = "Main";
+      names[7] = "Speaker B";
+   }
+   return names;
+}
+
+// ====================================================================
+// Just enough of TotalMix's page 2
+// ====================================================================
+struct StandIn
+{
+   UdpSocket sock;
+   std::atomic<bool> running;
+   std::atomic<int> wander;                 // cursor moves to make by itself
+   std::vector<std::string> names[3];
+   std::map<std::string, float> values;     // "bus/channel/param"
+   int bus;
+   int track[3];                            // 0 based
+   int bus1;                                // page 1
+   int offset[3];
+
+   StandIn()
+   {
+      for (int b = 0; b < 3; b++)
+      {
+         names[b] = Names(b);
+         track[b] = 0;
+         offset[b] = 0;
+      }
+      bus = 0;
+      bus1 = 0;
+      wander = 0;
+      running = true;
+      sock.bindTo(0);
+   }
+
+   void Echo(SockAddr & to)
+   {
+      PacketWriter pw;
+      Message msg;
+      pw.startBundle();
+      msg.init("/2/volume").pushFloat(values[Key("volume")]);
+      pw.addMessage(msg);
+      msg.init("/2/trackname").pushStr(names[bus][track[bus]]);
+      pw.addMessage(msg);
+      pw.endBundle();
+      sock.sendPacketTo(pw.packetData(), pw.packetSize(), to);
+   }
+
+   void Echo1(SockAddr & to)
+   {
+      PacketWriter pw;
+      Message msg;
+      pw.startBundle();
+      msg.init(std::string("/1/bus") + BusNames[bus1]).pushFloat(1.0f);
+      pw.addMessage(msg);
+      for (int i = 1; i <= WIDTH; i++)
+      {
+         msg.init("/1/trackname" + std::to_string(i)).pushStr(names[bus1][offset[bus1] + i - 1]);
+         pw.addMessage(msg);
+      }
+      pw.endBundle();
+      sock.sendPacketTo(pw.packetData(), pw.packetSize(), to);
+   }
+
+   std::string Key(const std::string & param)
+   {
+      return std::string(BusNames[bus]) + "/" + names[bus][track[bus]] + "/" + param;
+   }
+
+   // Page 1: the banks move a whole width, and never past the last one
+   bool Page1(const std::string & addr, Message *msg, SockAddr & from)
+   {
+      int n = (int) names[bus1].size();
+      float v;
+      if (addr.compare(0, 6, "/1/bus") == 0)
+      {
+         for (int b = 0; b < 3; b++)
+         {
+            if (addr.substr(6) == BusNames[b])
+            {
+               bus1 = b;
+            }
+         }
+         Echo1(from);
+      }
+      else if (addr == "/1/bank+")
+      {
+         offset[bus1] = offset[bus1] + WIDTH < n ? offset[bus1] + WIDTH : offset[bus1];
+         Echo1(from);
+      }
+      else if (addr == "/1/bank-")
+      {
+         offset[bus1] = offset[bus1] > WIDTH ? offset[bus1] - WIDTH : 0;
+         Echo1(from);
+      }
+      else if (addr.compare(0, 9, "/1/volume") == 0 && msg->arg().popFloat(v).isOkNoMoreArgs())
+      {
+         int strip = atoi(addr.c_str() + 9);
+         values[std::string(BusNames[bus1]) + "/" + names[bus1][offset[bus1] + strip - 1] + "/volume"] = v;
+      }
+      else
+      {
+         return false;
+      }
+      return true;
+   }
+
+   void Run()
+   {
+      while (running)
+      {
+         if (!sock.receiveNextPacket(5))
+         {
+            continue;
+         }
+         SockAddr from = sock.packetOrigin();
+         PacketReader pr(sock.packetData(), sock.packetSize());
+         Message *msg;
+         while (pr.isOk() && (msg = pr.popMessage()) != 0)
+         {
+            const std::string & addr = msg->addressPattern();
+            int n = (int) names[bus].size();
+            if (Page1(addr, msg, from))
+            {
+               continue;
+            }
+            if (addr.compare(0, 6, "/2/bus") == 0)
+            {
+               for (int b = 0; b < 3; b++)
+               {
+                  if (addr.substr(6) == BusNames[b])
+                  {
+                     bus = b;
+                  }
+               }
+               Echo(from);
+            }
+            else if (addr == "/2/track+")
+            {
+               track[bus] = track[bus] + 1 < n ? track[bus] + 1 : track[bus];
+               Echo(from);
+            }
+            else if (addr == "/2/track-")
+            {
+               track[bus] = track[bus] > 0 ? track[bus] - 1 : 0;
+               Echo(from);
+            }
+            else
+            {
+               float v;
+               if (msg->arg().popFloat(v).isOkNoMoreArgs())
+               {
+                  values[Key(addr.substr(3))] = v;
+               }
+            }
+         }
+
+         if (wander > 0)
+         {
+            wander--;
+            track[bus] = rand() % (int) names[bus].size();
+            Echo(from);
+
+            // Scrolled a strip at a time, off the bank boundaries
+            offset[bus1] = rand() % ((int) names[bus1].size() - WIDTH + 1);
+            Echo1(from);
+         }
+      }
+   }
+};
+
+// ====================================================================
+// A control, as in tuba's table
+// ====================================================================
+struct Target
+{
+   int bus;
+   const char *name;
+};
+
+static int
+IdOf(int bus, const char *name)
+{
+   std::vector<std::string> names = Names(bus);
+   for (size_t i = 0; i < names.size(); i++)
+   {
+      if (names[i] == name)
+      {
+         return (int) i + 1;
+      }
+   }
+   return -1;
+}
+
+// What MyFrame::GetBundle used to build
+static void
+FullRewind(PacketWriter & pw, int bus, int id, int count, const Message & param)
+{
+   Message msg;
+   pw.init().startBundle();
+   msg.init(std::string("/2/bus") + BusNames[bus]).pushFloat(1.0f);
+   pw.addMessage(msg);
+   msg.init("/2/track-").pushFloat(1.0f);
+   for (int i = 0; i < count; i++)
+   {
+      pw.addMessage(msg);
+   }
+   msg.init("/2/track+").pushFloat(1.0f);
+   for (int i = 1; i < id; i++)
+   {
+      pw.addMessage(msg);
+   }
+   pw.addMessage(param);
+   pw.endBundle();
+}
+
+static bool
+Run(const char *label, const std::vector<Target> & targets, int moves, int mode, int wanderEvery)
+{
+   StandIn mixer;
+   std::thread mixerThread(&StandIn::Run, &mixer);
+
+   UdpSocket sock;
+   sock.bindTo(0);
+   SockAddr dest = mixer.sock.local_addr;
+   ((struct sockaddr_in *)&dest.addr())->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   TrackCursor cursor;
+   for (int b = 0; b < 3; b++)
+   {
+      cursor.AddBus(BusNames[b]);
+   }
+   cursor.SetLookup([](int bus, const char *name) { return IdOf(bus, name); });
+
+   StripBank strips(1, WIDTH);
+   for (int b = 0; b < 3; b++)
+   {
+      strips.AddBus(BusNames[b]);
+   }
+   strips.SetLookup([](int bus, const char *name) { return IdOf(bus, name); });
+   int active = -1;
+
+   PacketWriter pw;
+   Message param;
+   std::map<std::string, float> expected;
+   size_t bytes = 0;
+   size_t packets = 0;
+
+   for (int i = 0; i < moves; i++)
+   {
+      const Target & t = targets[i % targets.size()];
+      float value = (float) ((i * 7) % 1000) / 1000.0f;
+      param.init("/2/volume").pushFloat(value);
+      expected[std::string(BusNames[t.bus]) + "/" + t.name + "/volume"] = value;
+
+      if (wanderEvery && i % wanderEvery == wanderEvery - 1)
+      {
+         mixer.wander++;
+      }
+
+      if (mode == MODE_STRIP)
+      {
+         strips.Navigate(pw, t.bus, IdOf(t.bus, t.name), 16, "/1/volume", value);
+      }
+      else if (mode == MODE_DELTA)
+      {
+         cursor.Navigate(pw, t.bus, IdOf(t.bus, t.name), 16, &param);
+      }
+      else
+      {
+         FullRewind(pw, t.bus, IdOf(t.bus, t.name), 16, param);
+      }
+      sock.sendPacketTo(pw.packetData(), pw.packetSize(), dest);
+      bytes += pw.packetSize();
+      packets++;
+
+      // Echoes until things calm down
+      while (sock.receiveNextPacket(2))
+      {
+         PacketReader pr(sock.packetData(), sock.packetSize());
+         Message *msg;
+         while (pr.isOk() && (msg = pr.popMessage()) != 0)
+         {
+            std::string name;
+            const std::string & addr = msg->addressPattern();
+            if (msg->match("/2/trackname") && msg->arg().popStr(name).isOkNoMoreArgs())
+            {
+               cursor.OnTrackName(name.c_str());
+            }
+            else if (addr.compare(0, 6, "/1/bus") == 0)
+            {
+               for (int b = 0; b < 3; b++)
+               {
+                  if (addr.substr(6) == BusNames[b])
+                  {
+                     active = b;
+                     strips.OnBus(b);
+                  }
+               }
+            }
+            else if (addr.compare(0, 12, "/1/trackname") == 0 && active >= 0 && msg->arg().popStr(name).isOkNoMoreArgs())
+            {
+               strips.OnTrackName(active, atoi(addr.c_str() + 12), name.c_str());
+            }
+         }
+      }
+   }
+
+   mixer.running = false;
+   mixerThread.join();
+
+   int wrong = 0;
+   for (std::map<std::string, float>::iterator it = expected.begin(); it != expected.end(); ++it)
+   {
+      if (mixer.values[it->first] != it->second)
+      {
+         wrong++;
+      }
+   }
+
+   printf("%-10s %-8s %10.1f %10.1f %8lu %8lu %8d\n",
+          label,
+          ModeNames[mode],
+          (double) bytes / moves,
+          (double) bytes / packets,
+          mode == MODE_STRIP ? strips.GetRewinds() : mode == MODE_DELTA ? cursor.GetRewinds() : (unsigned long) moves,
+          mode == MODE_STRIP ? strips.GetDesyncs() : cursor.GetDesyncs(),
+          wrong);
+
+   return wrong == 0;
+}
+
+int
+main(int argc, char **argv)
+{
+   int moves = argc > 1 ? atoi(argv[1]) : 400;
+   bool ok = true;
+
+   std::vector<Target> drag;
+   drag.push_back(Target { 0, "Mic 1" });
+
+   std::vector<Target> pair;
+   pair.push_back(Target { 0, "Mic 1" });
+   pair.push_back(Target { 0, "SPDIF" });
+
+   std::vector<Target> buses;
+   buses.push_back(Target { 0, "Mic 1" });
+   buses.push_back(Target { 1, "Main" });
+   buses.push_back(Target { 1, "Speaker B" });
+
+   printf("%-10s %-8s %10s %10s %8s %8s %8s\n", "scenario", "mode", "bytes/move", "bytes/pkt", "rewinds", "desyncs", "wrong");
+   for (int mode = MODE_REWIND; mode <= MODE_STRIP; mode++)
+   {
+      ok &= Run("drag", drag, moves, mode, 0);
+      ok &= Run("pair", pair, moves, mode, 0);
+      ok &= Run("buses", buses, moves, mode, 0);
+      ok &= Run("user", buses, moves, mode, 25);
+   }
+
+   return ok ? 0 : 1;
+}
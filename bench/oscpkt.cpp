@@ -0,0 +1,546 @@
+/*
+  What the parts of oscpkt Tuba leans on cost per call: building
+  messages, writing bundles of 1 to 64 of them, reading flat and nested
+  bundles back (PacketReader, and PacketViewReader for comparison),
+  popping each type of argument, converting runs of floats (one at a
+  time, byte by byte the way the codec used to, and batched), writing
+  and reading the bundle a fader move sends, and matching addresses
+  against literal, {a,b}, * and // patterns, and two that make
+  fullPatternMatch backtrack (fullPatternMatch, and a CompiledPattern
+  of the same).
+
+  Each case runs in batches big enough to time, warms up, then takes
+  a number of samples.  Samples outside 1.5 interquartile ranges of the
+  quartiles are dropped before the mean is taken.  Allocations are
+  counted by replacing the global operator new, so "allocs" and "bytes"
+  are what a call allocates on average (bytes as asked of new).
+
+  usage: oscpkt [samples] [filter]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "oscpkt.h"
+
+using namespace oscpkt;
+
+typedef std::chrono::steady_clock Clock;
+
+static unsigned long Allocs;
+static unsigned long AllocBytes;
+
+static void *
+Allocate(size_t size)
+{
+   Allocs++;
+   AllocBytes += size;
+
+   void *p = malloc(size ? size : 1);
+   if (p == NULL)
+   {
+      throw std::bad_alloc();
+   }
+   return p;
+}
+
+// Arrays and sized deletes replaced as well, so no allocation escapes
+// the count and no replaced new is freed by the library's delete
+void *operator new(size_t size) { return Allocate(size); }
+void *operator new[](size_t size) { return Allocate(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+// The codec as it was before the byte order became a compile-time
+// constant: the order probed, and each byte moved, one at a time
+static bool
+ProbeBigEndian()
+{
+   PodBytes<int32_t> p;
+   p.value = 0x12345678;
+   return p.bytes[0] == 0x12;
+}
+
+static void
+PerBytePod2Bytes(float value, char *bytes)
+{
+   PodBytes<float> p;
+   p.value = value;
+   for (size_t i = 0; i < sizeof(float); i++)
+   {
+      bytes[i] = ProbeBigEndian() ? p.bytes[i] : p.bytes[sizeof(float) - i - 1];
+   }
+}
+
+static float
+PerByteBytes2Pod(const char *bytes)
+{
+   PodBytes<float> p;
+   for (size_t i = 0; i < sizeof(float); i++)
+   {
+      p.bytes[i] = ProbeBigEndian() ? bytes[i] : bytes[sizeof(float) - i - 1];
+   }
+   return p.value;
+}
+
+static volatile long Sink;
+
+static int Samples = 31;
+static const char *Filter = NULL;
+
+static const char *Pending = NULL;  // section header not printed yet
+
+static const int Warmup = 5;
+static const double BatchNs = 200000.0;  // a batch runs at least this long
+
+// ====================================================================
+// Time op, one line of results
+// ====================================================================
+template <typename Op>
+static void
+Bench(const char *name, Op op)
+{
+   if (Filter != NULL && strstr(name, Filter) == NULL)
+   {
+      return;
+   }
+
+   // Big enough for the clock
+   long batch = 1;
+   for (;;)
+   {
+      long sum = 0;
+      Clock::time_point start = Clock::now();
+      for (long i = 0; i < batch; i++)
+      {
+         sum += (long) op();
+      }
+      Sink = sum;
+      double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+      if (ns >= BatchNs || batch >= (1L << 24))
+      {
+         break;
+      }
+      batch *= 2;
+   }
+
+   for (int w = 0; w < Warmup; w++)
+   {
+      long sum = 0;
+      for (long i = 0; i < batch; i++)
+      {
+         sum += (long) op();
+      }
+      Sink = sum;
+   }
+
+   std::vector<double> samples;
+   unsigned long allocs = Allocs;
+   unsigned long bytes = AllocBytes;
+   for (int s = 0; s < Samples; s++)
+   {
+      long sum = 0;
+      Clock::time_point start = Clock::now();
+      for (long i = 0; i < batch; i++)
+      {
+         sum += (long) op();
+      }
+      Sink = sum;
+      samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count() / batch);
+   }
+   double ops = (double) Samples * batch;
+   allocs = Allocs - allocs;
+   bytes = AllocBytes - bytes;
+
+   // Tukey's fences
+   std::vector<double> sorted = samples;
+   std::sort(sorted.begin(), sorted.end());
+   double q1 = sorted[sorted.size() / 4];
+   double q3 = sorted[sorted.size() * 3 / 4];
+   double low = q1 - 1.5 * (q3 - q1);
+   double high = q3 + 1.5 * (q3 - q1);
+
+   double sum = 0.0;
+   int kept = 0;
+   for (size_t i = 0; i < sorted.size(); i++)
+   {
+      if (sorted[i] >= low && sorted[i] <= high)
+      {
+         sum += sorted[i];
+         kept++;
+      }
+   }
+   double mean = sum / kept;
+
+   double var = 0.0;
+   for (size_t i = 0; i < sorted.size(); i++)
+   {
+      if (sorted[i] >= low && sorted[i] <= high)
+      {
+         var += (sorted[i] - mean) * (sorted[i] - mean);
+      }
+   }
+   double dev = kept > 1 ? sqrt(var / (kept - 1)) : 0.0;
+
+   if (Pending != NULL)
+   {
+      printf("\n%-34s %10s %7s %8s %9s %7s\n", Pending, "ns/op", "+-", "allocs", "bytes", "kept");
+      Pending = NULL;
+   }
+   printf("%-34s %10.1f %6.1f%% %8.2f %9.1f %5d/%d\n", name, mean, mean > 0.0 ? 100.0 * dev / mean : 0.0,
+          allocs / ops, bytes / ops, kept, Samples);
+   fflush(stdout);
+}
+
+// Printed by the first case of the section that runs
+static void
+Section(const char *name)
+{
+   Pending = name;
+}
+
+// ====================================================================
+// count /1/volumeN messages, in one bundle or in bundles of bundles
+// ====================================================================
+static void
+Flat(PacketWriter & pw, int count)
+{
+   Message msg;
+
+   pw.init().startBundle();
+   for (int i = 0; i < count; i++)
+   {
+      pw.addMessage(msg.init("/1/volume" + std::to_string(i % 8 + 1)).pushFloat(i / 64.0f));
+   }
+   pw.endBundle();
+}
+
+static void
+Nested(PacketWriter & pw, int depth, int fanout, int & n)
+{
+   Message msg;
+
+   pw.startBundle();
+   for (int i = 0; i < fanout; i++)
+   {
+      if (depth > 1)
+      {
+         Nested(pw, depth - 1, fanout, n);
+      }
+      else
+      {
+         pw.addMessage(msg.init("/1/volume" + std::to_string(n % 8 + 1)).pushFloat(n / 64.0f));
+         n++;
+      }
+   }
+   pw.endBundle();
+}
+
+int
+main(int argc, char **argv)
+{
+   if (argc > 1)
+   {
+      Samples = std::max(atoi(argv[1]), 4);
+   }
+   if (argc > 2)
+   {
+      Filter = argv[2];
+   }
+
+   // A Message kept and reused, as the senders do
+   Message msg;
+   Section("message");
+   Bench("init+pushFloat", [&]() { return msg.init("/2/volume").pushFloat(0.5f).typeTags().size(); });
+   Bench("init+pushInt32", [&]() { return msg.init("/2/track+").pushInt32(1).typeTags().size(); });
+   Bench("init+pushStr", [&]() { return msg.init("/2/trackname").pushStr("Speaker B").typeTags().size(); });
+   Bench("init+push 4 mixed", [&]()
+   {
+      return msg.init("/2/eqGain1").pushInt32(3).pushFloat(0.25f).pushStr("Main").pushBool(true).typeTags().size();
+   });
+   Bench("new Message+pushFloat", []()
+   {
+      Message m("/2/volume");
+      return m.pushFloat(0.5f).typeTags().size();
+   });
+
+   PacketWriter pw;
+   std::vector<Message> msgs(8);
+   for (int i = 0; i < 8; i++)
+   {
+      msgs[i].init("/1/volume" + std::to_string(i + 1)).pushFloat(i / 8.0f);
+   }
+   Section("writer");
+   static const int Sizes[] = { 1, 4, 16, 64 };
+   for (size_t s = 0; s < sizeof(Sizes) / sizeof(Sizes[0]); s++)
+   {
+      int count = Sizes[s];
+      std::string name = "bundle of " + std::to_string(count);
+      Bench(name.c_str(), [&]()
+      {
+         pw.init().startBundle();
+         for (int i = 0; i < count; i++)
+         {
+            pw.addMessage(msgs[i & 7]);
+         }
+         pw.endBundle();
+         return pw.packetSize();
+      });
+   }
+
+   // The packets read back, kept whole
+   PacketWriter single;
+   single.init().addMessage(msgs[0]);
+   PacketWriter flat8;
+   Flat(flat8, 8);
+   PacketWriter flat64;
+   Flat(flat64, 64);
+   PacketWriter nested;
+   int n = 0;
+   nested.init();
+   Nested(nested, 3, 4, n);
+
+   const struct
+   {
+      const char *name;
+      PacketWriter *pw;
+   }
+   Packets[] =
+   {
+      { "message",        &single },
+      { "flat 8",         &flat8  },
+      { "flat 64",        &flat64 },
+      { "nested 4x4x4",   &nested },
+   };
+
+   Section("reader");
+   PacketReader pr;
+   for (size_t p = 0; p < sizeof(Packets) / sizeof(Packets[0]); p++)
+   {
+      PacketWriter *packet = Packets[p].pw;
+      std::string name = std::string("PacketReader ") + Packets[p].name;
+      Bench(name.c_str(), [&]()
+      {
+         int count = 0;
+         pr.init(packet->packetData(), packet->packetSize());
+         while (pr.isOk() && pr.popMessage() != NULL)
+         {
+            count++;
+         }
+         return count;
+      });
+   }
+   PacketViewReader pvr;
+   for (size_t p = 0; p < sizeof(Packets) / sizeof(Packets[0]); p++)
+   {
+      PacketWriter *packet = Packets[p].pw;
+      std::string name = std::string("PacketViewReader ") + Packets[p].name;
+      Bench(name.c_str(), [&]()
+      {
+         int count = 0;
+         pvr.init(packet->packetData(), packet->packetSize());
+         while (pvr.isOk() && pvr.popMessage() != NULL)
+         {
+            count++;
+         }
+         return count;
+      });
+   }
+
+   // One argument of each type, read from a parsed packet
+   char blob[16] = "0123456789abcde";
+   PacketWriter args;
+   args.init().startBundle();
+   args.addMessage(Message("/a/int32").pushInt32(7));
+   args.addMessage(Message("/a/int64").pushInt64(7));
+   args.addMessage(Message("/a/float").pushFloat(0.5f));
+   args.addMessage(Message("/a/double").pushDouble(0.5));
+   args.addMessage(Message("/a/str").pushStr("Speaker B"));
+   args.addMessage(Message("/a/bool").pushBool(true));
+   args.addMessage(Message("/a/blob").pushBlob(blob, sizeof(blob)));
+   args.endBundle();
+
+   PacketReader argReader(args.packetData(), args.packetSize());
+   Message *arg[7];
+   for (int i = 0; i < 7; i++)
+   {
+      arg[i] = argReader.popMessage();
+   }
+
+   int32_t i32;
+   int64_t i64;
+   float f;
+   double d;
+   std::string s;
+   bool b;
+   std::vector<char> v;
+   Section("args");
+   Bench("popInt32", [&]() { return arg[0]->arg().popInt32(i32).isOkNoMoreArgs(); });
+   Bench("popInt64", [&]() { return arg[1]->arg().popInt64(i64).isOkNoMoreArgs(); });
+   Bench("popFloat", [&]() { return arg[2]->arg().popFloat(f).isOkNoMoreArgs(); });
+   Bench("popDouble", [&]() { return arg[3]->arg().popDouble(d).isOkNoMoreArgs(); });
+   Bench("popStr", [&]() { return arg[4]->arg().popStr(s).isOkNoMoreArgs(); });
+   Bench("popBool", [&]() { return arg[5]->arg().popBool(b).isOkNoMoreArgs(); });
+   Bench("popBlob", [&]() { return arg[6]->arg().popBlob(v).isOkNoMoreArgs(); });
+
+   // A run of 16 floats, as many as the level meters send at once
+   static const int Run = 16;
+   float floats[Run];
+   char wire[4 * Run];
+   for (int i = 0; i < Run; i++)
+   {
+      floats[i] = i / 16.0f;
+   }
+   Message run("/1/levelInput");
+   run.pushFloats(floats, Run);
+   PacketWriter runPacket;
+   runPacket.init().addMessage(run);
+   PacketViewReader runReader(runPacket.packetData(), runPacket.packetSize());
+   const MessageView *runView = runReader.popMessage();
+
+   Section("floats");
+   Bench("per byte pod2bytes x16", [&]()
+   {
+      for (int i = 0; i < Run; i++)
+      {
+         PerBytePod2Bytes(floats[i], wire + 4 * i);
+      }
+      return wire[5];
+   });
+   Bench("pod2bytes x16", [&]()
+   {
+      for (int i = 0; i < Run; i++)
+      {
+         pod2bytes<float>(floats[i], wire + 4 * i);
+      }
+      return wire[5];
+   });
+   Bench("per byte bytes2pod x16", [&]()
+   {
+      for (int i = 0; i < Run; i++)
+      {
+         floats[i] = PerByteBytes2Pod(wire + 4 * i);
+      }
+      return floats[5] > 0.0f;
+   });
+   Bench("bytes2pod x16", [&]()
+   {
+      for (int i = 0; i < Run; i++)
+      {
+         floats[i] = bytes2pod<float>(wire + 4 * i);
+      }
+      return floats[5] > 0.0f;
+   });
+   Bench("swapWords32 16", [&]()
+   {
+      swapWords32((const char *) floats, wire, Run);
+      return wire[5];
+   });
+   Bench("init+pushFloat x16", [&]()
+   {
+      msg.init("/1/levelInput");
+      for (int i = 0; i < Run; i++)
+      {
+         msg.pushFloat(floats[i]);
+      }
+      return msg.typeTags().size();
+   });
+   Bench("init+pushFloats 16", [&]()
+   {
+      return msg.init("/1/levelInput").pushFloats(floats, Run).typeTags().size();
+   });
+   Bench("popFloat x16", [&]()
+   {
+      MessageView::ArgReader a = runView->arg();
+      for (int i = 0; i < Run; i++)
+      {
+         a.popFloat(floats[i]);
+      }
+      return a.isOkNoMoreArgs();
+   });
+   Bench("popFloats 16", [&]() { return runView->arg().popFloats(floats, Run).isOkNoMoreArgs(); });
+
+   // What a fader move on page 1 sends: the bus selected, then the
+   // strip's value, here for a whole bank of 8 strips; and its reading
+   Message select("/1/busInput");
+   select.pushFloat(1.0f);
+   std::vector<std::string> volumes;
+   for (int i = 0; i < 8; i++)
+   {
+      volumes.push_back("/1/volume" + std::to_string(i + 1));
+   }
+   PacketWriter fader;
+   auto faderBundle = [&]()
+   {
+      fader.init().startBundle();
+      fader.addMessage(select);
+      for (int i = 0; i < 8; i++)
+      {
+         fader.addMessage(msg.init(volumes[i]).pushFloat(i / 8.0f));
+      }
+      fader.endBundle();
+      return fader.packetSize();
+   };
+   faderBundle();
+   Bench("fader bundle write", faderBundle);
+   Bench("fader bundle read", [&]()
+   {
+      float sum = 0.0f;
+      pvr.init(fader.packetData(), fader.packetSize());
+      while (const MessageView *m = pvr.popMessage())
+      {
+         float value;
+         m->arg().popFloat(value);
+         sum += value;
+      }
+      return sum;
+   });
+
+   // Pattern and an address it is matched against
+   static const struct
+   {
+      const char *name;
+      const char *pattern;
+      const char *path;
+   }
+   Patterns[] =
+   {
+      { "literal",          "/2/volume",            "/2/volume"      },
+      { "literal mismatch", "/2/volume",            "/2/eqGain1"     },
+      { "{a,b}",            "/2/{volume,pan,gain}", "/2/gain"        },
+      { "*",                "/1/volume*",           "/1/volume12"    },
+      { "//",               "//trackname",          "/2/trackname"   },
+      { "// and *",         "//level*Left",         "/1/level12Left" },
+
+      // What backtracking makes of patterns that almost match
+      { "* pathological",   "*a*a*a*a*a*a*b*",      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa" },
+      { "// pathological",  "//a//a//a//a//b//*",   "/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a/a" },
+   };
+
+   Section("match");
+   for (size_t p = 0; p < sizeof(Patterns) / sizeof(Patterns[0]); p++)
+   {
+      const char *pattern = Patterns[p].pattern;
+      const char *path = Patterns[p].path;
+      std::string name = std::string("fullPatternMatch ") + Patterns[p].name;
+      Bench(name.c_str(), [=]() { return fullPatternMatch(pattern, path); });
+   }
+   for (size_t p = 0; p < sizeof(Patterns) / sizeof(Patterns[0]); p++)
+   {
+      CompiledPattern compiled(Patterns[p].pattern);
+      const char *path = Patterns[p].path;
+      std::string name = std::string("CompiledPattern ") + Patterns[p].name;
+      Bench(name.c_str(), [&]() { return compiled.fullMatch(path); });
+   }
+
+   return 0;
+}
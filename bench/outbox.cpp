@@ -0,0 +1,143 @@
+/*
+  Packets a slider drag costs through the Outbox, and whether the mixer
+  always ends up on the last value.
+
+  Simulated time, nothing goes on the wire: a sweep posts one value
+  every few milliseconds (what a mouse drag across a slider produces)
+  and the outbox is drained once per 16 ms frame, like MyFrame::OnFrame
+  does.  "direct" is what sending every slider event used to cost.
+
+  The "ganged" sweep posts two parameters per event (Bass moves the EQ
+  of Main and Speaker B together), "stalled" has the sender refuse
+  every third packet (the I/O ring full), and "full" posts more
+  parameters than the outbox holds: the refused values are held by the
+  caller and posted again after the next frame.
+
+  usage: outbox [events per sweep]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+
+#include "outbox.h"
+
+struct Result
+{
+   unsigned long packets;
+   unsigned long refused;
+   bool ended;                              // every parameter on its last value
+};
+
+static Result
+Sweep(int events, int stepUs, int params, size_t capacity, double rate, int stallEvery)
+{
+   Outbox box(capacity, rate, 4);
+   Outbox::Clock::time_point start = Outbox::Clock::now();
+
+   // By parameter id, all on channel 0 of bus 1
+   std::map<int, float> mixer;
+   std::map<int, float> last;
+   std::map<int, float> held;              // refused, to post again
+   unsigned long calls = 0;
+
+   Outbox::Sender send = [&](int, int, int param, float value)
+   {
+      if (stallEvery && ++calls % stallEvery == 0)
+      {
+         return false;
+      }
+      mixer[param] = value;
+      return true;
+   };
+
+   long frameUs = 16000;
+   long nextFrame = frameUs;
+   std::function<void ()> frame = [&]()
+   {
+      box.Drain(send, start + std::chrono::microseconds(nextFrame));
+      for (std::map<int, float>::iterator it = held.begin(); it != held.end(); )
+      {
+         if (box.Post(1, 0, it->first, it->second) == Outbox::POST_FULL)
+         {
+            ++it;
+            continue;
+         }
+         held.erase(it++);
+      }
+   };
+
+   long t = 0;
+   for (int i = 0; i < events; i++, t += stepUs)
+   {
+      while (t >= nextFrame)
+      {
+         frame();
+         nextFrame += frameUs;
+      }
+
+      float value = (float) i / (float) (events - 1);
+      for (int p = 0; p < params; p++)
+      {
+         last[p] = value;
+         if (box.Post(1, 0, p, value) == Outbox::POST_FULL)
+         {
+            held[p] = value;
+         }
+         else
+         {
+            held.erase(p);
+         }
+      }
+   }
+
+   // The user let go, frames keep coming until everything is out
+   while (box.GetSize() > 0 || !held.empty())
+   {
+      frame();
+      nextFrame += frameUs;
+   }
+
+   Result r;
+   r.packets = box.GetSent();
+   r.refused = box.GetRefused();
+   r.ended = true;
+   for (std::map<int, float>::iterator it = last.begin(); it != last.end(); ++it)
+   {
+      if (mixer[it->first] != it->second)
+      {
+         r.ended = false;
+      }
+   }
+
+   return r;
+}
+
+static bool
+Report(const char *label, int events, int params, const Result & r)
+{
+   printf("%-10s %8lu %8lu %8lu %8s\n",
+          label,
+          (unsigned long) (events * params),
+          r.packets,
+          r.refused,
+          r.ended ? "yes" : "NO");
+   return r.ended;
+}
+
+int
+main(int argc, char **argv)
+{
+   int events = argc > 1 ? atoi(argv[1]) : 1000;
+   bool ok = true;
+
+   printf("%-10s %8s %8s %8s %8s\n", "sweep", "direct", "outbox", "refused", "last");
+   ok &= Report("fast", events, 1, Sweep(events, 2000, 1, 32, 100.0, 0));
+   ok &= Report("slow", events, 1, Sweep(events, 20000, 1, 32, 100.0, 0));
+   ok &= Report("ganged", events, 2, Sweep(events, 2000, 2, 32, 100.0, 0));
+   ok &= Report("stalled", events, 1, Sweep(events, 2000, 1, 32, 100.0, 3));
+   ok &= Report("full", events, 8, Sweep(events, 2000, 8, 4, 100.0, 0));
+
+   return ok ? 0 : 1;
+}
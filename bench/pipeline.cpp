@@ -0,0 +1,235 @@
+/*
+  Startup time and sustained requests per second through RequestWindow,
+  for windows of 1 (the old stop-and-wait), 2, 4 and 8.
+
+  A TotalMix stand-in runs on its own thread over loopback and answers
+  every page 1 bus selection with the bus echo and the names of its
+  strips.  It adds a one way delay each way (the network, and TotalMix
+  getting round to it) and handles requests one at a time with a fixed
+  service time, so a deep enough window ends up limited by the mixer
+  rather than by the round trip.
+
+  "startup" is the four bus selections MyFrame starts with, until the
+  last one is answered; "sustained" keeps the queue full of selections
+  and counts answers per second.
+
+  usage: pipeline [one way ms] [service ms] [sustained requests]
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "oscpkt.h"
+#include "udp.h"
+#include "window.h"
+
+using namespace oscpkt;
+
+typedef std::chrono::steady_clock Clock;
+
+static const char *BusNames[] = { "Input", "Output", "Playback" };
+
+// ====================================================================
+// Answers bus selections, late
+// ====================================================================
+struct StandIn
+{
+   struct Due
+   {
+      Clock::time_point when;
+      std::string bus;
+   };
+
+   UdpSocket sock;
+   SockAddr app;
+   std::atomic<bool> running;
+   std::chrono::microseconds oneWay;
+   std::chrono::microseconds service;
+   std::deque<Due> due;
+   Clock::time_point busy;
+
+   StandIn(double oneWayMs, double serviceMs)
+   :  oneWay((long) (oneWayMs * 1000)), service((long) (serviceMs * 1000))
+   {
+      running = true;
+      busy = Clock::now();
+      sock.bindTo(0);
+   }
+
+   void Echo(const std::string & bus)
+   {
+      PacketWriter pw;
+      Message msg;
+      pw.startBundle();
+      msg.init("/1/bus" + bus).pushFloat(1.0f);
+      pw.addMessage(msg);
+      for (int i = 1; i <= 8; i++)
+      {
+         msg.init("/1/trackname" + std::to_string(i)).pushStr(bus + " " + std::to_string(i));
+         pw.addMessage(msg);
+      }
+      pw.endBundle();
+      sock.sendPacketTo(pw.packetData(), pw.packetSize(), app);
+   }
+
+   void Run()
+   {
+      while (running)
+      {
+         Clock::time_point now = Clock::now();
+         while (!due.empty() && due.front().when <= now)
+         {
+            Echo(due.front().bus);
+            due.pop_front();
+         }
+
+         int wait = 1;
+         if (!due.empty())
+         {
+            wait = (int) std::chrono::duration_cast<std::chrono::milliseconds>(due.front().when - now).count();
+         }
+         if (!sock.receiveNextPacket(std::max(0, std::min(wait, 1))))
+         {
+            continue;
+         }
+
+         app = sock.packetOrigin();
+         PacketReader pr(sock.packetData(), sock.packetSize());
+         Message *msg;
+         while (pr.isOk() && (msg = pr.popMessage()) != 0)
+         {
+            const std::string & addr = msg->addressPattern();
+            if (addr.compare(0, 6, "/1/bus") != 0)
+            {
+               continue;
+            }
+
+            // In after the delay, then in line behind whatever came first
+            Clock::time_point start = std::max(Clock::now() + oneWay, busy);
+            busy = start + service;
+
+            Due d;
+            d.when = busy + oneWay;
+            d.bus = addr.substr(6);
+            due.push_back(d);
+         }
+      }
+   }
+};
+
+// ====================================================================
+// The app side
+// ====================================================================
+struct Client
+{
+   UdpSocket sock;
+   SockAddr mixer;
+   RequestWindow requests;
+
+   Client(const UdpSocket & to, size_t window)
+   :  requests(window, 64, 1000)
+   {
+      sock.bindTo(0);
+      mixer = to.local_addr;
+      ((struct sockaddr_in *)&mixer.addr())->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      requests.SetSender([this](const void *data, size_t size) { return sock.sendPacketTo(data, size, mixer); });
+   }
+
+   bool Select(int bus)
+   {
+      Message msg(std::string("/1/bus") + BusNames[bus]);
+      msg.pushFloat(1.0f);
+      return requests.Send(msg);
+   }
+
+   void Poll()
+   {
+      if (sock.receiveNextPacket(1))
+      {
+         PacketReader pr(sock.packetData(), sock.packetSize());
+         Message *msg;
+         float v;
+         while (pr.isOk() && (msg = pr.popMessage()) != 0)
+         {
+            if (msg->addressPattern().compare(0, 6, "/1/bus") == 0 && msg->arg().popFloat(v).isOkNoMoreArgs() && v == 1.0f)
+            {
+               requests.OnEcho(msg->addressPattern().c_str());
+            }
+         }
+      }
+      requests.Tick();
+   }
+};
+
+static void
+Run(size_t window, double oneWayMs, double serviceMs, int sustained)
+{
+   StandIn mixer(oneWayMs, serviceMs);
+   std::thread mixerThread(&StandIn::Run, &mixer);
+
+   Client client(mixer.sock, window);
+
+   // Startup, a few times over
+   std::vector<double> startups;
+   for (int rep = 0; rep < 20; rep++)
+   {
+      Clock::time_point t0 = Clock::now();
+      client.Select(2);
+      client.Select(0);
+      client.Select(1);
+      client.Select(2);
+      while (!client.requests.IsIdle())
+      {
+         client.Poll();
+      }
+      startups.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+   }
+   std::sort(startups.begin(), startups.end());
+
+   // Sustained
+   unsigned long done = client.requests.GetCompleted();
+   Clock::time_point t0 = Clock::now();
+   int sent = 0;
+   while (sent < sustained || !client.requests.IsIdle())
+   {
+      while (sent < sustained && client.Select(sent % 3))
+      {
+         sent++;
+      }
+      client.Poll();
+   }
+   double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+
+   mixer.running = false;
+   mixerThread.join();
+
+   printf("%6lu %12.2f %14.0f %10lu\n",
+          (unsigned long) window,
+          startups[startups.size() / 2],
+          (double) (client.requests.GetCompleted() - done) / secs,
+          client.requests.GetTimeouts());
+}
+
+int
+main(int argc, char **argv)
+{
+   double oneWayMs = argc > 1 ? atof(argv[1]) : 2.0;
+   double serviceMs = argc > 2 ? atof(argv[2]) : 0.25;
+   int sustained = argc > 3 ? atoi(argv[3]) : 1000;
+
+   printf("one way %.2f ms, service %.2f ms\n", oneWayMs, serviceMs);
+   printf("%6s %12s %14s %10s\n", "window", "startup ms", "answers/s", "timeouts");
+   for (size_t window = 1; window <= 8; window *= 2)
+   {
+      Run(window, oneWayMs, serviceMs, sustained);
+   }
+
+   return 0;
+}
@@ -0,0 +1,251 @@
+/*
+  Packets per second and client CPU spent keeping four channels fresh:
+  the fixed 50 ms poll of every channel MyFrame::OnTimer used to do,
+  against RefreshScheduler.
+
+  A TotalMix stand-in runs on its own thread over loopback and answers
+  every page 2 navigation with the echo burst of that channel (its
+  values, then its trackname).  The client runs 16 ms frames like
+  MyFrame::OnFrame.
+
+  "idle": nobody touches anything.  "active": the client changes a
+  random channel every 100 ms (what a user on the sliders does), and the
+  stand-in sends an unsolicited burst every 250 ms (somebody working in
+  the TotalMix window, which echoes the channel under its cursor).
+
+  usage: refresh [seconds per run]
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include <time.h>
+
+#include "oscpkt.h"
+#include "udp.h"
+#include "refresh.h"
+
+using namespace oscpkt;
+
+typedef std::chrono::steady_clock Clock;
+
+static const struct
+{
+   int bus;
+   const char *name;
+} Channels[] =
+{
+   { 0, "Mic 1" },
+   { 0, "SPDIF" },
+   { 1, "Main" },
+   { 1, "Speaker B" },
+};
+
+#define CHANNELS ((int) (sizeof(Channels) / sizeof(Channels[0])))
+
+static const char *Params[] = { "volume", "pan", "mute", "solo", "gain", "eqEnable", "eqGain1", "eqGain2", "eqGain3" };
+
+static double
+ThreadCpuMs()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+   return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// ====================================================================
+// Echoes whatever channel it is navigated to
+// ====================================================================
+struct StandIn
+{
+   UdpSocket sock;
+   SockAddr app;
+   std::atomic<bool> running;
+   bool active;
+
+   StandIn(bool isActive)
+   {
+      running = true;
+      active = isActive;
+      sock.bindTo(0);
+   }
+
+   void Echo(int channel)
+   {
+      PacketWriter pw;
+      Message msg;
+      pw.startBundle();
+      for (size_t i = 0; i < sizeof(Params) / sizeof(Params[0]); i++)
+      {
+         msg.init(std::string("/2/") + Params[i]).pushFloat(0.5f);
+         pw.addMessage(msg);
+      }
+      msg.init("/2/trackname").pushStr(Channels[channel].name);
+      pw.addMessage(msg);
+      pw.endBundle();
+      sock.sendPacketTo(pw.packetData(), pw.packetSize(), app);
+   }
+
+   void Run()
+   {
+      Clock::time_point nextUnsolicited = Clock::now() + std::chrono::milliseconds(250);
+      bool known = false;
+      while (running)
+      {
+         if (active && known && Clock::now() >= nextUnsolicited)
+         {
+            Echo(rand() % CHANNELS);
+            nextUnsolicited += std::chrono::milliseconds(250);
+         }
+
+         if (!sock.receiveNextPacket(5))
+         {
+            continue;
+         }
+         app = sock.packetOrigin();
+         known = true;
+
+         // The client sends the channel's index with its navigation,
+         // standing in for the cursor moves
+         PacketReader pr(sock.packetData(), sock.packetSize());
+         Message *msg;
+         while (pr.isOk() && (msg = pr.popMessage()) != 0)
+         {
+            int32_t channel;
+            if (msg->match("/2/track") && msg->arg().popInt32(channel).isOkNoMoreArgs())
+            {
+               Echo(channel);
+            }
+         }
+      }
+   }
+};
+
+static void
+Run(bool adaptive, bool active, double seconds)
+{
+   StandIn mixer(active);
+   std::thread mixerThread(&StandIn::Run, &mixer);
+
+   UdpSocket sock;
+   sock.bindTo(0);
+   SockAddr dest = mixer.sock.local_addr;
+   ((struct sockaddr_in *)&dest.addr())->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   RefreshScheduler sched;
+   for (int i = 0; i < CHANNELS; i++)
+   {
+      sched.Add(Channels[i].bus, Channels[i].name);
+   }
+
+   unsigned long sent = 0;
+   unsigned long received = 0;
+   Message msg;
+   PacketWriter pw;
+
+   Clock::time_point start = Clock::now();
+   Clock::time_point end = start + std::chrono::milliseconds((long) (seconds * 1000));
+   Clock::time_point frame = start;
+   Clock::time_point nextPoll = start;
+   Clock::time_point nextChange = start + std::chrono::milliseconds(100);
+   double cpu0 = ThreadCpuMs();
+
+   while (frame < end)
+   {
+      // Sleep until the next frame, taking what arrives meanwhile
+      frame += std::chrono::milliseconds(16);
+      for (;;)
+      {
+         int wait = (int) std::chrono::duration_cast<std::chrono::milliseconds>(frame - Clock::now()).count();
+         if (wait <= 0 || !sock.receiveNextPacket(wait))
+         {
+            break;
+         }
+         received++;
+
+         PacketReader pr(sock.packetData(), sock.packetSize());
+         Message *m;
+         std::string name;
+         while (pr.isOk() && (m = pr.popMessage()) != 0)
+         {
+            if (m->match("/2/trackname") && m->arg().popStr(name).isOkNoMoreArgs())
+            {
+               for (int i = 0; i < CHANNELS; i++)
+               {
+                  if (name == Channels[i].name)
+                  {
+                     sched.OnFresh(Channels[i].bus, name);
+                  }
+               }
+            }
+         }
+      }
+
+      Clock::time_point now = Clock::now();
+
+      if (active && now >= nextChange)
+      {
+         int i = rand() % CHANNELS;
+         msg.init("/2/volume").pushFloat((float) (rand() % 1000) / 1000.0f);
+         pw.init().addMessage(msg);
+         sock.sendPacketTo(pw.packetData(), pw.packetSize(), dest);
+         sent++;
+         sched.OnChanged(Channels[i].bus, Channels[i].name, now);
+         nextChange += std::chrono::milliseconds(100);
+      }
+
+      if (adaptive)
+      {
+         int next = sched.Next(now);
+         if (next >= 0)
+         {
+            msg.init("/2/track").pushInt32(next);
+            pw.init().addMessage(msg);
+            sock.sendPacketTo(pw.packetData(), pw.packetSize(), dest);
+            sent++;
+         }
+      }
+      else if (now >= nextPoll)
+      {
+         for (int i = 0; i < CHANNELS; i++)
+         {
+            msg.init("/2/track").pushInt32(i);
+            pw.init().addMessage(msg);
+            sock.sendPacketTo(pw.packetData(), pw.packetSize(), dest);
+            sent++;
+         }
+         nextPoll += std::chrono::milliseconds(50);
+      }
+   }
+
+   double cpu = ThreadCpuMs() - cpu0;
+   double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+   mixer.running = false;
+   mixerThread.join();
+
+   printf("%-9s %-7s %10.1f %10.1f %12.2f\n",
+          adaptive ? "adaptive" : "fixed",
+          active ? "active" : "idle",
+          sent / secs,
+          received / secs,
+          cpu / secs);
+}
+
+int
+main(int argc, char **argv)
+{
+   double seconds = argc > 1 ? atof(argv[1]) : 4.0;
+
+   printf("%-9s %-7s %10s %10s %12s\n", "refresh", "state", "sent/s", "recv/s", "cpu ms/s");
+   Run(false, false, seconds);
+   Run(false, true, seconds);
+   Run(true, false, seconds);
+   Run(true, true, seconds);
+
+   return 0;
+}
@@ -0,0 +1,39 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(STATS_H)
+#define STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// ====================================================================
+// What the benches share for reporting times: Ms() of a duration, and
+// the value at p (0 to 1) of a list of them, 0 when there are none.
+// ====================================================================
+inline double
+Ms(std::chrono::steady_clock::duration d)
+{
+   return std::chrono::duration<double, std::milli>(d).count();
+}
+
+inline double
+Percentile(std::vector<double> v, double p)
+{
+   if (v.empty())
+   {
+      return 0.0;
+   }
+   std::sort(v.begin(), v.end());
+   return v[(size_t) (p * (v.size() - 1) + 0.5)];
+}
+
+#endif
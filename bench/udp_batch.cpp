@@ -0,0 +1,100 @@
+/*
+  Loopback throughput of UdpSocket::sendBatch / receiveBatch.
+
+  Sends small (52 byte) OSC packets to ourselves over 127.0.0.1, batch by batch,
+  and reports the number of packets per second for each batch size. A
+  batch size of 1 is what receiveNextPacket / sendPacket cost.
+
+  usage: udp_batch [seconds per batch size]
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "oscpkt.h"
+#include "udp.h"
+
+using namespace oscpkt;
+
+static double
+RunBatch(UdpSocket & tx, UdpSocket & rx, const SockAddr & dest, const PacketWriter & pkt, size_t batch, double seconds)
+{
+   std::vector<PacketSlot> out(batch), in(batch);
+   std::vector<char> buffers(batch * 1024);
+   for (size_t i = 0; i < batch; i++)
+   {
+      out[i].data = const_cast<PacketWriter &>(pkt).packetData();
+      out[i].size = const_cast<PacketWriter &>(pkt).packetSize();
+      out[i].addr = dest;
+      in[i] = PacketSlot(&buffers[i * 1024], 1024);
+   }
+
+   typedef std::chrono::steady_clock Clock;
+   Clock::time_point start = Clock::now();
+   Clock::time_point stop = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+   size_t received = 0;
+   size_t lost = 0;
+
+   while (Clock::now() < stop)
+   {
+      for (int round = 0; round < 64; round++)
+      {
+         size_t sent = tx.sendBatch(&out[0], batch);
+         size_t got = 0;
+         while (got < sent)
+         {
+            size_t n = rx.receiveBatch(&in[0], sent - got, 100);
+            if (n == 0)
+            {
+               lost += sent - got;
+               break;
+            }
+            got += n;
+         }
+         received += got;
+      }
+   }
+
+   double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+   if (lost)
+   {
+      printf("  (%zu packets lost)\n", lost);
+   }
+
+   return received / elapsed;
+}
+
+int
+main(int argc, char **argv)
+{
+   double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+
+   UdpSocket rx, tx;
+   if (!rx.bindTo(0) || !tx.bindTo(0))
+   {
+      fprintf(stderr, "bind failed: %s%s\n", rx.errorMessage().c_str(), tx.errorMessage().c_str());
+      return 1;
+   }
+
+   // bound to the wildcard address, aim at the loopback interface
+   SockAddr dest = rx.local_addr;
+   ((struct sockaddr_in *)&dest.addr())->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   Message msg("/2/volume");
+   msg.pushFloat(0.5f).pushInt32(7).pushStr("abcdefghijklmnopqrstuvw");
+   PacketWriter pkt;
+   pkt.addMessage(msg);
+
+   static const size_t sizes[] = { 1, 8, 32, 64 };
+
+   printf("%8s %14s\n", "batch", "packets/s");
+   for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+   {
+      double pps = RunBatch(tx, rx, dest, pkt, sizes[i], seconds);
+      printf("%8zu %14.0f\n", sizes[i], pps);
+   }
+
+   return 0;
+}
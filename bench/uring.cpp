@@ -0,0 +1,257 @@
+/*
+  System calls and CPU time per packet of the three ways UdpSocket can
+  move datagrams on linux: one recvfrom / sendto per packet, recvmmsg /
+  sendmmsg batches, and io_uring (UdpSocket::useIoUring).
+
+  The side being measured runs on the main thread, the other side on a
+  helper thread that keeps at most a few hundred packets in flight so
+  nothing is lost in the socket buffers. CPU time is the main thread's
+  only (RUSAGE_THREAD). System calls are counted by the benchmark for the
+  socket paths, each receive / send call being at least one, and by
+  UringIo::enterCount for io_uring.
+
+  usage: uring [packets per run]
+*/
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "oscpkt.h"
+#include "udp.h"
+
+using namespace oscpkt;
+
+enum Mode
+{
+   MODE_SINGLE,
+   MODE_MMSG,
+   MODE_URING
+};
+
+static const char *ModeNames[] = { "recvfrom", "mmsg", "io_uring" };
+
+static const size_t Batch = 64;
+static const size_t InFlight = 256;
+
+static double
+ThreadCpu()
+{
+   struct rusage ru;
+   getrusage(RUSAGE_THREAD, &ru);
+   return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static SockAddr
+Loopback(const UdpSocket & sock)
+{
+   SockAddr addr = sock.local_addr;
+   ((struct sockaddr_in *)&addr.addr())->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   return addr;
+}
+
+static unsigned long
+UringEnters(UdpSocket & sock)
+{
+#ifdef OSCPKT_HAVE_IO_URING
+   return sock.uring ? sock.uring->enterCount() : 0;
+#else
+   (void) sock;
+   return 0;
+#endif
+}
+
+static void
+Report(const char *side, Mode mode, size_t packets, unsigned long calls, double cpu)
+{
+   printf("%-8s %-10s %10zu %14.3f %14.0f\n",
+          side,
+          ModeNames[mode],
+          packets,
+          (double) calls / packets,
+          cpu * 1e9 / packets);
+}
+
+// ====================================================================
+// The socket being measured receives, a plain sender feeds it
+// ====================================================================
+static void
+RunReceive(Mode mode, const PacketWriter & pkt, size_t packets)
+{
+   UdpSocket rx, tx;
+   rx.bindTo(0);
+   tx.bindTo(0);
+   if (mode == MODE_URING && !rx.useIoUring(512, 2048))
+   {
+      printf("%-8s %-10s %s\n", "receive", ModeNames[mode], "not available");
+      return;
+   }
+
+   std::atomic<size_t> received(0);
+   std::thread sender([&]()
+   {
+      std::vector<PacketSlot> out(Batch);
+      for (size_t i = 0; i < Batch; i++)
+      {
+         out[i].data = const_cast<PacketWriter &>(pkt).packetData();
+         out[i].size = const_cast<PacketWriter &>(pkt).packetSize();
+         out[i].addr = Loopback(rx);
+      }
+      size_t sent = 0;
+      while (sent < packets)
+      {
+         if (sent - received.load(std::memory_order_acquire) + Batch > InFlight)
+         {
+            std::this_thread::yield();
+            continue;
+         }
+         size_t cnt = packets - sent < Batch ? packets - sent : Batch;
+         sent += tx.sendBatch(&out[0], cnt);
+      }
+   });
+
+   std::vector<char> buffers(Batch * 2048);
+   std::vector<PacketSlot> in(Batch);
+   for (size_t i = 0; i < Batch; i++)
+   {
+      in[i] = PacketSlot(&buffers[i * 2048], 2048);
+   }
+
+   unsigned long calls = 0;
+   double cpu = ThreadCpu();
+   size_t got = 0;
+   while (got < packets)
+   {
+      size_t n;
+      if (mode == MODE_SINGLE)
+      {
+         n = rx.receiveNextPacket(100) ? 1 : 0;
+         calls++;
+      }
+      else
+      {
+         n = rx.receiveBatch(&in[0], Batch, 100);
+         calls++;
+      }
+      if (n == 0)
+      {
+         break;
+      }
+      got += n;
+      received.store(got, std::memory_order_release);
+   }
+   cpu = ThreadCpu() - cpu;
+   if (mode == MODE_URING)
+   {
+      calls = UringEnters(rx);
+   }
+
+   sender.join();
+   Report("receive", mode, got, calls, cpu);
+}
+
+// ====================================================================
+// The socket being measured sends, a plain receiver drains it
+// ====================================================================
+static void
+RunSend(Mode mode, const PacketWriter & pkt, size_t packets)
+{
+   UdpSocket rx, tx;
+   rx.bindTo(0);
+   tx.bindTo(0);
+   if (mode == MODE_URING && !tx.useIoUring(64, 2048))
+   {
+      printf("%-8s %-10s %s\n", "send", ModeNames[mode], "not available");
+      return;
+   }
+   SockAddr dest = Loopback(rx);
+
+   std::atomic<size_t> received(0);
+   std::atomic<bool> running(true);
+   std::thread receiver([&]()
+   {
+      std::vector<char> buffers(Batch * 2048);
+      std::vector<PacketSlot> in(Batch);
+      for (size_t i = 0; i < Batch; i++)
+      {
+         in[i] = PacketSlot(&buffers[i * 2048], 2048);
+      }
+      while (running)
+      {
+         size_t n = rx.receiveBatch(&in[0], Batch, 10);
+         received.fetch_add(n, std::memory_order_release);
+      }
+   });
+
+   std::vector<PacketSlot> out(Batch);
+   for (size_t i = 0; i < Batch; i++)
+   {
+      out[i].data = const_cast<PacketWriter &>(pkt).packetData();
+      out[i].size = const_cast<PacketWriter &>(pkt).packetSize();
+      out[i].addr = dest;
+   }
+
+   unsigned long calls = 0;
+   double cpu = ThreadCpu();
+   size_t sent = 0;
+   while (sent < packets)
+   {
+      if (sent - received.load(std::memory_order_acquire) + Batch > InFlight)
+      {
+         std::this_thread::yield();
+         continue;
+      }
+      size_t cnt = packets - sent < Batch ? packets - sent : Batch;
+      if (mode == MODE_SINGLE)
+      {
+         for (size_t i = 0; i < cnt; i++)
+         {
+            tx.sendPacketTo(out[i].data, out[i].size, dest);
+            calls++;
+         }
+         sent += cnt;
+      }
+      else
+      {
+         sent += tx.sendBatch(&out[0], cnt);
+         calls++;
+      }
+   }
+   cpu = ThreadCpu() - cpu;
+   if (mode == MODE_URING)
+   {
+      calls = UringEnters(tx);
+   }
+
+   running = false;
+   receiver.join();
+   Report("send", mode, sent, calls, cpu);
+}
+
+int
+main(int argc, char **argv)
+{
+   size_t packets = argc > 1 ? (size_t) atol(argv[1]) : 1000000;
+
+   Message msg("/2/volume");
+   msg.pushFloat(0.5f).pushInt32(7).pushStr("abcdefghijklmnopqrstuvw");
+   PacketWriter pkt;
+   pkt.addMessage(msg);
+
+   printf("%-8s %-10s %10s %14s %14s\n", "side", "mode", "packets", "syscalls/pkt", "cpu ns/pkt");
+   for (int mode = MODE_SINGLE; mode <= MODE_URING; mode++)
+   {
+      RunReceive((Mode) mode, pkt, packets);
+   }
+   for (int mode = MODE_SINGLE; mode <= MODE_URING; mode++)
+   {
+      RunSend((Mode) mode, pkt, packets);
+   }
+
+   return 0;
+}
@@ -0,0 +1,180 @@
+/*
+  The steady-state send path allocates nothing: a PacketQueue slot
+  filled and recycled, a PacketTemplate resent with a new value, and
+  a Mixer sending fader moves to TotalMixSim, frame after frame.
+
+  Allocations are counted by replacing the global operator new, per
+  thread, so only what the caller's thread does is counted (the I/O
+  thread and the simulator allocate as they like).  Each case warms up
+  first: buffers reach their size, the mixer learns its channels.
+
+  usage: test_alloc
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "mixer.h"
+#include "oscpkt.h"
+#include "simulator.h"
+
+using namespace oscpkt;
+
+static thread_local unsigned long Allocs;
+
+static void *
+Allocate(size_t size)
+{
+   Allocs++;
+
+   void *p = malloc(size ? size : 1);
+   if (p == NULL)
+   {
+      throw std::bad_alloc();
+   }
+   return p;
+}
+
+// Every form the default delete pairs with, so each new meets the delete
+// it expects
+void *operator new(size_t size) { return Allocate(size); }
+void *operator new[](size_t size) { return Allocate(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+static const int Warmup = 100;
+static const int Rounds = 1000;
+
+// Allocations op() makes over Rounds calls, after Warmup calls
+template <typename Op>
+static unsigned long
+Count(Op op)
+{
+   for (int i = 0; i < Warmup; i++)
+   {
+      op(i);
+   }
+
+   unsigned long before = Allocs;
+   for (int i = 0; i < Rounds; i++)
+   {
+      op(Warmup + i);
+   }
+   return Allocs - before;
+}
+
+// ====================================================================
+// A request queued, sent and recycled, like RequestWindow does
+// ====================================================================
+static void
+Queue()
+{
+   PacketQueue queue(4);
+   Message msg;
+   size_t bytes = 0;
+
+   unsigned long allocs = Count([&](int i)
+   {
+      PacketWriter *pw = queue.push();
+      pw->startBundle();
+      pw->addMessage(msg.init("/1/busInput").pushFloat(1.0f));
+      pw->addMessage(msg.init("/2/volume").pushFloat(i / 1000.0f));
+      pw->endBundle();
+      bytes += queue.front()->packetSize();
+      queue.pop();
+   });
+   CHECK(allocs == 0);
+   CHECK(bytes > 0);
+}
+
+// ====================================================================
+// A fader bundle built once, its value set and the packet copied out
+// ====================================================================
+static void
+Template()
+{
+   PacketTemplate tmpl;
+   Message msg;
+   tmpl.startBundle();
+   tmpl.addMessage(msg.init("/1/busOutput").pushFloat(1.0f));
+   tmpl.addMessage(msg.init("/2/volume").pushFloat(0.0f), 0);
+   tmpl.endBundle();
+   CHECK(tmpl.isOk() && tmpl.slotCount() == 1);
+
+   PacketWriter pw;
+   unsigned long allocs = Count([&](int i)
+   {
+      tmpl.setFloat(0, i / 1000.0f);
+      tmpl.copyTo(pw);
+   });
+   CHECK(allocs == 0);
+   CHECK(pw.packetSize() == tmpl.packetSize());
+}
+
+// ====================================================================
+// Fader moves on both pages, one per frame, through the outbox, the
+// navigation and the I/O thread's ring
+// ====================================================================
+static void
+Faders()
+{
+   // Longer than std::string keeps inline, any copy of a name allocates
+   TotalMixSim sim;
+   std::vector<std::string> names = TotalMixSim::Names("Front Analog In", 16);
+   sim.SetChannels(BUS_INPUT, names);
+   sim.SetChannels(BUS_OUTPUT, names);
+   sim.SetChannels(BUS_PLAYBACK, names);
+
+   Mixer mixer;
+   int page1 = mixer.AddControl(1, BUS_INPUT, "Front Analog In 3", "volume");
+   int page2 = mixer.AddControl(2, BUS_OUTPUT, "Front Analog In 5", "eqGain1");
+   mixer.SetSendRate(1000.0, 4);
+
+   CHECK(sim.Start(0));
+   CHECK(mixer.Start(0, "127.0.0.1", sim.GetPort()));
+   for (int i = 0; i < 300 && !mixer.IsReady(); i++)
+   {
+      mixer.Frame(false);
+      std::this_thread::sleep_for(std::chrono::milliseconds(16));
+   }
+   CHECK(mixer.IsReady());
+
+   unsigned long allocs = Count([&](int i)
+   {
+      mixer.SendFader(i % 2 ? page1 : page2, (i % 100) / 100.0f);
+      mixer.Frame(true);
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+   });
+   CHECK(allocs == 0);
+
+   // And they did get there
+   float value = 0.0f;
+   const Binding & b = mixer.GetBinding(page2);
+   for (int i = 0; i < 100 && value != 0.98f; i++)
+   {
+      mixer.Frame(true);
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      sim.GetValue(b.bus, b.channel, b.paramId, value);
+   }
+   CHECK(value == 0.98f);
+
+   mixer.Stop();
+   sim.Stop();
+}
+
+int
+main()
+{
+   Queue();
+   Template();
+   Faders();
+
+   return Finish("alloc");
+}
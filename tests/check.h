@@ -0,0 +1,32 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(CHECK_H)
+#define CHECK_H
+
+#include <cstdio>
+
+// ====================================================================
+// What the tests share: CHECK() reports a condition that does not hold
+// and carries on, main() returns Finish(), non-zero when any failed.
+// ====================================================================
+inline int Failures = 0;
+
+#define CHECK(cond) \
+   ((cond) ? (void) 0 : (void) (printf("%s:%d: failed: %s\n", __FILE__, __LINE__, #cond), Failures++))
+
+inline int
+Finish(const char *name)
+{
+   printf("%s: %s\n", name, Failures ? "FAILED" : "ok");
+   return Failures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,101 @@
+/*
+  IoThread: route ids, one per pattern; every packet queued gets out,
+  in order; and when the socket refuses them they stay queued and are
+  tried again for a while, however often the UI sends meanwhile, before
+  being given up on one at a time and counted, never lost unnoticed.
+
+  usage: test_iothread
+*/
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "check.h"
+#include "iothread.h"
+
+static void
+Routes()
+{
+   IoThread io;
+
+   int a = io.AddRoute("/1/bus*");
+   int b = io.AddRoute("/2/trackname");
+   CHECK(a != b);
+   CHECK(io.AddRoute("/1/bus*") == a);
+   int c = io.AddRoute("//level*");
+   CHECK(c != a && c != b);
+   CHECK(io.AddRoute("//level*") == c);
+   CHECK(io.AddRoute("/2/volume") != c);
+}
+
+// ====================================================================
+// A burst, bigger than a batch, to a socket of our own
+// ====================================================================
+static void
+Delivered()
+{
+   oscpkt::UdpSocket sock;
+   CHECK(sock.bindTo(0));
+
+   IoThread io;
+   CHECK(io.Start(0, "127.0.0.1", sock.boundPort()));
+
+   static const int Count = 100;
+   for (int i = 0; i < Count; i++)
+   {
+      CHECK(io.Send(&i, sizeof(i)));
+   }
+
+   int next = 0;
+   while (next < Count && sock.receiveNextPacket(1000))
+   {
+      int got = -1;
+      if (sock.packetSize() == sizeof(got))
+      {
+         memcpy(&got, sock.packetData(), sizeof(got));
+      }
+      CHECK(got == next);
+      next++;
+   }
+   CHECK(next == Count);
+   CHECK(io.GetUnsent() == 0);
+
+   io.Stop();
+}
+
+// ====================================================================
+// Broadcast without SO_BROADCAST, every send fails
+// ====================================================================
+static void
+Refused()
+{
+   IoThread io;
+   CHECK(io.Start(0, "255.255.255.255", 9));
+
+   // Each one wakes the I/O thread up for another try
+   for (int i = 0; i < 20; i++)
+   {
+      CHECK(io.Send(&i, sizeof(i)));
+   }
+   std::this_thread::sleep_for(std::chrono::milliseconds(5));
+   CHECK(io.GetUnsent() == 0);
+
+   for (int i = 0; i < 500 && io.GetUnsent() < 20; i++)
+   {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+   CHECK(io.GetUnsent() == 20);
+
+   io.Stop();
+}
+
+int
+main()
+{
+   Routes();
+   Delivered();
+   Refused();
+
+   return Finish("iothread");
+}
@@ -0,0 +1,246 @@
+/*
+  Mixer against TotalMixSim on loopback: it is only ready once every
+  control's channel is known, also when datagrams get lost on the way,
+  and the last value of every fader gets to the mixer, also when there
+  are more of them moving than the outbox holds.  And a channel past
+  the 128 the state starts with gets its echoes applied and reported.
+
+  usage: test_mixer
+*/
+
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "mixer.h"
+#include "proxy.h"
+#include "simulator.h"
+
+static void
+Setup(TotalMixSim & sim)
+{
+   sim.SetChannels(BUS_INPUT, TotalMixSim::Names("AN", 16));
+   sim.SetChannels(BUS_OUTPUT, TotalMixSim::Names("Out", 16));
+   sim.SetChannels(BUS_PLAYBACK, TotalMixSim::Names("Play", 16));
+   sim.SetSeed(1);
+}
+
+// Frames 16 ms apart, like the view's timer, until done or 5 seconds
+template <typename Done>
+static bool
+Frames(Mixer & mixer, bool holding, Done done)
+{
+   for (int i = 0; i < 300; i++)
+   {
+      mixer.Frame(holding);
+      if (done())
+      {
+         return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(16));
+   }
+   return false;
+}
+
+// ====================================================================
+// A third of what the mixer sends back is lost, the bus names included
+// ====================================================================
+static void
+Ready()
+{
+   TotalMixSim sim;
+   Setup(sim);
+
+   Impairment lossy;
+   lossy.loss = 0.3;
+   ImpairProxy proxy;
+   proxy.SetSeed(3);
+   proxy.SetImpairment(ImpairProxy::DOWN, lossy);
+
+   Mixer mixer;
+   int in = mixer.AddControl(1, BUS_INPUT, "AN 2", "volume");
+   int out = mixer.AddControl(2, BUS_OUTPUT, "Out 5", "eqGain1");
+   int play = mixer.AddControl(2, BUS_PLAYBACK, "Play 8", "pan");
+
+   CHECK(sim.Start(0));
+   CHECK(proxy.Start(0, "127.0.0.1", sim.GetPort()));
+   CHECK(mixer.Start(0, "127.0.0.1", proxy.GetPort()));
+
+   CHECK(Frames(mixer, false, [&]() { return mixer.IsReady(); }));
+   CHECK(mixer.GetBinding(in).channel == 2);
+   CHECK(mixer.GetBinding(out).channel == 5);
+   CHECK(mixer.GetBinding(play).channel == 8);
+   CHECK(proxy.GetCounters(ImpairProxy::DOWN).lost > 0);
+
+   mixer.Stop();
+   proxy.Stop();
+   sim.Stop();
+}
+
+// ====================================================================
+// 40 faders moved three times over, behind an outbox of 32
+// ====================================================================
+static void
+LastValue()
+{
+   static const char *Params[] = { "gain", "pan", "eqGain1", "eqGain2", "eqGain3" };
+
+   TotalMixSim sim;
+   Setup(sim);
+
+   Mixer mixer;
+   std::vector<int> ctrls;
+   for (int p = 0; p < 5; p++)
+   {
+      for (int c = 1; c <= 8; c++)
+      {
+         ctrls.push_back(mixer.AddControl(2, BUS_INPUT, ("AN " + std::to_string(c)).c_str(), Params[p]));
+      }
+   }
+   mixer.SetSendRate(200.0, 4);
+
+   CHECK(sim.Start(0));
+   CHECK(mixer.Start(0, "127.0.0.1", sim.GetPort()));
+   CHECK(Frames(mixer, false, [&]() { return mixer.IsReady(); }));
+
+   for (int move = 1; move <= 3; move++)
+   {
+      for (size_t i = 0; i < ctrls.size(); i++)
+      {
+         mixer.SendFader(ctrls[i], move * 0.25f + i * 0.001f);
+      }
+   }
+
+   size_t last = 0;
+   Frames(mixer, true, [&]()
+   {
+      last = 0;
+      for (size_t i = 0; i < ctrls.size(); i++)
+      {
+         const Binding & b = mixer.GetBinding(ctrls[i]);
+         float value;
+         if (sim.GetValue(b.bus, b.channel, b.paramId, value) && fabs(value - (0.75f + i * 0.001f)) < 1e-4)
+         {
+            last++;
+         }
+      }
+      return last == ctrls.size();
+   });
+   CHECK(last == ctrls.size());
+
+   mixer.Stop();
+   sim.Stop();
+}
+
+// ====================================================================
+// A stand-in for the mixer, answering the bus selections with the
+// names given (by strip number, offset 0) and nothing else
+// ====================================================================
+static void
+Answer(oscpkt::UdpSocket & sock, const std::vector<std::string> names[BUS_COUNT], oscpkt::SockAddr & client)
+{
+   static const char *Buses[BUS_COUNT] = { "/1/busInput", "/1/busOutput", "/1/busPlayback" };
+
+   while (sock.receiveNextPacket(0))
+   {
+      client = sock.packetOrigin();
+
+      oscpkt::PacketReader pr(sock.packetData(), sock.packetSize());
+      oscpkt::Message *msg;
+      while (pr.isOk() && (msg = pr.popMessage()) != NULL)
+      {
+         for (int b = 0; b < BUS_COUNT; b++)
+         {
+            if (msg->addressPattern() != Buses[b])
+            {
+               continue;
+            }
+
+            oscpkt::PacketWriter pw;
+            pw.startBundle();
+            pw.addMessage(oscpkt::Message(Buses[b]).pushFloat(1.0f));
+            for (size_t i = 0; i < names[b].size(); i++)
+            {
+               if (!names[b][i].empty())
+               {
+                  pw.addMessage(oscpkt::Message("/1/trackname" + std::to_string(i + 1)).pushStr(names[b][i]));
+               }
+            }
+            pw.endBundle();
+            sock.sendPacketTo(pw.packetData(), pw.packetSize(), client);
+         }
+      }
+   }
+}
+
+// ====================================================================
+// Channel 150 of an interface that wide, echoed without being asked
+// ====================================================================
+static void
+Wide()
+{
+   std::vector<std::string> names[BUS_COUNT];
+   names[BUS_INPUT].resize(150);
+   names[BUS_INPUT][0] = "AN 1";
+   names[BUS_INPUT][149] = "AN 150";
+   names[BUS_OUTPUT].push_back("Out 1");
+   names[BUS_PLAYBACK].push_back("Play 1");
+
+   oscpkt::UdpSocket sock;
+   CHECK(sock.bindTo(0));
+   oscpkt::SockAddr client;
+
+   Mixer mixer;
+   int far = mixer.AddControl(2, BUS_INPUT, "AN 150", "volume");
+   mixer.Watch(far);
+
+   float reported = -1.0f;
+   mixer.SetListener([&](int ctrl, float value)
+   {
+      if (ctrl == far)
+      {
+         reported = value;
+      }
+   });
+
+   CHECK(mixer.Start(0, "127.0.0.1", sock.boundPort()));
+   CHECK(Frames(mixer, false, [&]()
+   {
+      Answer(sock, names, client);
+      return mixer.IsReady();
+   }));
+   CHECK(mixer.GetBinding(far).channel == 150);
+
+   // What the mixer sends when the cursor lands there, whoever moved it
+   oscpkt::PacketWriter pw;
+   pw.startBundle();
+   pw.addMessage(oscpkt::Message("/2/volume").pushFloat(0.375f));
+   pw.addMessage(oscpkt::Message("/2/trackname").pushStr("AN 150"));
+   pw.endBundle();
+   CHECK(sock.sendPacketTo(pw.packetData(), pw.packetSize(), client));
+
+   CHECK(Frames(mixer, false, [&]()
+   {
+      Answer(sock, names, client);
+      return reported >= 0.0f;
+   }));
+   CHECK(reported == 0.375f);
+
+   const MixerState::Entry *e = mixer.GetState().Get(BUS_INPUT, 150, PARAM_VOLUME);
+   CHECK(e != NULL && e->value == 0.375f);
+
+   mixer.Stop();
+}
+
+int
+main()
+{
+   Ready();
+   LastValue();
+   Wide();
+
+   return Finish("mixer");
+}
@@ -0,0 +1,160 @@
+/*
+  MixerState: parameter ids, versions bumped only by a change, range
+  checks, bursts, the walk over what changed since a version, and
+  growing past the channels it started with.
+
+  usage: test_mixerstate
+*/
+
+#include <cstring>
+#include <vector>
+
+#include "check.h"
+#include "mixerstate.h"
+
+struct Change
+{
+   int bus;
+   int channel;
+   int param;
+   float value;
+};
+
+static void
+Ids()
+{
+   CHECK(MixerState::ParamId("/2/volume") == PARAM_VOLUME);
+   CHECK(MixerState::ParamId("/1/volume") == PARAM_VOLUME);
+   CHECK(MixerState::ParamId("eqGain1") == PARAM_EQ_GAIN1);
+   CHECK(MixerState::ParamId("/2/eqGain3") == PARAM_EQ_GAIN3);
+   CHECK(MixerState::ParamId("/2/eqGain") == -1);
+   CHECK(MixerState::ParamId("/2/trackname") == -1);
+   CHECK(strcmp(MixerState::ParamName(PARAM_GAIN), "gain") == 0);
+   CHECK(strcmp(MixerState::ParamName(PARAM_COUNT), "") == 0);
+}
+
+static void
+Versions()
+{
+   MixerState state(3, 8);
+
+   CHECK(state.GetVersion() == 0);
+   CHECK(state.Get(1, 1, PARAM_VOLUME) != NULL && state.Get(1, 1, PARAM_VOLUME)->version == 0);
+
+   CHECK(state.Set(1, 1, PARAM_VOLUME, 0.5f));
+   CHECK(state.GetVersion() == 1);
+   CHECK(!state.Set(1, 1, PARAM_VOLUME, 0.5f));
+   CHECK(state.GetVersion() == 1);
+   CHECK(state.Set(1, 1, PARAM_VOLUME, 0.25f));
+   CHECK(state.Get(1, 1, PARAM_VOLUME)->version == 2);
+   CHECK(state.Get(1, 1, PARAM_VOLUME)->value == 0.25f);
+
+   // A first value is a change even when it is the one an entry starts with
+   CHECK(state.Set(2, 8, PARAM_MUTE, 0.0f));
+
+   // Channels are 1 based
+   CHECK(!state.Set(1, 0, PARAM_VOLUME, 1.0f));
+   CHECK(!state.Set(1, 9, PARAM_VOLUME, 1.0f));
+   CHECK(!state.Set(3, 1, PARAM_VOLUME, 1.0f));
+   CHECK(!state.Set(0, 1, PARAM_COUNT, 1.0f));
+   CHECK(!state.Set(0, 1, -1, 1.0f));
+   CHECK(state.Get(-1, 1, PARAM_VOLUME) == NULL);
+   CHECK(state.Get(0, 9, PARAM_VOLUME) == NULL);
+   CHECK(state.GetVersion() == 3);
+
+   // Forgets the values, not the count
+   state.Clear();
+   CHECK(state.Get(1, 1, PARAM_VOLUME)->version == 0);
+   CHECK(state.Set(1, 1, PARAM_VOLUME, 0.25f));
+   CHECK(state.GetVersion() == 4);
+}
+
+static void
+Changes()
+{
+   MixerState state(3, 8);
+
+   ParamValues burst;
+   burst.Set(PARAM_VOLUME, 0.5f);
+   burst.Set(PARAM_PAN, 0.5f);
+   burst.Set(PARAM_EQ_GAIN2, 0.75f);
+   CHECK(state.Apply(0, 3, burst) == 3);
+   CHECK(state.Apply(0, 3, burst) == 0);
+
+   uint32_t seen = state.GetVersion();
+   burst.Clear();
+   burst.Set(PARAM_PAN, 0.25f);
+   CHECK(state.Apply(0, 3, burst) == 1);
+   CHECK(state.Set(2, 7, PARAM_SOLO, 1.0f));
+
+   std::vector<Change> changes;
+   state.ForEachChanged(seen, [&](int bus, int channel, int param, float value)
+   {
+      changes.push_back(Change { bus, channel, param, value });
+   });
+   CHECK(changes.size() == 2);
+   if (changes.size() == 2)
+   {
+      CHECK(changes[0].bus == 0 && changes[0].channel == 3 && changes[0].param == PARAM_PAN);
+      CHECK(changes[0].value == 0.25f);
+      CHECK(changes[1].bus == 2 && changes[1].channel == 7 && changes[1].param == PARAM_SOLO);
+   }
+
+   changes.clear();
+   state.ForEachChanged(state.GetVersion(), [&](int bus, int channel, int param, float value)
+   {
+      changes.push_back(Change { bus, channel, param, value });
+   });
+   CHECK(changes.empty());
+}
+
+static void
+Grow()
+{
+   MixerState state(3, 128);
+
+   CHECK(state.Set(1, 128, PARAM_VOLUME, 0.5f));
+   CHECK(state.Set(2, 1, PARAM_PAN, 0.25f));
+   CHECK(!state.Set(1, 196, PARAM_VOLUME, 0.75f));
+
+   state.Grow(100);
+   CHECK(state.GetChannels() == 128);
+
+   uint32_t seen = state.GetVersion();
+   state.Grow(196);
+   CHECK(state.GetChannels() >= 196);
+   CHECK(state.GetVersion() == seen);
+
+   // Everything where it was, versions included
+   CHECK(state.Get(1, 128, PARAM_VOLUME)->value == 0.5f);
+   CHECK(state.Get(1, 128, PARAM_VOLUME)->version == 1);
+   CHECK(state.Get(2, 1, PARAM_PAN)->value == 0.25f);
+   CHECK(state.Get(0, 128, PARAM_VOLUME)->version == 0);
+   CHECK(state.Get(1, 129, PARAM_VOLUME)->version == 0);
+
+   CHECK(state.Set(1, 196, PARAM_VOLUME, 0.75f));
+
+   std::vector<Change> changes;
+   state.ForEachChanged(0, [&](int bus, int channel, int param, float value)
+   {
+      changes.push_back(Change { bus, channel, param, value });
+   });
+   CHECK(changes.size() == 3);
+   if (changes.size() == 3)
+   {
+      CHECK(changes[0].bus == 1 && changes[0].channel == 128);
+      CHECK(changes[1].bus == 1 && changes[1].channel == 196 && changes[1].value == 0.75f);
+      CHECK(changes[2].bus == 2 && changes[2].channel == 1);
+   }
+}
+
+int
+main()
+{
+   Ids();
+   Versions();
+   Changes();
+   Grow();
+
+   return Finish("mixerstate");
+}
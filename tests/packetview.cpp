@@ -0,0 +1,334 @@
+/*
+  PacketViewReader against PacketReader, differentially: for every
+  packet, both accept it or both reject it with the same error, and when
+  they accept it they hand out the same messages, with the same time
+  tags, addresses, type tags and argument values.
+
+  The packets are the seed files given (or every file in the
+  directories given) and, for each, a number of mutations of it: bits
+  flipped, bytes and size words set to the values parsers trip on,
+  truncations, words dropped or repeated, and splices with another seed.
+  The mutations are seeded, a run always checks the same packets.
+
+  A file given alone (mutations 0) replays just that packet.
+
+  usage: test_packetview [mutations per seed] file|directory ...
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "oscpkt.h"
+
+using namespace oscpkt;
+
+typedef std::vector<char> Packet;
+
+static unsigned long Checked;
+static unsigned long Rejected;
+
+static unsigned int Seed = 1;
+
+// xorshift
+static unsigned int
+Random(unsigned int range)
+{
+   Seed ^= Seed << 13;
+   Seed ^= Seed >> 17;
+   Seed ^= Seed << 5;
+
+   return range ? Seed % range : 0;
+}
+
+// ====================================================================
+// Every argument popped by its type tag, from both
+// ====================================================================
+static bool
+SameArgs(Message & msg, const MessageView & view)
+{
+   Message::ArgReader a = msg.arg();
+   MessageView::ArgReader b = view.arg();
+
+   for (const char *tag = view.typeTags(); *tag; tag++)
+   {
+      bool same = true;
+      switch (*tag)
+      {
+         case TYPE_TAG_INT32:
+         {
+            int32_t x, y;
+            a.popInt32(x);
+            b.popInt32(y);
+            same = x == y;
+         }
+         break;
+
+         case TYPE_TAG_INT64:
+         {
+            int64_t x, y;
+            a.popInt64(x);
+            b.popInt64(y);
+            same = x == y;
+         }
+         break;
+
+         // Bit for bit, NaNs included
+         case TYPE_TAG_FLOAT:
+         {
+            float x, y;
+            a.popFloat(x);
+            b.popFloat(y);
+            same = memcmp(&x, &y, sizeof(x)) == 0;
+         }
+         break;
+
+         case TYPE_TAG_DOUBLE:
+         {
+            double x, y;
+            a.popDouble(x);
+            b.popDouble(y);
+            same = memcmp(&x, &y, sizeof(x)) == 0;
+         }
+         break;
+
+         case TYPE_TAG_STRING:
+         {
+            std::string x, y;
+            a.popStr(x);
+            b.popStr(y);
+            same = x == y;
+         }
+         break;
+
+         case TYPE_TAG_BLOB:
+         {
+            std::vector<char> x, y;
+            a.popBlob(x);
+            b.popBlob(y);
+            same = x == y;
+         }
+         break;
+
+         case TYPE_TAG_TRUE:
+         case TYPE_TAG_FALSE:
+         {
+            bool x, y;
+            a.popBool(x);
+            b.popBool(y);
+            same = x == y;
+         }
+         break;
+
+         default:
+            a.pop();
+            b.pop();
+         break;
+      }
+
+      if (!same || a.getErr() != b.getErr())
+      {
+         return false;
+      }
+   }
+
+   return a.isOkNoMoreArgs() == b.isOkNoMoreArgs();
+}
+
+// ====================================================================
+// One packet through both readers, false when they disagree
+// ====================================================================
+static bool
+Same(const char *data, size_t size)
+{
+   PacketReader reader(data, size);
+   PacketViewReader viewer(data, size);
+
+   Checked++;
+   if (reader.getErr() != viewer.getErr())
+   {
+      return false;
+   }
+   if (!reader.isOk())
+   {
+      Rejected++;
+   }
+
+   for (;;)
+   {
+      Message *msg = reader.popMessage();
+      const MessageView *view = viewer.popMessage();
+      if (msg == NULL || view == NULL)
+      {
+         return msg == NULL && view == NULL;
+      }
+
+      if ((uint64_t) msg->timeTag() != (uint64_t) view->timeTag() ||
+          msg->addressPattern() != view->addressPattern() ||
+          msg->typeTags() != view->typeTags() ||
+          msg->getErr() != view->getErr() ||
+          !SameArgs(*msg, *view))
+      {
+         return false;
+      }
+   }
+}
+
+static void
+Report(const Packet & p, const char *what)
+{
+   printf("differs on %s:", what);
+   for (size_t i = 0; i < p.size(); i++)
+   {
+      printf("%s%02x", i % 4 ? "" : " ", (unsigned char) p[i]);
+   }
+   printf("\n");
+   Failures++;
+}
+
+// ====================================================================
+// A few changes to p, of the kind that break a parser
+// ====================================================================
+static void
+Mutate(Packet & p, const std::vector<Packet> & seeds)
+{
+   static const unsigned char Bytes[] = { 0x00, 0xff, 0x7f, 0x80, '#', ',', '/', 'b', 's', 'i', 'T' };
+   static const uint32_t Words[] = { 0, 4, 8, 12, 16, 0x7ffffffc, 0x80000000, 0xfffffffc, 0xffffffff, 3 };
+
+   for (int n = 1 + Random(4); n > 0; n--)
+   {
+      size_t words = p.size() / 4;
+      switch (Random(7))
+      {
+         case 0:
+            if (!p.empty())
+            {
+               p[Random(p.size())] ^= (char) (1 << Random(8));
+            }
+         break;
+
+         case 1:
+            if (!p.empty())
+            {
+               p[Random(p.size())] = (char) Bytes[Random(sizeof(Bytes))];
+            }
+         break;
+
+         // Size fields are big endian words
+         case 2:
+            if (words > 0)
+            {
+               uint32_t w = Words[Random(sizeof(Words) / sizeof(Words[0]))];
+               if (Random(3) == 0)
+               {
+                  w = (uint32_t) p.size() - 4 * Random((unsigned int) words + 1);
+               }
+               pod2bytes<uint32_t>(w, &p[4 * Random((unsigned int) words)]);
+            }
+         break;
+
+         case 3:
+            p.resize(Random(4) == 0 ? Random((unsigned int) p.size() + 1) : 4 * Random((unsigned int) words + 1));
+         break;
+
+         case 4:
+            if (words > 0)
+            {
+               size_t w = Random((unsigned int) words);
+               p.erase(p.begin() + 4 * w, p.begin() + 4 * w + 4);
+            }
+         break;
+
+         case 5:
+            if (words > 0)
+            {
+               size_t w = Random((unsigned int) words);
+               Packet word(p.begin() + 4 * w, p.begin() + 4 * w + 4);
+               p.insert(p.begin() + 4 * w, word.begin(), word.end());
+            }
+         break;
+
+         case 6:
+         {
+            const Packet & other = seeds[Random((unsigned int) seeds.size())];
+            size_t keep = 4 * Random((unsigned int) words + 1);
+            size_t from = 4 * Random((unsigned int) other.size() / 4 + 1);
+            p.resize(keep);
+            p.insert(p.end(), other.begin() + from, other.end());
+         }
+         break;
+      }
+   }
+}
+
+static bool
+Load(const std::filesystem::path & path, std::vector<Packet> & seeds, std::vector<std::string> & names)
+{
+   std::ifstream in(path, std::ios::binary);
+   if (!in)
+   {
+      printf("cannot read %s\n", path.string().c_str());
+      return false;
+   }
+
+   seeds.push_back(Packet(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+   names.push_back(path.filename().string());
+   return true;
+}
+
+int
+main(int argc, char **argv)
+{
+   if (argc < 3)
+   {
+      printf("usage: test_packetview [mutations per seed] file|directory ...\n");
+      return 2;
+   }
+
+   long mutations = atol(argv[1]);
+   std::vector<Packet> seeds;
+   std::vector<std::string> names;
+   for (int i = 2; i < argc; i++)
+   {
+      if (std::filesystem::is_directory(argv[i]))
+      {
+         for (const std::filesystem::directory_entry & entry : std::filesystem::directory_iterator(argv[i]))
+         {
+            CHECK(Load(entry.path(), seeds, names));
+         }
+      }
+      else
+      {
+         CHECK(Load(argv[i], seeds, names));
+      }
+   }
+   CHECK(!seeds.empty());
+
+   for (size_t s = 0; s < seeds.size(); s++)
+   {
+      Seed = 1 + (unsigned int) s;
+
+      if (!Same(seeds[s].data(), seeds[s].size()))
+      {
+         Report(seeds[s], names[s].c_str());
+      }
+
+      for (long m = 0; m < mutations; m++)
+      {
+         Packet p = seeds[s];
+         Mutate(p, seeds);
+         if (!Same(p.data(), p.size()) && Failures < 10)
+         {
+            Report(p, ("a mutation of " + names[s]).c_str());
+         }
+      }
+   }
+
+   printf("%lu packets, %lu rejected by both\n", Checked, Rejected);
+   return Finish("packetview");
+}
@@ -0,0 +1,135 @@
+/*
+  CompiledPattern against fullPatternMatch() and partialPatternMatch():
+  the patterns Tuba registers, the quirks the two share, patterns that
+  make the backtracking explode, and random patterns and paths built
+  from the pieces that interact the most.
+
+  usage: test_pattern [random cases]
+*/
+
+#include <cstdlib>
+#include <string>
+
+#include "check.h"
+#include "oscpkt.h"
+
+using namespace oscpkt;
+
+// The same answer both ways, and for a path that is not NUL terminated
+static bool
+Same(const std::string & pattern, const std::string & path)
+{
+   CompiledPattern compiled(pattern);
+   std::string padded = path + "/ab";
+
+   bool full = fullPatternMatch(pattern, path);
+   return compiled.fullMatch(path) == full &&
+          compiled.fullMatch(padded.c_str(), path.size()) == full &&
+          compiled.partialMatch(path) == partialPatternMatch(pattern, path);
+}
+
+static void
+Fixed()
+{
+   static const char *Cases[][2] =
+   {
+      { "/2/volume",            "/2/volume"      },
+      { "/2/volume",            "/2/volume1"     },
+      { "/2/volume",            "/2/vol"         },
+      { "/2/{volume,pan,gain}", "/2/gain"        },
+      { "/2/{volume,pan,gain}", "/2/mute"        },
+      { "/1/volume*",           "/1/volume12"    },
+      { "/1/volume*",           "/1/volume1/x"   },
+      { "//trackname",          "/2/trackname"   },
+      { "//trackname",          "/trackname"     },
+      { "//level*Left",         "/1/level12Left" },
+      { "/1/bus*",              "/1/busInput"    },
+      { "/?/volume",            "/2/volume"      },
+      { "/[12]/volume",         "/3/volume"      },
+      { "/[!1]/volume",         "/2/volume"      },
+      { "{a,ab}b",              "abb"            },  // commits to the first alternative that fits
+      { "{,a}b",                "ab"             },
+      { "?",                    "/"              },  // '?' and '[]' match '/' too
+      { "[a",                   "a"              },  // no closing bracket
+      { "{a",                   "a"              },  // no closing brace
+      { "",                     ""               },
+      { "*",                    ""               },
+   };
+
+   for (size_t i = 0; i < sizeof(Cases) / sizeof(Cases[0]); i++)
+   {
+      if (!Same(Cases[i][0], Cases[i][1]))
+      {
+         printf("differs: '%s' '%s'\n", Cases[i][0], Cases[i][1]);
+         Failures++;
+      }
+   }
+
+   CHECK(CompiledPattern("/2/{volume,pan,gain}").fullMatch("/2/pan"));
+   CHECK(!CompiledPattern("/1/volume*").fullMatch("/1/volume1/x"));
+   CHECK(CompiledPattern("//trackname").fullMatch("/2/trackname"));
+}
+
+// Far too slow for fullPatternMatch() to be the reference
+static void
+Pathological()
+{
+   std::string as(200, 'a');
+   CHECK(!CompiledPattern("*a*a*a*a*a*a*b*").fullMatch(as));
+   CHECK(CompiledPattern("*a*a*a*a*a*a*").fullMatch(as));
+   CHECK(CompiledPattern("*a*a*a*a*a*a*b").fullMatch(as + "b"));
+
+   std::string slashes;
+   for (int i = 0; i < 100; i++)
+   {
+      slashes += "/a";
+   }
+   CHECK(!CompiledPattern("//a//a//a//a//b//*").fullMatch(slashes));
+   CHECK(CompiledPattern("//a//a//a//a//a").fullMatch(slashes));
+   CHECK(CompiledPattern("//a//a//a//a//b").fullMatch(slashes + "/b"));
+}
+
+static void
+Random(long cases)
+{
+   static const char *Atoms[] =
+   {
+      "/", "//", "a", "b", "ab", "?", "*", "**", "[ab]", "[!a]", "[a-c]",
+      "{a,b}", "{ab,a}", "{,a}", "{a,}", "{b", "[a", "x", "/a", "/b", ""
+   };
+   static const char PathChars[] = "/ab/xc";
+
+   int atoms = (int) (sizeof(Atoms) / sizeof(Atoms[0]));
+   long bad = 0;
+   srand(1);
+   for (long i = 0; i < cases; i++)
+   {
+      std::string pattern;
+      std::string path;
+      for (int n = rand() % 9; n > 0; n--)
+      {
+         pattern += Atoms[rand() % atoms];
+      }
+      for (int n = rand() % 12; n > 0; n--)
+      {
+         path += PathChars[rand() % 6];
+      }
+
+      if (!Same(pattern, path) && bad++ < 10)
+      {
+         printf("differs: '%s' '%s'\n", pattern.c_str(), path.c_str());
+      }
+   }
+
+   Failures += (int) bad;
+}
+
+int
+main(int argc, char **argv)
+{
+   Fixed();
+   Pathological();
+   Random(argc > 1 ? atol(argv[1]) : 200000);
+
+   return Finish("pattern");
+}
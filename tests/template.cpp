@@ -0,0 +1,157 @@
+/*
+  PacketTemplate: with its slots patched, a copy of the packet is, byte
+  for byte, the packet PacketWriter builds from scratch with the same
+  values.  Slots in nested bundles, between arguments of every size,
+  and the slots it refuses.
+
+  usage: test_template
+*/
+
+#include <cstring>
+#include <vector>
+
+#include "check.h"
+#include "oscpkt.h"
+
+using namespace oscpkt;
+
+static char Blob[] = { 1, 2, 3, 4, 5 };
+
+// ====================================================================
+// The packet, built in one go, or with slots as a template: a float or
+// an int32 of four of its messages, one of them in a nested bundle
+// ====================================================================
+template <typename Writer>
+static void
+Build(Writer & w, float gain, int32_t track, float pan, float volume, bool slots)
+{
+   Message msg;
+
+   w.startBundle();
+   w.addMessage(msg.init("/1/busInput").pushFloat(1.0f));
+
+   w.startBundle(TimeTag(0x0102030405060708ULL));
+   msg.init("/2/eqGain1").pushInt32(3).pushStr("Main").pushFloat(gain).pushBlob(Blob, sizeof(Blob)).pushBool(true);
+   slots ? w.addMessage(msg, 2) : w.addMessage(msg);
+   msg.init("/2/track").pushStr("Speaker B").pushInt32(track);
+   slots ? w.addMessage(msg, 1) : w.addMessage(msg);
+   w.endBundle();
+
+   msg.init("/2/pan").pushFloat(pan).pushDouble(0.25);
+   slots ? w.addMessage(msg, 0) : w.addMessage(msg);
+   msg.init("/2/volume").pushFloat(volume);
+   slots ? w.addMessage(msg, 0) : w.addMessage(msg);
+   w.endBundle();
+}
+
+// PacketWriter::addMessage() has no slot argument
+struct Plain
+{
+   PacketWriter pw;
+
+   void startBundle(TimeTag tt = TimeTag::immediate()) { pw.startBundle(tt); }
+   void endBundle() { pw.endBundle(); }
+   void addMessage(const Message & msg) { pw.addMessage(msg); }
+   void addMessage(const Message & msg, size_t) { pw.addMessage(msg); }
+};
+
+static bool
+Same(PacketTemplate & tmpl, float gain, int32_t track, float pan, float volume)
+{
+   PacketWriter copy;
+   copy.init();
+   tmpl.copyTo(copy);
+
+   Plain plain;
+   Build(plain, gain, track, pan, volume, false);
+
+   return plain.pw.isOk() && copy.packetSize() == plain.pw.packetSize() &&
+          memcmp(copy.packetData(), plain.pw.packetData(), copy.packetSize()) == 0;
+}
+
+static void
+Patched()
+{
+   PacketTemplate tmpl;
+   Build(tmpl, 0.0f, 0, 0.0f, 0.0f, true);
+   CHECK(tmpl.isOk());
+   CHECK(tmpl.slotCount() == 4);
+   CHECK(Same(tmpl, 0.0f, 0, 0.0f, 0.0f));
+
+   static const struct
+   {
+      float gain;
+      int32_t track;
+      float pan;
+      float volume;
+   }
+   Values[] =
+   {
+      { 0.5f,    1,          0.25f, 1.0f   },
+      { -3.75f,  -1,         1.0f,  0.001f },
+      { 1e-30f,  0x7fffffff, 0.0f,  0.999f },
+   };
+
+   for (size_t i = 0; i < sizeof(Values) / sizeof(Values[0]); i++)
+   {
+      CHECK(tmpl.setFloat(0, Values[i].gain));
+      CHECK(tmpl.setInt32(1, Values[i].track));
+      CHECK(tmpl.setFloat(2, Values[i].pan));
+      CHECK(tmpl.setFloat(3, Values[i].volume));
+      CHECK(Same(tmpl, Values[i].gain, Values[i].track, Values[i].pan, Values[i].volume));
+   }
+
+   // And read back as such
+   PacketReader pr(tmpl.packetData(), tmpl.packetSize());
+   Message *msg;
+   int count = 0;
+   while (pr.isOk() && (msg = pr.popMessage()) != NULL)
+   {
+      if (msg->addressPattern() == "/2/track")
+      {
+         std::string name;
+         int32_t track;
+         CHECK(msg->arg().popStr(name).popInt32(track).isOkNoMoreArgs());
+         CHECK(name == "Speaker B" && track == 0x7fffffff);
+      }
+      count++;
+   }
+   CHECK(count == 5);
+}
+
+static void
+Refused()
+{
+   PacketTemplate tmpl;
+   Message msg("/2/eqGain1");
+   msg.pushInt32(3).pushStr("Main").pushFloat(0.5f);
+
+   // Not a float or an int32, not an argument at all
+   tmpl.startBundle().addMessage(msg, 1);
+   CHECK(tmpl.getErr() == TYPE_MISMATCH);
+   tmpl.init().startBundle().addMessage(msg, 3);
+   CHECK(tmpl.getErr() == NOT_ENOUGH_ARG);
+   CHECK(tmpl.packetSize() == 0);
+
+   tmpl.init().startBundle().addMessage(msg, 0).addMessage(msg, 2).endBundle();
+   CHECK(tmpl.isOk() && tmpl.slotCount() == 2);
+   CHECK(!tmpl.setFloat(0, 1.0f));
+   CHECK(!tmpl.setInt32(1, 1));
+   CHECK(!tmpl.setFloat(2, 1.0f));
+   CHECK(tmpl.setInt32(0, 4) && tmpl.setFloat(1, 0.75f));
+
+   PacketWriter pw;
+   pw.startBundle().addMessage(Message("/2/eqGain1").pushInt32(4).pushStr("Main").pushFloat(0.5f));
+   pw.addMessage(Message("/2/eqGain1").pushInt32(3).pushStr("Main").pushFloat(0.75f)).endBundle();
+   CHECK(pw.packetSize() == tmpl.packetSize());
+   CHECK(memcmp(pw.packetData(), tmpl.packetData(), pw.packetSize()) == 0);
+}
+
+int
+main()
+{
+   Patched();
+   Refused();
+
+   return Finish("template");
+}
@@ -0,0 +1,145 @@
+/*
+  RequestWindow: the window is filled in order, an echo completes the
+  oldest request waiting for it, and a request whose echo does not come
+  is sent again with the timeout doubling each time before it is given
+  up on.
+
+  Time is passed to Tick(), nothing goes on the wire.
+
+  usage: test_window
+*/
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "window.h"
+
+using namespace oscpkt;
+
+typedef RequestWindow::Clock Clock;
+
+// The address of each packet sent, in order
+static std::vector<std::string> Sent;
+
+static bool
+Record(const void *data, size_t size)
+{
+   PacketReader pr(data, size);
+   Message *msg = pr.popMessage();
+   Sent.push_back(msg ? msg->addressPattern() : "?");
+   return true;
+}
+
+static Clock::time_point
+After(Clock::time_point start, int ms)
+{
+   return start + std::chrono::milliseconds(ms);
+}
+
+// ====================================================================
+// Two in flight at a time, the rest wait their turn
+// ====================================================================
+static void
+Window()
+{
+   RequestWindow window(2, 8, 250, 3);
+   window.SetSender(Record);
+   Sent.clear();
+
+   Message msg;
+   CHECK(window.Send(msg.init("/1/busInput").pushFloat(1.0f)));
+   CHECK(window.Send(msg.init("/1/busOutput").pushFloat(1.0f)));
+   CHECK(window.Send(msg.init("/1/busPlayback").pushFloat(1.0f)));
+   CHECK(Sent.size() == 2);
+   CHECK(window.GetInFlight() == 2);
+   CHECK(window.GetQueued() == 1);
+
+   // Out of order: completes the second, which lets the third go
+   CHECK(window.OnEcho("/1/busOutput"));
+   CHECK(Sent.size() == 3 && Sent[2] == "/1/busPlayback");
+   CHECK(!window.OnEcho("/1/volume1"));
+
+   CHECK(window.OnEcho("/1/busInput"));
+   CHECK(window.OnEcho("/1/busPlayback"));
+   CHECK(window.IsIdle());
+   CHECK(window.GetCompleted() == 3);
+   CHECK(window.GetTimeouts() == 0);
+}
+
+// ====================================================================
+// Sent again after 250, 500 and 1000 ms more, given up on after that
+// ====================================================================
+static void
+Resend()
+{
+   RequestWindow window(1, 8, 250, 3);
+   window.SetSender(Record);
+   Sent.clear();
+
+   Message msg;
+   Clock::time_point start = Clock::now();
+   CHECK(window.Send(msg.init("/1/busInput").pushFloat(1.0f)));
+   CHECK(window.Send(msg.init("/1/busOutput").pushFloat(1.0f)));
+   CHECK(Sent.size() == 1);
+
+   // Due 250 ms after the send, then 500, 1000 and 2000 ms after each
+   // resend
+   static const int Ticks[] = { 100, 300, 600, 800, 1500, 1800, 3000, 3800 };
+   static const size_t Resends[] = { 0, 1, 1, 2, 2, 3, 3, 3 };
+   for (size_t i = 0; i < sizeof(Ticks) / sizeof(Ticks[0]); i++)
+   {
+      window.Tick(After(start, Ticks[i]));
+      CHECK(window.GetResends() == Resends[i]);
+   }
+   CHECK(window.GetTimeouts() == 1);
+   CHECK(Sent.size() == 5);
+   CHECK(Sent[3] == "/1/busInput");
+
+   // The one behind it went out when it was given up on
+   CHECK(Sent[4] == "/1/busOutput");
+   CHECK(window.GetInFlight() == 1);
+   CHECK(window.OnEcho("/1/busOutput"));
+   CHECK(window.IsIdle());
+}
+
+// ====================================================================
+// An echo to a resent request completes it like any other
+// ====================================================================
+static void
+Recovered()
+{
+   RequestWindow window(1, 8, 250, 3);
+   window.SetSender(Record);
+   Sent.clear();
+
+   Message msg;
+   Clock::time_point start = Clock::now();
+   CHECK(window.Send(msg.init("/1/busInput").pushFloat(1.0f)));
+   window.Tick(After(start, 300));
+   CHECK(Sent.size() == 2);
+   CHECK(window.OnEcho("/1/busInput"));
+   CHECK(window.IsIdle());
+   CHECK(window.GetCompleted() == 1);
+   CHECK(window.GetTimeouts() == 0);
+
+   // No retries: the first timeout gives up
+   window.SetRetries(0);
+   start = Clock::now();
+   CHECK(window.Send(msg.init("/1/busOutput").pushFloat(1.0f)));
+   window.Tick(After(start, 300));
+   CHECK(window.IsIdle());
+   CHECK(window.GetTimeouts() == 1);
+   CHECK(window.GetResends() == 1);
+}
+
+int
+main()
+{
+   Window();
+   Resend();
+   Recovered();
+
+   return Finish("window");
+}
@@ -0,0 +1,118 @@
+/*
+  A UDP proxy that impairs the traffic between Tuba and a mixer (see
+  ImpairProxy): point Tuba at its port and it at the mixer, or at
+  totalmix.
+
+  Options in upper case impair the replies (mixer to Tuba), the same
+  ones in lower case the requests (Tuba to mixer).  Probabilities are
+  0 - 1, times milliseconds.
+
+  Prints both directions' counters once per second.
+
+  usage: impair [-p listen port] [-h mixer host] [-r mixer port] [-s seed] [-t seconds]
+                [-x|-X loss] [-u|-U duplicate] [-o|-O reorder] [-g|-G reorder ms]
+                [-d|-D delay ms] [-j|-J jitter ms] [-b|-B packets/s] [-n|-N burst]
+*/
+
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "proxy.h"
+
+static void
+Usage()
+{
+   fprintf(stderr, "usage: impair [-p listen port] [-h mixer host] [-r mixer port] [-s seed] [-t seconds]\n"
+                   "              [-x|-X loss] [-u|-U duplicate] [-o|-O reorder] [-g|-G reorder ms]\n"
+                   "              [-d|-D delay ms] [-j|-J jitter ms] [-b|-B packets/s] [-n|-N burst]\n");
+}
+
+static void
+Print(const char *way, const ImpairProxy::Counters & c)
+{
+   printf(" %4s %8lu %8lu %6lu %6lu %6lu %6lu", way, c.received, c.forwarded, c.lost, c.duplicated, c.reordered, c.limited);
+}
+
+int
+main(int argc, char **argv)
+{
+   int port = 7002;
+   const char *host = "127.0.0.1";
+   int remotePort = 7001;
+   unsigned int seed = 1;
+   double seconds = 0.0;
+   Impairment imp[ImpairProxy::DIRECTIONS];
+
+   for (int i = 1; i < argc; i++)
+   {
+      const char *arg = argv[i];
+      const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+      if (arg[0] != '-' || strlen(arg) != 2 || val == NULL)
+      {
+         Usage();
+         return 1;
+      }
+
+      Impairment & w = imp[isupper(arg[1]) ? ImpairProxy::DOWN : ImpairProxy::UP];
+      switch (arg[1])
+      {
+         case 'p': port = atoi(val); break;
+         case 'h': host = val; break;
+         case 'r': remotePort = atoi(val); break;
+         case 's': seed = (unsigned int) atoi(val); break;
+         case 't': seconds = atof(val); break;
+         case 'x': case 'X': w.loss = atof(val); break;
+         case 'u': case 'U': w.duplicate = atof(val); break;
+         case 'o': case 'O': w.reorder = atof(val); break;
+         case 'g': case 'G': w.reorderMs = atof(val); break;
+         case 'd': case 'D': w.delayMs = atof(val); break;
+         case 'j': case 'J': w.jitterMs = atof(val); break;
+         case 'b': case 'B': w.rate = atof(val); break;
+         case 'n': case 'N': w.burst = atoi(val); break;
+         default:
+            Usage();
+            return 1;
+      }
+      i++;
+   }
+
+   ImpairProxy proxy;
+   proxy.SetSeed(seed);
+   for (int d = 0; d < ImpairProxy::DIRECTIONS; d++)
+   {
+      proxy.SetImpairment(d, imp[d]);
+   }
+
+   if (!proxy.Start(port, host, remotePort))
+   {
+      fprintf(stderr, "unable to proxy %d to %s:%d: %s\n", port, host, remotePort, proxy.GetError().c_str());
+      return 1;
+   }
+
+   printf("proxying %d to %s:%d\n", proxy.GetPort(), host, remotePort);
+   printf("%8s", "seconds");
+   for (int d = 0; d < ImpairProxy::DIRECTIONS; d++)
+   {
+      printf(" %4s %8s %8s %6s %6s %6s %6s", "", "received", "sent", "lost", "dup", "reord", "limit");
+   }
+   printf("\n");
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   for (int s = 1; seconds <= 0.0 || s <= seconds; s++)
+   {
+      std::this_thread::sleep_until(start + std::chrono::seconds(s));
+      printf("%8d", s);
+      Print("up", proxy.GetCounters(ImpairProxy::UP));
+      Print("down", proxy.GetCounters(ImpairProxy::DOWN));
+      printf("\n");
+      fflush(stdout);
+   }
+
+   proxy.Stop();
+
+   return 0;
+}
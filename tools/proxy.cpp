@@ -0,0 +1,335 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#include <string.h>
+
+#include "proxy.h"
+
+using namespace oscpkt;
+
+static ImpairProxy::Clock::duration
+Millis(double ms)
+{
+   return std::chrono::duration_cast<ImpairProxy::Clock::duration>(std::chrono::duration<double, std::milli>(ms));
+}
+
+// ====================================================================
+//
+// ====================================================================
+ImpairProxy::ImpairProxy()
+{
+   mHaveClient = false;
+   mSeed = 1;
+   mRunning = false;
+
+   for (int d = 0; d < DIRECTIONS; d++)
+   {
+      memset(&mWays[d].counters, 0, sizeof(mWays[d].counters));
+      mWays[d].tokens = 0.0;
+   }
+}
+
+// ====================================================================
+//
+// ====================================================================
+ImpairProxy::~ImpairProxy()
+{
+   Stop();
+}
+
+// ====================================================================
+// A new rate starts with a full bucket
+// ====================================================================
+void ImpairProxy::SetImpairment(int direction, const Impairment & impairment)
+{
+   std::lock_guard<std::mutex> lock(mLock);
+
+   Way & way = mWays[direction];
+   way.impairment = impairment;
+   way.tokens = impairment.burst;
+   way.refilled = Clock::now();
+}
+
+// ====================================================================
+//
+// ====================================================================
+void ImpairProxy::SetSeed(unsigned int seed)
+{
+   std::lock_guard<std::mutex> lock(mLock);
+
+   mSeed = seed ? seed : 1;
+}
+
+// ====================================================================
+//
+// ====================================================================
+void ImpairProxy::SetTap(Tap tap)
+{
+   mTap = tap;
+}
+
+// ====================================================================
+//
+// ====================================================================
+bool ImpairProxy::Start(int port, const char *host, int remotePort)
+{
+   Stop();
+
+   if (!mFront.bindTo(port))
+   {
+      mError = mFront.errorMessage();
+      return false;
+   }
+
+   if (!mBack.bindTo(0))
+   {
+      mError = mBack.errorMessage();
+      return false;
+   }
+
+   char service[16];
+   snprintf(service, sizeof(service), "%d", remotePort);
+
+   struct addrinfo hints;
+   struct addrinfo *result = NULL;
+   memset(&hints, 0, sizeof(hints));
+   hints.ai_family = AF_INET;
+   hints.ai_socktype = SOCK_DGRAM;
+   if (getaddrinfo(host, service, &hints, &result) != 0 || result == NULL)
+   {
+      mError = "unable to resolve ";
+      mError += host;
+      return false;
+   }
+   memcpy(&mMixer.addr(), result->ai_addr, result->ai_addrlen);
+   freeaddrinfo(result);
+
+   if (!mLoop.isOk())
+   {
+      mError = mLoop.errorMessage();
+      return false;
+   }
+
+   mLoop.add(mFront, [this](UdpSocket &, PacketSlot & slot) { OnPacket(UP, slot); });
+   mLoop.add(mBack, [this](UdpSocket &, PacketSlot & slot) { OnPacket(DOWN, slot); });
+
+   mHaveClient = false;
+   mPending.clear();
+
+   mRunning = true;
+   mThread = std::thread(&ImpairProxy::Run, this);
+
+   return true;
+}
+
+// ====================================================================
+//
+// ====================================================================
+void ImpairProxy::Stop()
+{
+   if (mThread.joinable())
+   {
+      mRunning = false;
+      mLoop.wakeup();
+      mThread.join();
+   }
+
+   mLoop.remove(mFront);
+   mLoop.remove(mBack);
+   mFront.close();
+   mBack.close();
+}
+
+// ====================================================================
+//
+// ====================================================================
+const std::string & ImpairProxy::GetError()
+{
+   return mError;
+}
+
+// ====================================================================
+//
+// ====================================================================
+int ImpairProxy::GetPort()
+{
+   return mFront.boundPort();
+}
+
+// ====================================================================
+//
+// ====================================================================
+ImpairProxy::Counters ImpairProxy::GetCounters(int direction)
+{
+   std::lock_guard<std::mutex> lock(mLock);
+
+   return mWays[direction].counters;
+}
+
+// ====================================================================
+// Until the next datagram arrives or the next one held is due
+// ====================================================================
+void ImpairProxy::Run()
+{
+   while (mRunning)
+   {
+      int wait = 5;
+      if (!mPending.empty())
+      {
+         Clock::duration left = mPending.begin()->first - Clock::now();
+         wait = (int) std::chrono::duration_cast<std::chrono::milliseconds>(left).count();
+         wait = wait < 0 ? 0 : wait > 5 ? 5 : wait;
+      }
+
+      mLoop.runOnce(wait);
+      Flush(Clock::now());
+   }
+}
+
+// ====================================================================
+// Decide what becomes of one datagram
+// ====================================================================
+void ImpairProxy::OnPacket(int direction, PacketSlot & slot)
+{
+   if (mTap)
+   {
+      mTap(direction, slot.data, slot.size);
+   }
+
+   if (direction == UP)
+   {
+      mClient = slot.addr;
+      mHaveClient = true;
+   }
+
+   std::lock_guard<std::mutex> lock(mLock);
+
+   Way & way = mWays[direction];
+   const Impairment & imp = way.impairment;
+   Clock::time_point now = Clock::now();
+
+   way.counters.received++;
+
+   if (imp.loss > 0.0 && Random() < imp.loss)
+   {
+      way.counters.lost++;
+      return;
+   }
+
+   if (!Allow(way, now))
+   {
+      way.counters.limited++;
+      return;
+   }
+
+   int copies = 1;
+   if (imp.duplicate > 0.0 && Random() < imp.duplicate)
+   {
+      way.counters.duplicated++;
+      copies = 2;
+   }
+
+   for (int i = 0; i < copies; i++)
+   {
+      Clock::time_point due = now + Millis(imp.delayMs);
+      if (imp.jitterMs > 0.0)
+      {
+         due += Millis(imp.jitterMs * Random());
+      }
+      if (imp.reorder > 0.0 && Random() < imp.reorder)
+      {
+         way.counters.reordered++;
+         due += Millis(imp.reorderMs);
+      }
+
+      Schedule(direction, slot.data, slot.size, due);
+   }
+}
+
+// ====================================================================
+// Held even when due now, Flush() sends them in due order
+// ====================================================================
+void ImpairProxy::Schedule(int direction, const char *data, size_t size, Clock::time_point due)
+{
+   Pending p;
+   p.direction = direction;
+   p.data.assign(data, data + size);
+
+   mPending.insert(std::make_pair(due, p));
+}
+
+// ====================================================================
+//
+// ====================================================================
+void ImpairProxy::Flush(Clock::time_point now)
+{
+   while (!mPending.empty() && mPending.begin()->first <= now)
+   {
+      Pending & p = mPending.begin()->second;
+
+      bool sent = false;
+      if (p.direction == UP)
+      {
+         sent = mBack.sendPacketTo(&p.data[0], p.data.size(), mMixer);
+      }
+      else if (mHaveClient)
+      {
+         sent = mFront.sendPacketTo(&p.data[0], p.data.size(), mClient);
+      }
+
+      if (sent)
+      {
+         std::lock_guard<std::mutex> lock(mLock);
+         mWays[p.direction].counters.forwarded++;
+      }
+
+      mPending.erase(mPending.begin());
+   }
+}
+
+// ====================================================================
+// Token bucket, always true without a rate
+// ====================================================================
+bool ImpairProxy::Allow(Way & way, Clock::time_point now)
+{
+   const Impairment & imp = way.impairment;
+   if (imp.rate <= 0.0)
+   {
+      return true;
+   }
+
+   double elapsed = std::chrono::duration<double>(now - way.refilled).count();
+   way.refilled = now;
+   way.tokens += elapsed * imp.rate;
+   if (way.tokens > imp.burst)
+   {
+      way.tokens = imp.burst;
+   }
+
+   if (way.tokens < 1.0)
+   {
+      return false;
+   }
+
+   way.tokens -= 1.0;
+   return true;
+}
+
+// ====================================================================
+// xorshift, [0, 1)
+// ====================================================================
+double ImpairProxy::Random()
+{
+   mSeed ^= mSeed << 13;
+   mSeed ^= mSeed >> 17;
+   mSeed ^= mSeed << 5;
+
+   return (mSeed >> 8) / 16777216.0;
+}
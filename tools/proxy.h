@@ -0,0 +1,150 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(PROXY_H)
+#define PROXY_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eventloop.h"
+#include "udp.h"
+
+// ====================================================================
+// What happens to the datagrams going one way through the proxy.
+// Probabilities are 0 - 1, times in milliseconds, 0 turns a thing off.
+// ====================================================================
+struct Impairment
+{
+   double loss;                  // dropped
+   double duplicate;             // sent twice
+   double reorder;               // held back reorderMs, so later ones overtake
+   double reorderMs;
+   double delayMs;               // added to every one
+   double jitterMs;              // random 0 - jitterMs on top, may reorder too
+   double rate;                  // datagrams per second, the excess is dropped
+   int burst;                    // what the rate lets through at once
+
+   Impairment()
+   {
+      loss = 0.0;
+      duplicate = 0.0;
+      reorder = 0.0;
+      reorderMs = 20.0;
+      delayMs = 0.0;
+      jitterMs = 0.0;
+      rate = 0.0;
+      burst = 8;
+   }
+};
+
+// ====================================================================
+// A UDP proxy that sits between Tuba and a mixer (or TotalMixSim) and
+// impairs the traffic each way: loss, duplication, reordering, delay,
+// jitter and a rate limit.
+//
+// The client sends to the proxy's port, the proxy sends on to the mixer
+// from a port of its own, and whatever the mixer sends there goes back
+// to the last client.  One thread, the same seed gives the same
+// decisions for the same traffic.
+// ====================================================================
+class ImpairProxy
+{
+public:
+   typedef std::chrono::steady_clock Clock;
+
+   enum
+   {
+      UP,                        // client to mixer
+      DOWN,                      // mixer to client
+
+      DIRECTIONS
+   };
+
+   struct Counters
+   {
+      unsigned long received;
+      unsigned long forwarded;   // duplicates included
+      unsigned long lost;
+      unsigned long duplicated;
+      unsigned long reordered;
+      unsigned long limited;
+   };
+
+   // Sees every datagram as it arrives, before it is impaired.  Called
+   // on the proxy's thread.
+   typedef std::function<void (int direction, const char *data, size_t size)> Tap;
+
+   ImpairProxy();
+   virtual ~ImpairProxy();
+
+   // Can be changed while running
+   void SetImpairment(int direction, const Impairment & impairment);
+   void SetSeed(unsigned int seed);
+
+   // Must be set before Start()
+   void SetTap(Tap tap);
+
+   // Port 0 picks a free one, GetPort() says which
+   bool Start(int port, const char *host, int remotePort);
+   void Stop();
+   const std::string & GetError();
+   int GetPort();
+
+   Counters GetCounters(int direction);
+
+private:
+   struct Pending
+   {
+      int direction;
+      std::vector<char> data;
+   };
+
+   struct Way
+   {
+      Impairment impairment;
+      Counters counters;
+      double tokens;
+      Clock::time_point refilled;
+   };
+
+   void Run();
+   void OnPacket(int direction, oscpkt::PacketSlot & slot);
+   void Schedule(int direction, const char *data, size_t size, Clock::time_point due);
+   void Flush(Clock::time_point now);
+   bool Allow(Way & way, Clock::time_point now);
+   double Random();
+
+private:
+   oscpkt::EventLoop mLoop;
+   oscpkt::UdpSocket mFront;          // the client's side
+   oscpkt::UdpSocket mBack;           // the mixer's side
+   oscpkt::SockAddr mMixer;
+   oscpkt::SockAddr mClient;
+   bool mHaveClient;
+   Tap mTap;
+
+   std::mutex mLock;                  // mWays, against the setters and getters
+   Way mWays[DIRECTIONS];
+   std::multimap<Clock::time_point, Pending> mPending;
+   unsigned int mSeed;
+
+   std::thread mThread;
+   std::atomic<bool> mRunning;
+   std::string mError;
+};
+
+#endif
@@ -0,0 +1,638 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "simulator.h"
+
+using namespace oscpkt;
+
+// In BUS_* order, as in /1/busInput
+static const char *BusNames[3] = { "Input", "Output", "Playback" };
+
+// ====================================================================
+//
+// ====================================================================
+TotalMixSim::TotalMixSim(int width)
+:  mState(3, 256)
+{
+   mWidth = width;
+   mBus1 = 0;
+   mBus2 = 0;
+   for (int b = 0; b < 3; b++)
+   {
+      mOffset[b] = 0;
+      mTrack[b] = 1;
+   }
+
+   mLatency = Clock::duration::zero();
+   mJitter = Clock::duration::zero();
+   mMeterInterval = Clock::duration::zero();
+   mSeed = 1;
+
+   mHaveClient = false;
+   mRunning = false;
+   mReceived = 0;
+   mMessages = 0;
+   mSent = 0;
+   mMeters = 0;
+}
+
+// ====================================================================
+//
+// ====================================================================
+TotalMixSim::~TotalMixSim()
+{
+   Stop();
+}
+
+// ====================================================================
+// At most what the state holds, the rest is cut off
+// ====================================================================
+void TotalMixSim::SetChannels(int bus, const std::vector<std::string> & names)
+{
+   mNames[bus] = names;
+   if (mNames[bus].size() > 256)
+   {
+      mNames[bus].resize(256);
+   }
+}
+
+// ====================================================================
+//
+// ====================================================================
+std::vector<std::string> TotalMixSim::Names(const char *prefix, int count)
+{
+   std::vector<std::string> names;
+
+   for (int i = 1; i <= count; i++)
+   {
+      names.push_back(std::string(prefix) + " " + std::to_string(i));
+   }
+
+   return names;
+}
+
+// ====================================================================
+// Tuba only learns the names of the first bank of each bus when it
+// starts, so its own channels go there
+// ====================================================================
+std::vector<std::string> TotalMixSim::Generate(int bus, int count)
+{
+   static const char *Prefix[] = { "AN", "Out", "Play" };
+   std::vector<std::string> names = Names(Prefix[bus], count);
+
+   if (bus == 0)
+   {
+      static const char *Own[] = { "Mic 1", "Mic 2", "SPDIF" };
+      for (int i = 0; i < 3 && 4 + i < count; i++)
+      {
+         names[4 + i] = Own[i];
+      }
+   }
+   else if (bus == 1 && count > 0)
+   {
+      names[0] = "Main";
+      if (count > 7)
+      {
+         names[7] = "Speaker B";
+      }
+   }
+
+   return names;
+}
+
+// ====================================================================
+//
+// ====================================================================
+void TotalMixSim::SetLatency(double latencyMs, double jitterMs)
+{
+   mLatency = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(latencyMs));
+   mJitter = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(jitterMs));
+}
+
+// ====================================================================
+//
+// ====================================================================
+void TotalMixSim::SetMeterRate(double packetsPerSecond)
+{
+   if (packetsPerSecond <= 0.0)
+   {
+      mMeterInterval = Clock::duration::zero();
+      return;
+   }
+
+   mMeterInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / packetsPerSecond));
+}
+
+// ====================================================================
+// Same seed, same jitter and meter values
+// ====================================================================
+void TotalMixSim::SetSeed(unsigned int seed)
+{
+   mSeed = seed ? seed : 1;
+}
+
+// ====================================================================
+// Everything starts at 0, cursors and banks on the first channel
+// ====================================================================
+bool TotalMixSim::Start(int port)
+{
+   Stop();
+
+   mState.Clear();
+   for (int b = 0; b < 3; b++)
+   {
+      for (int id = 1; id <= (int) mNames[b].size(); id++)
+      {
+         for (int p = 0; p < PARAM_COUNT; p++)
+         {
+            mState.Set(b, id, p, 0.0f);
+         }
+      }
+      mOffset[b] = 0;
+      mTrack[b] = 1;
+   }
+   mBus1 = 0;
+   mBus2 = 0;
+   mHaveClient = false;
+   mReplies.clear();
+
+   if (!mSock.bindTo(port))
+   {
+      mError = mSock.errorMessage();
+      return false;
+   }
+
+   mRunning = true;
+   mThread = std::thread(&TotalMixSim::Run, this);
+
+   return true;
+}
+
+// ====================================================================
+//
+// ====================================================================
+void TotalMixSim::Stop()
+{
+   if (mThread.joinable())
+   {
+      mRunning = false;
+      mThread.join();
+   }
+
+   mSock.close();
+}
+
+// ====================================================================
+//
+// ====================================================================
+const std::string & TotalMixSim::GetError()
+{
+   return mError;
+}
+
+// ====================================================================
+//
+// ====================================================================
+int TotalMixSim::GetPort()
+{
+   return mSock.boundPort();
+}
+
+// ====================================================================
+//
+// ====================================================================
+int TotalMixSim::GetChannelCount(int bus)
+{
+   return (int) mNames[bus].size();
+}
+
+// ====================================================================
+//
+// ====================================================================
+const std::string & TotalMixSim::GetChannelName(int bus, int id)
+{
+   return mNames[bus][id - 1];
+}
+
+// ====================================================================
+//
+// ====================================================================
+bool TotalMixSim::GetValue(int bus, int id, int param, float & value)
+{
+   std::lock_guard<std::mutex> lock(mLock);
+
+   const MixerState::Entry *e = mState.Get(bus, id, param);
+   if (e == NULL || e->version == 0)
+   {
+      return false;
+   }
+
+   value = e->value;
+   return true;
+}
+
+// ====================================================================
+//
+// ====================================================================
+unsigned long TotalMixSim::GetReceived()
+{
+   return mReceived;
+}
+
+// ====================================================================
+//
+// ====================================================================
+unsigned long TotalMixSim::GetMessages()
+{
+   return mMessages;
+}
+
+// ====================================================================
+//
+// ====================================================================
+unsigned long TotalMixSim::GetSent()
+{
+   return mSent;
+}
+
+// ====================================================================
+//
+// ====================================================================
+unsigned long TotalMixSim::GetMeters()
+{
+   return mMeters;
+}
+
+// ====================================================================
+// Sleeps until the next request, the next reply due or the next meter
+// packet, whichever comes first
+// ====================================================================
+void TotalMixSim::Run()
+{
+   mNextMeter = Clock::now();
+
+   while (mRunning)
+   {
+      Clock::time_point now = Clock::now();
+      Flush(now);
+
+      if (mMeterInterval != Clock::duration::zero() && now >= mNextMeter)
+      {
+         SendMeters();
+         mNextMeter += mMeterInterval;
+         if (mNextMeter < now)
+         {
+            // Fell behind, do not make up for it in a burst
+            mNextMeter = now + mMeterInterval;
+         }
+      }
+
+      Clock::time_point wake = now + std::chrono::milliseconds(5);
+      if (!mReplies.empty() && mReplies.front().due < wake)
+      {
+         wake = mReplies.front().due;
+      }
+      if (mMeterInterval != Clock::duration::zero() && mNextMeter < wake)
+      {
+         wake = mNextMeter;
+      }
+
+      // Rounded down: the last fraction of a millisecond is polled
+      int wait = (int) std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count();
+      if (mSock.receiveNextPacket(wait < 0 ? 0 : wait))
+      {
+         mReceived++;
+         OnPacket(mSock.packetOrigin());
+      }
+   }
+}
+
+// ====================================================================
+// Every message of a packet (bundles flattened) in order
+// ====================================================================
+void TotalMixSim::OnPacket(SockAddr & from)
+{
+   mClient = from;
+   mHaveClient = true;
+
+   PacketReader pr(mSock.packetData(), mSock.packetSize());
+   Message *msg;
+   while (pr.isOk() && (msg = pr.popMessage()) != 0)
+   {
+      mMessages++;
+
+      const std::string & address = msg->addressPattern();
+      if (!OnPage1(address, msg, from))
+      {
+         OnPage2(address, msg, from);
+      }
+   }
+
+   Flush(Clock::now());
+}
+
+// ====================================================================
+//
+// ====================================================================
+bool TotalMixSim::OnPage1(const std::string & address, Message *msg, SockAddr & from)
+{
+   if (address.compare(0, 3, "/1/") != 0)
+   {
+      return false;
+   }
+
+   int n = (int) mNames[mBus1].size();
+   float value;
+
+   if (address.compare(3, 3, "bus") == 0)
+   {
+      int bus = BusOf(address.substr(6));
+      if (bus >= 0)
+      {
+         mBus1 = bus;
+         Echo1(from);
+      }
+   }
+   else if (address == "/1/bank+")
+   {
+      if (mOffset[mBus1] + mWidth < n)
+      {
+         mOffset[mBus1] += mWidth;
+      }
+      Echo1(from);
+   }
+   else if (address == "/1/bank-")
+   {
+      mOffset[mBus1] = mOffset[mBus1] > mWidth ? mOffset[mBus1] - mWidth : 0;
+      Echo1(from);
+   }
+   else if (msg->arg().popFloat(value).isOkNoMoreArgs())
+   {
+      // /1/volume3: the parameter, then the strip
+      size_t digits = address.find_first_of("0123456789", 3);
+      if (digits == std::string::npos)
+      {
+         return true;
+      }
+
+      int param = MixerState::ParamId(address.substr(3, digits - 3).c_str());
+      int strip = atoi(address.c_str() + digits);
+      int id = mOffset[mBus1] + strip;
+      if (param < 0 || strip < 1 || strip > mWidth || id > n)
+      {
+         return true;
+      }
+
+      SetParam(mBus1, id, param, value);
+
+      const MixerState::Entry *e = mState.Get(mBus1, id, param);
+      PacketWriter pw;
+      Message echo(address);
+      echo.pushFloat(e->value);
+      pw.addMessage(echo);
+      Queue(pw, from);
+   }
+
+   return true;
+}
+
+// ====================================================================
+//
+// ====================================================================
+bool TotalMixSim::OnPage2(const std::string & address, Message *msg, SockAddr & from)
+{
+   if (address.compare(0, 3, "/2/") != 0)
+   {
+      return false;
+   }
+
+   int n = (int) mNames[mBus2].size();
+   float value;
+
+   if (address.compare(3, 3, "bus") == 0)
+   {
+      int bus = BusOf(address.substr(6));
+      if (bus >= 0)
+      {
+         mBus2 = bus;
+
+         PacketWriter pw;
+         Message echo(address);
+         echo.pushFloat(1.0f);
+         pw.addMessage(echo);
+         Queue(pw, from);
+
+         Echo2(from, -1);
+      }
+   }
+   else if (address == "/2/track+")
+   {
+      if (mTrack[mBus2] < n)
+      {
+         mTrack[mBus2]++;
+      }
+      Echo2(from, -1);
+   }
+   else if (address == "/2/track-")
+   {
+      if (mTrack[mBus2] > 1)
+      {
+         mTrack[mBus2]--;
+      }
+      Echo2(from, -1);
+   }
+   else if (n > 0 && msg->arg().popFloat(value).isOkNoMoreArgs())
+   {
+      int param = MixerState::ParamId(address.c_str());
+      if (param >= 0)
+      {
+         SetParam(mBus2, mTrack[mBus2], param, value);
+         Echo2(from, param);
+      }
+   }
+
+   return true;
+}
+
+// ====================================================================
+// The buttons flip on a press, the rest take the value
+// ====================================================================
+void TotalMixSim::SetParam(int bus, int id, int param, float value)
+{
+   std::lock_guard<std::mutex> lock(mLock);
+
+   if (param == PARAM_MUTE || param == PARAM_SOLO || param == PARAM_EQ_ENABLE)
+   {
+      if (value == 0.0f)
+      {
+         return;
+      }
+      value = mState.Get(bus, id, param)->value != 0.0f ? 0.0f : 1.0f;
+   }
+
+   mState.Set(bus, id, param, value);
+}
+
+// ====================================================================
+// The page 1 selection and the names of the strips in view
+// ====================================================================
+void TotalMixSim::Echo1(SockAddr & to)
+{
+   PacketWriter pw;
+   Message msg;
+
+   pw.startBundle();
+   msg.init(std::string("/1/bus") + BusNames[mBus1]).pushFloat(1.0f);
+   pw.addMessage(msg);
+
+   int n = (int) mNames[mBus1].size();
+   for (int strip = 1; strip <= mWidth && mOffset[mBus1] + strip <= n; strip++)
+   {
+      msg.init("/1/trackname" + std::to_string(strip)).pushStr(mNames[mBus1][mOffset[mBus1] + strip - 1]);
+      pw.addMessage(msg);
+   }
+   pw.endBundle();
+
+   Queue(pw, to);
+}
+
+// ====================================================================
+// One value (all of them when param < 0) of the channel under the page
+// 2 cursor, then its name
+// ====================================================================
+void TotalMixSim::Echo2(SockAddr & to, int param)
+{
+   int id = mTrack[mBus2];
+   if (id > (int) mNames[mBus2].size())
+   {
+      return;
+   }
+
+   PacketWriter pw;
+   Message msg;
+
+   pw.startBundle();
+   for (int p = 0; p < PARAM_COUNT; p++)
+   {
+      if (param < 0 || p == param)
+      {
+         msg.init(std::string("/2/") + MixerState::ParamName(p)).pushFloat(mState.Get(mBus2, id, p)->value);
+         pw.addMessage(msg);
+      }
+   }
+   msg.init("/2/trackname").pushStr(mNames[mBus2][id - 1]);
+   pw.addMessage(msg);
+   pw.endBundle();
+
+   Queue(pw, to);
+}
+
+// ====================================================================
+// Left and right of every strip in view, straight out: meters do not
+// wait on anything
+// ====================================================================
+void TotalMixSim::SendMeters()
+{
+   if (!mHaveClient)
+   {
+      return;
+   }
+
+   PacketWriter pw;
+   Message msg;
+   char address[32];
+
+   pw.startBundle();
+   int n = (int) mNames[mBus1].size();
+   for (int strip = 1; strip <= mWidth && mOffset[mBus1] + strip <= n; strip++)
+   {
+      snprintf(address, sizeof(address), "/1/level%dLeft", strip);
+      msg.init(address).pushFloat((float) Random());
+      pw.addMessage(msg);
+      snprintf(address, sizeof(address), "/1/level%dRight", strip);
+      msg.init(address).pushFloat((float) Random());
+      pw.addMessage(msg);
+   }
+   pw.endBundle();
+
+   if (mSock.sendPacketTo(pw.packetData(), pw.packetSize(), mClient))
+   {
+      mMeters++;
+   }
+}
+
+// ====================================================================
+// Due after the latency and jitter, but not before the one ahead of it
+// ====================================================================
+void TotalMixSim::Queue(PacketWriter & pw, SockAddr & to)
+{
+   Reply r;
+   r.due = Clock::now() + mLatency;
+   if (mJitter != Clock::duration::zero())
+   {
+      r.due += std::chrono::duration_cast<Clock::duration>(mJitter * Random());
+   }
+   if (!mReplies.empty() && r.due < mLastDue)
+   {
+      r.due = mLastDue;
+   }
+   mLastDue = r.due;
+
+   r.to = to;
+   r.data.assign(pw.packetData(), pw.packetData() + pw.packetSize());
+   mReplies.push_back(r);
+}
+
+// ====================================================================
+//
+// ====================================================================
+void TotalMixSim::Flush(Clock::time_point now)
+{
+   while (!mReplies.empty() && mReplies.front().due <= now)
+   {
+      Reply & r = mReplies.front();
+      if (mSock.sendPacketTo(&r.data[0], r.data.size(), r.to))
+      {
+         mSent++;
+      }
+      mReplies.pop_front();
+   }
+}
+
+// ====================================================================
+// BUS_* of "Input", "Output" or "Playback", -1 for anything else
+// ====================================================================
+int TotalMixSim::BusOf(const std::string & name)
+{
+   for (int b = 0; b < 3; b++)
+   {
+      if (name == BusNames[b])
+      {
+         return b;
+      }
+   }
+
+   return -1;
+}
+
+// ====================================================================
+// xorshift, [0, 1)
+// ====================================================================
+double TotalMixSim::Random()
+{
+   mSeed ^= mSeed << 13;
+   mSeed ^= mSeed >> 17;
+   mSeed ^= mSeed << 5;
+
+   return (mSeed >> 8) / 16777216.0;
+}
@@ -0,0 +1,145 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(SIMULATOR_H)
+#define SIMULATOR_H
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "oscpkt.h"
+#include "udp.h"
+#include "mixerstate.h"
+
+// ====================================================================
+// The parts of TotalMix FX's OSC interface Tuba depends on, over UDP,
+// for load and latency runs without an interface.
+//
+// Page 1: /1/busInput, /1/busOutput and /1/busPlayback select the bus,
+// /1/bank+ and /1/bank- move the bank of strips in view a whole width at
+// a time (never past the last bank), and /1/volumeN, /1/panN, /1/muteN
+// and /1/soloN set strip N of that bank.  Bus selections and bank moves
+// are answered with the selection and the names in view
+// (/1/trackname1 ...).
+//
+// Page 2: /2/busInput ... select the bus of the cursor, /2/track+ and
+// /2/track- move it (each bus remembers its own), and /2/<param> sets
+// a parameter of the channel under it.  Every cursor move is answered
+// with the channel's values followed by /2/trackname, every parameter
+// set with the new value followed by /2/trackname.
+//
+// Mute, solo and EQ enable are buttons: 1 presses them (flips the
+// state), 0 is ignored.
+//
+// Answers go to whoever sent the request, after the configured latency
+// plus a random jitter, but never out of order.  Level meters
+// (/1/levelNLeft, /1/levelNRight for the strips in view) go to the
+// last client at the configured rate.
+// ====================================================================
+class TotalMixSim
+{
+public:
+   typedef std::chrono::steady_clock Clock;
+
+   TotalMixSim(int width = 8);
+   virtual ~TotalMixSim();
+
+   // Channel names of a bus, 1 based ids in this order.  Must be set
+   // before Start().
+   void SetChannels(int bus, const std::vector<std::string> & names);
+
+   // Channel lists for SetChannels(): "prefix 1" ... "prefix count", or
+   // count names of a bus (AN, Out, Play) like a mid-sized interface,
+   // with the channels Tuba's controls use (Mic 1, Mic 2, SPDIF, Main,
+   // Speaker B) in the first bank
+   static std::vector<std::string> Names(const char *prefix, int count);
+   static std::vector<std::string> Generate(int bus, int count);
+
+   // Defaults: no latency, no jitter, no meters
+   void SetLatency(double latencyMs, double jitterMs = 0.0);
+   void SetMeterRate(double packetsPerSecond);
+   void SetSeed(unsigned int seed);
+
+   // Port 0 picks a free one, GetPort() says which
+   bool Start(int port);
+   void Stop();
+   const std::string & GetError();
+   int GetPort();
+
+   int GetChannelCount(int bus);
+   const std::string & GetChannelName(int bus, int id);
+
+   // False when there is no such channel
+   bool GetValue(int bus, int id, int param, float & value);
+
+   unsigned long GetReceived();
+   unsigned long GetMessages();
+   unsigned long GetSent();
+   unsigned long GetMeters();
+
+private:
+   struct Reply
+   {
+      Clock::time_point due;
+      oscpkt::SockAddr to;
+      std::vector<char> data;
+   };
+
+   void Run();
+   void OnPacket(oscpkt::SockAddr & from);
+   bool OnPage1(const std::string & address, oscpkt::Message *msg, oscpkt::SockAddr & from);
+   bool OnPage2(const std::string & address, oscpkt::Message *msg, oscpkt::SockAddr & from);
+   void SetParam(int bus, int id, int param, float value);
+   void Echo1(oscpkt::SockAddr & to);
+   void Echo2(oscpkt::SockAddr & to, int param);
+   void SendMeters();
+   void Queue(oscpkt::PacketWriter & pw, oscpkt::SockAddr & to);
+   void Flush(Clock::time_point now);
+   int BusOf(const std::string & name);
+   double Random();
+
+private:
+   int mWidth;
+   std::vector<std::string> mNames[3];
+   MixerState mState;
+   std::mutex mLock;                  // mState, against GetValue()
+
+   int mBus1;                         // page 1
+   int mOffset[3];
+   int mBus2;                         // page 2
+   int mTrack[3];                     // 1 based
+
+   Clock::duration mLatency;
+   Clock::duration mJitter;
+   Clock::duration mMeterInterval;    // zero when off
+   Clock::time_point mNextMeter;
+   Clock::time_point mLastDue;
+   unsigned int mSeed;
+
+   oscpkt::UdpSocket mSock;
+   oscpkt::SockAddr mClient;
+   bool mHaveClient;
+   std::deque<Reply> mReplies;
+   std::thread mThread;
+   std::atomic<bool> mRunning;
+   std::string mError;
+
+   std::atomic<unsigned long> mReceived;
+   std::atomic<unsigned long> mMessages;
+   std::atomic<unsigned long> mSent;
+   std::atomic<unsigned long> mMeters;
+};
+
+#endif
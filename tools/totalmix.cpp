@@ -0,0 +1,173 @@
+/*
+  A stand-in for TotalMix FX on loopback (see TotalMixSim): point Tuba,
+  a bench or the impairment proxy at it instead of an interface.
+
+  Channel lists are either generated (-n, names like a mid-sized
+  interface, with the ones Tuba's controls use among them) or read from
+  a file (-f) with one "bus: name, name, ..." line per bus, bus being
+  input, output or playback.  Tuba only learns the names of the first
+  bank of each bus when it starts, so the generated lists have its
+  channels there.
+
+  Prints its counters once per second.
+
+  usage: totalmix [-p port] [-l latency ms] [-j jitter ms] [-m meter packets/s]
+                  [-w bank width] [-n channels per bus] [-f channel file]
+                  [-s seed] [-t seconds]
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "simulator.h"
+
+static const char *BusNames[] = { "input", "output", "playback" };
+
+static std::string
+Trim(const std::string & s)
+{
+   size_t first = s.find_first_not_of(" \t\r\n");
+   size_t last = s.find_last_not_of(" \t\r\n");
+
+   return first == std::string::npos ? std::string() : s.substr(first, last - first + 1);
+}
+
+// ====================================================================
+// "output: Main, Phones, Speaker B"
+// ====================================================================
+static bool
+Load(const char *path, TotalMixSim & sim)
+{
+   FILE *f = fopen(path, "r");
+   if (f == NULL)
+   {
+      perror(path);
+      return false;
+   }
+
+   char line[4096];
+   while (fgets(line, sizeof(line), f) != NULL)
+   {
+      std::string s = Trim(line);
+      size_t colon = s.find(':');
+      if (s.empty() || s[0] == '#' || colon == std::string::npos)
+      {
+         continue;
+      }
+
+      int bus = -1;
+      for (int b = 0; b < 3; b++)
+      {
+         if (Trim(s.substr(0, colon)) == BusNames[b])
+         {
+            bus = b;
+         }
+      }
+      if (bus < 0)
+      {
+         fprintf(stderr, "%s: unknown bus in \"%s\"\n", path, s.c_str());
+         continue;
+      }
+
+      std::vector<std::string> names;
+      size_t start = colon + 1;
+      while (start <= s.size())
+      {
+         size_t comma = s.find(',', start);
+         if (comma == std::string::npos)
+         {
+            comma = s.size();
+         }
+         std::string name = Trim(s.substr(start, comma - start));
+         if (!name.empty())
+         {
+            names.push_back(name);
+         }
+         start = comma + 1;
+      }
+      sim.SetChannels(bus, names);
+   }
+
+   fclose(f);
+   return true;
+}
+
+int
+main(int argc, char **argv)
+{
+   int port = 7001;
+   double latency = 0.0;
+   double jitter = 0.0;
+   double meters = 0.0;
+   int width = 8;
+   int count = 32;
+   const char *file = NULL;
+   unsigned int seed = 1;
+   double seconds = 0.0;
+
+   for (int i = 1; i < argc; i++)
+   {
+      const char *arg = argv[i];
+      const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+      if (arg[0] != '-' || strlen(arg) != 2 || val == NULL)
+      {
+         fprintf(stderr, "usage: totalmix [-p port] [-l latency ms] [-j jitter ms] [-m meter packets/s]\n"
+                         "                [-w bank width] [-n channels per bus] [-f channel file]\n"
+                         "                [-s seed] [-t seconds]\n");
+         return 1;
+      }
+      switch (arg[1])
+      {
+         case 'p': port = atoi(val); break;
+         case 'l': latency = atof(val); break;
+         case 'j': jitter = atof(val); break;
+         case 'm': meters = atof(val); break;
+         case 'w': width = atoi(val); break;
+         case 'n': count = atoi(val); break;
+         case 'f': file = val; break;
+         case 's': seed = (unsigned int) atoi(val); break;
+         case 't': seconds = atof(val); break;
+      }
+      i++;
+   }
+
+   TotalMixSim sim(width);
+   for (int b = 0; b < 3; b++)
+   {
+      sim.SetChannels(b, TotalMixSim::Generate(b, count));
+   }
+   if (file != NULL && !Load(file, sim))
+   {
+      return 1;
+   }
+   sim.SetLatency(latency, jitter);
+   sim.SetMeterRate(meters);
+   sim.SetSeed(seed);
+
+   if (!sim.Start(port))
+   {
+      fprintf(stderr, "unable to open port %d: %s\n", port, sim.GetError().c_str());
+      return 1;
+   }
+
+   printf("listening on %d, %d/%d/%d channels\n", sim.GetPort(),
+          sim.GetChannelCount(0), sim.GetChannelCount(1), sim.GetChannelCount(2));
+   printf("%8s %10s %10s %10s %10s\n", "seconds", "received", "messages", "sent", "meters");
+
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   for (int s = 1; seconds <= 0.0 || s <= seconds; s++)
+   {
+      std::this_thread::sleep_until(start + std::chrono::seconds(s));
+      printf("%8d %10lu %10lu %10lu %10lu\n", s, sim.GetReceived(), sim.GetMessages(), sim.GetSent(), sim.GetMeters());
+      fflush(stdout);
+   }
+
+   sim.Stop();
+
+   return 0;
+}
@@ -0,0 +1,237 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bank.h"
+
+// ====================================================================
+//
+// ====================================================================
+StripBank::StripBank(int page, int width)
+:  mTrail(page, -1)
+{
+   char addr[32];
+
+   mWidth = width;
+   mRewinds = 0;
+   mDesyncs = 0;
+
+   snprintf(addr, sizeof(addr), "/%d/bank-", page);
+   mPrev.init(addr).pushFloat(1.0f);
+   snprintf(addr, sizeof(addr), "/%d/bank+", page);
+   mNext.init(addr).pushFloat(1.0f);
+}
+
+// ====================================================================
+//
+// ====================================================================
+StripBank::~StripBank()
+{
+}
+
+// ====================================================================
+//
+// ====================================================================
+int StripBank::AddBus(const char *name)
+{
+   return mTrail.AddBus(name);
+}
+
+// ====================================================================
+//
+// ====================================================================
+void StripBank::SetLookup(Lookup lookup)
+{
+   mLookup = lookup;
+}
+
+// ====================================================================
+// Nothing but the strip address when the channel is already in view
+// ====================================================================
+void StripBank::Navigate(oscpkt::PacketWriter & pw, int bus, int id, int count, const char *prefix, float value)
+{
+   int offset = mTrail.GetPosition(bus);
+   char addr[64];
+
+   bool select = mTrail.GetBus() != bus;
+   bool inView = offset >= 0 && id > offset && id <= offset + mWidth;
+   int target = inView ? offset : ((id - 1) / mWidth) * mWidth;
+
+   // Banks move a whole width at a time, so an offset left in between
+   // by a page 1 track+ on the mixer never gets to a bank boundary
+   bool rewind = !inView && (offset < 0 || offset % mWidth != 0);
+   int steps = rewind ? 0 : (target - offset) / mWidth;
+   int banks = (count + mWidth - 1) / mWidth;
+
+   size_t n = (select ? 1 : 0) + 1;
+   n += rewind ? banks + target / mWidth : abs(steps);
+
+   pw.init();
+   if (n > 1)
+   {
+      pw.startBundle();
+   }
+
+   if (select)
+   {
+      pw.addMessage(mTrail.GetSelect(bus));
+      mTrail.Visit(bus, offset);
+   }
+   mTrail.SetBus(bus);
+
+   if (rewind)
+   {
+      for (int i = 0; i < banks; i++)
+      {
+         pw.addMessage(mPrev);
+      }
+      for (int i = 0; i < target; i += mWidth)
+      {
+         pw.addMessage(mNext);
+      }
+      // Down from anywhere to the first bank, then up one by one
+      mTrail.Visit(bus, -1);
+      for (int i = 0; i <= target; i += mWidth)
+      {
+         mTrail.Visit(bus, i);
+      }
+      mRewinds++;
+   }
+   else
+   {
+      for (int i = 1; i <= steps; i++)
+      {
+         pw.addMessage(mNext);
+         mTrail.Visit(bus, offset + i * mWidth);
+      }
+      for (int i = -1; i >= steps; i--)
+      {
+         pw.addMessage(mPrev);
+         mTrail.Visit(bus, offset + i * mWidth);
+      }
+   }
+
+   mTrail.SetPosition(bus, target);
+
+   snprintf(addr, sizeof(addr), "%s%d", prefix, id - target);
+   mMsg.init(addr).pushFloat(value);
+   pw.addMessage(mMsg);
+
+   if (n > 1)
+   {
+      pw.endBundle();
+   }
+}
+
+// ====================================================================
+// A page 1 bus button echoed as selected
+// ====================================================================
+void StripBank::OnBus(int bus)
+{
+   // Nothing to be out of sync with when no bus was selected
+   bool known = mTrail.GetBus() >= 0;
+
+   if (!mTrail.OnBus(bus) && known)
+   {
+      mDesyncs++;
+   }
+}
+
+// ====================================================================
+// A page 1 strip name, echoed for every strip of the bank in view.
+// Returns the channel id of the strip, -1 when there is no telling.
+// ====================================================================
+int StripBank::OnTrackName(int bus, int strip, const char *name)
+{
+   int known = mTrail.GetPosition(bus);
+   int id = mLookup ? mLookup(bus, name) : -1;
+
+   if (id < strip)
+   {
+      // A name we do not know yet: it belongs to the oldest bank not
+      // confirmed so far, if that is one we know the offset of
+      int i = mTrail.Find([bus](int b, int) { return b == bus; });
+      if (i >= 0)
+      {
+         int visited = mTrail.GetVisited(i);
+         return visited < 0 ? -1 : visited + strip;
+      }
+
+      // Nothing in flight: where we left it, or the first bank, which is
+      // where the mixer starts
+      return (known < 0 ? 0 : known) + strip;
+   }
+
+   int offset = id - strip;
+
+   // The way down of a rewind could show any bank but the first, which
+   // is where the way up starts
+   int i = mTrail.Find([bus, offset](int b, int visited)
+   {
+      return b == bus && (visited < 0 ? offset > 0 : offset == visited);
+   });
+   if (i >= 0)
+   {
+      mTrail.Reached(i);
+      return id;
+   }
+
+   // Not one of ours, but the name says where the bank is now
+   if (!mTrail.IsEmpty() || (known >= 0 && known != offset))
+   {
+      mDesyncs++;
+      mTrail.Forget();
+   }
+   mTrail.SetPosition(bus, offset);
+
+   return id;
+}
+
+// ====================================================================
+//
+// ====================================================================
+void StripBank::Invalidate()
+{
+   mTrail.Invalidate();
+}
+
+// ====================================================================
+//
+// ====================================================================
+int StripBank::GetBus()
+{
+   return mTrail.GetBus();
+}
+
+// ====================================================================
+//
+// ====================================================================
+int StripBank::GetOffset(int bus)
+{
+   return mTrail.GetPosition(bus);
+}
+
+// ====================================================================
+// Navigations that had to start from the first bank
+// ====================================================================
+unsigned long StripBank::GetRewinds()
+{
+   return mRewinds;
+}
+
+// ====================================================================
+// Bank and bus echoes that did not match anything we sent
+// ====================================================================
+unsigned long StripBank::GetDesyncs()
+{
+   return mDesyncs;
+}
@@ -0,0 +1,78 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(BANK_H)
+#define BANK_H
+
+#include <functional>
+
+#include "oscpkt.h"
+#include "trail.h"
+
+// ====================================================================
+// Which strips the mixer's page 1 shows: the selected bus, and the
+// channel offset of the bank in view on each bus.
+//
+// Page 1 has one address per strip (/1/volume1 ... /1/volume8), so once
+// the bank holding a channel is in view, setting it is a single message
+// and no navigation at all.  Only parameters with a per strip address
+// can go this way, the rest stay on page 2 (see TrackCursor).
+//
+// Every bank change and bus selection is echoed as the names of the
+// strips in view.  Those are checked against the banks our own
+// navigations went through; anything else means the bank was moved
+// behind our back, and the names themselves say where it went.
+// ====================================================================
+class StripBank
+{
+public:
+   // Channel id (1 based) of name on bus, < 1 when there is none
+   typedef std::function<int (int bus, const char *name)> Lookup;
+
+   StripBank(int page = 1, int width = 8);
+   virtual ~StripBank();
+
+   // The buses, in the order of the ids the other calls use
+   int AddBus(const char *name);
+   void SetLookup(Lookup lookup);
+
+   // Fill pw with what brings channel id of bus (which has count
+   // channels) into view, followed by its strip's address (prefix is
+   // the address without the strip number, "/1/volume") set to value.
+   void Navigate(oscpkt::PacketWriter & pw, int bus, int id, int count, const char *prefix, float value);
+
+   // Echoes from the mixer.  OnTrackName() gets the strip number of the
+   // name and returns the channel id it belongs to.
+   void OnBus(int bus);
+   int OnTrackName(int bus, int strip, const char *name);
+
+   // Forget everything, the next navigation rewinds
+   void Invalidate();
+
+   int GetBus();
+   int GetOffset(int bus);
+
+   unsigned long GetRewinds();
+   unsigned long GetDesyncs();
+
+private:
+   // Channels before the first strip of each bus, -1 when unknown
+   NavTrail mTrail;
+   int mWidth;
+   oscpkt::Message mPrev;
+   oscpkt::Message mNext;
+   oscpkt::Message mMsg;
+   Lookup mLookup;
+
+   unsigned long mRewinds;
+   unsigned long mDesyncs;
+};
+
+#endif
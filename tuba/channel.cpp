@@ -1,7 +1,4 @@
 
-#include <wx/types.h>
-#include <wx/string.h>
-
 #include "channel.h"
 
 Channel::Channel()
@@ -13,7 +10,7 @@ Channel::~Channel()
 }
 
 bool
-Channel::Init( const wxString & label, const wxString & name )
+Channel::Init( const std::string & label, const std::string & name )
 {
     mLabel = label;
     mName = name;
@@ -21,25 +18,25 @@ Channel::Init( const wxString & label, const wxString & name )
     return true;
 }
 
-wxString
+std::string
 Channel::GetOSCPattern()
 {
     return mPattern;
 }
 
 void
-Channel::SetOSCPattern( const wxString & pattern )
+Channel::SetOSCPattern( const std::string & pattern )
 {
     mPattern = pattern;
 }
 
 void
-Channel::SetName( const wxString & name )
+Channel::SetName( const std::string & name )
 {
     mName = name;
 }
 
-wxString
+const std::string &
 Channel::GetName()
 {
     return mName;
@@ -49,25 +46,29 @@ Channel::GetName()
 
 Channels::Channels()
 {
+    mCount = 0;
+    mGeneration = 0;
 }
 
-Channels::Channels( const wxString & name )
+Channels::Channels( const std::string & name )
 {
     mName = name;
+    mCount = 0;
+    mGeneration = 0;
 }
 
 Channels::~Channels()
 {
 }
 
-wxString
+std::string
 Channels::GetName()
 {
     return mName;
 }
 
 void
-Channels::SetName( const wxString & name )
+Channels::SetName( const std::string & name )
 {
     mName = name;
 }
@@ -75,58 +76,152 @@ Channels::SetName( const wxString & name )
 Channel *
 Channels::GetChannel( int id )
 {
+    if( id < 1 || id >= (int) mKnown.size() || !mKnown[ id ] )
+    {
+        return NULL;
+    }
+
     return &mChannels[ id ];
 }
 
 Channel *
-Channels::GetChannel( const wxString & name )
+Channels::GetChannel( const std::string & name )
 {
-    std::map< int, Channel >::iterator iter;
-
-    for( iter = mChannels.begin(); iter != mChannels.end(); iter++ )
-    {
-        if( iter->second.GetName().IsSameAs( name ) )
-        {
-            return &iter->second;
-        }
-    }
+    int id = Find( name.c_str() );
 
-    return NULL;
+    return id > 0 ? &mChannels[ id ] : NULL;
 }
 
 int
-Channels::GetChannelID( const wxString & name )
+Channels::GetChannelID( const std::string & name )
 {
-    std::map< int, Channel >::iterator iter;
+    return GetChannelID( name.c_str() );
+}
 
-    for( iter = mChannels.begin(); iter != mChannels.end(); iter++ )
-    {
-        if( iter->second.GetName().IsSameAs( name ) )
-        {
-            return iter->first;
-        }
-    }
+// For the echo handlers, which have the name in a buffer: no
+// std::string is made, whatever the length of the name
+int
+Channels::GetChannelID( const char *name )
+{
+    int id = Find( name );
 
-    return -1;
+    return id > 0 ? id : -1;
 }
 
-wxString
+std::string
 Channels::GetChannelName( int id )
 {
-    return mChannels[ id ].GetName();
+    Channel *chan = GetChannel( id );
+
+    return chan ? chan->GetName() : std::string();
 }
 
+// A name echoed again, as every bank move does, is only compared
 void
-Channels::SetChannelName( int id, const wxString & name )
+Channels::SetChannelName( int id, const char *name )
 {
+    if( id < 1 )
+    {
+        return;
+    }
+
+    Channel *chan = GetChannel( id );
+    if( chan != NULL && chan->GetName() == name )
+    {
+        return;
+    }
+
+    if( id >= (int) mChannels.size() )
+    {
+        mChannels.resize( id + 1 );
+        mKnown.resize( id + 1, false );
+    }
+
+    if( !mKnown[ id ] )
+    {
+        mKnown[ id ] = true;
+        mCount++;
+    }
     mChannels[ id ].SetName( name );
-    
+    mGeneration++;
+
+    // Names change a handful of times per session, a rebuild is simpler
+    // than taking the old name out of the probe chains
+    Index();
 }
 
 int
 Channels::GetCount()
 {
-    return mChannels.size();
+    return mCount;
+}
+
+int
+Channels::GetGeneration()
+{
+    return mGeneration;
+}
+
+// FNV-1a over the characters as stored, no conversion
+unsigned int
+Channels::Hash( const char *name )
+{
+    unsigned int hash = 2166136261u;
+
+    for( const char *p = name; *p; p++ )
+    {
+        hash = ( hash ^ (unsigned char) *p ) * 16777619u;
+    }
+
+    return hash;
+}
+
+// Id of the channel with that name, 0 when there is none
+int
+Channels::Find( const char *name )
+{
+    if( mSlots.empty() )
+    {
+        return 0;
+    }
+
+    size_t mask = mSlots.size() - 1;
+    for( size_t i = Hash( name ) & mask; mSlots[ i ] != 0; i = ( i + 1 ) & mask )
+    {
+        if( mChannels[ mSlots[ i ] ].GetName() == name )
+        {
+            return mSlots[ i ];
+        }
+    }
+
+    return 0;
 }
 
+// At most half full.  Ids go in from the lowest, so a name used twice
+// finds the first channel with it, as the scan it replaces did.
+void
+Channels::Index()
+{
+    size_t size = 16;
+    while( size < (size_t) mCount * 2 )
+    {
+        size *= 2;
+    }
+    mSlots.assign( size, 0 );
+
+    size_t mask = size - 1;
+    for( int id = 1; id < (int) mChannels.size(); id++ )
+    {
+        if( !mKnown[ id ] || Find( mChannels[ id ].GetName().c_str() ) != 0 )
+        {
+            continue;
+        }
 
+        size_t i = Hash( mChannels[ id ].GetName().c_str() ) & mask;
+        while( mSlots[ i ] != 0 )
+        {
+            i = ( i + 1 ) & mask;
+        }
+        mSlots[ i ] = id;
+    }
+}
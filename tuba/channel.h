@@ -1,9 +1,8 @@
 #if !defined(CHANNEL_H)
 #define CHANNEL_H
 
-#include <map>
-
-#include <wx/string.h>
+#include <string>
+#include <vector>
 
 class Channel
 {
@@ -11,43 +10,62 @@ public:
    Channel();
    virtual ~Channel();
 
-   bool Init(const wxString & label, const wxString & name);
+   bool Init(const std::string & label, const std::string & name);
 
-   wxString GetOSCPattern();
-   void SetOSCPattern(const wxString & pattern);
+   std::string GetOSCPattern();
+   void SetOSCPattern(const std::string & pattern);
 
-   wxString GetName();
-   void SetName(const wxString & name);
+   const std::string & GetName();
+   void SetName(const std::string & name);
 
 private:
-   wxString mLabel;
-   wxString mName;
-   wxString mPattern;
+   std::string mLabel;
+   std::string mName;
+   std::string mPattern;
 };
 
+// Channels of a bus by id, as TotalMix numbers them (from 1), with an
+// index on the names.  Lookups neither allocate nor insert: an unknown
+// id or name gives NULL/-1/empty.
 class Channels
 {
 public:
    Channels();
-   Channels(const wxString & name);
+   Channels(const std::string & name);
    virtual ~Channels();
 
-   wxString GetName();
-   void SetName(const wxString & name);
+   std::string GetName();
+   void SetName(const std::string & name);
 
    Channel * GetChannel(int id);
-   Channel * GetChannel(const wxString & name);
+   Channel * GetChannel(const std::string & name);
 
-   int GetChannelID(const wxString & name);
+   int GetChannelID(const std::string & name);
+   int GetChannelID(const char *name);
 
-   wxString GetChannelName(int id);
-   void SetChannelName(int id, const wxString & name);
+   std::string GetChannelName(int id);
+   void SetChannelName(int id, const char *name);
 
+   // Channels with a name, not the highest id
    int GetCount();
 
+   // Bumped whenever a channel is added or renamed, so anything built
+   // from the channel positions knows when to rebuild
+   int GetGeneration();
+
+private:
+   static unsigned int Hash(const char *name);
+
+   int Find(const char *name);
+   void Index();
+
 private:
-   wxString mName;
-   std::map< int, Channel > mChannels;
+   std::string mName;
+   std::vector< Channel > mChannels;   // by id, [0] unused
+   std::vector< bool > mKnown;         // by id
+   std::vector< int > mSlots;          // open addressing on Hash(), ids or 0
+   int mCount;
+   int mGeneration;
 };
 
 
@@ -0,0 +1,270 @@
+/*
+  C++20 coroutines on top of EventLoop: protocol exchanges can be written
+  as straight code instead of a chain of callbacks, without a thread of
+  their own.
+
+  @code
+  Task<void> selectTrack(EventLoop &loop, AsyncSocket &mixer, SockAddr &addr, PacketWriter &nav) {
+    co_await mixer.sendTo(nav, addr);
+    while (const PacketSlot *p = co_await mixer.recv(200)) {
+      ... look for the /2/trackname echo in p->data, p->size ...
+    }
+    co_await sleep_for(loop, 50);
+  }
+
+  spawn(selectTrack(loop, mixer, addr, nav));
+  loop.run();
+  @endcode
+
+  A Task does not start until it is awaited or spawned. Everything runs on
+  the EventLoop thread: a coroutine waiting for a datagram is resumed
+  right from the loop's socket callback, so a round trip costs no more
+  context switches than a hand written handler. Only one coroutine at a
+  time may receive from an AsyncSocket.
+
+  Needs a C++20 compiler, the header is empty otherwise.
+*/
+
+#ifndef OSCPKT_CORO_HH
+#define OSCPKT_CORO_HH
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+# if __has_include(<coroutine>)
+#  define OSCPKT_HAVE_COROUTINES 1
+# endif
+#endif
+
+#ifdef OSCPKT_HAVE_COROUTINES
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+#include "oscpkt.h"
+#include "eventloop.h"
+
+namespace oscpkt {
+
+template <typename T> class Task;
+
+namespace detail {
+
+  /* when a task finishes, whoever awaited it carries on */
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    template <typename P> std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+      std::coroutine_handle<> next = h.promise().continuation;
+      return next ? next : std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+
+  struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  template <typename T> struct Promise : PromiseBase {
+    T value;
+    Task<T> get_return_object();
+    void return_value(T v) { value = std::move(v); }
+    T result() { return std::move(value); }
+  };
+
+  template <> struct Promise<void> : PromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+    void result() {}
+  };
+
+  /* owns a spawned task until it is done, then goes away by itself */
+  struct Detached {
+    struct promise_type {
+      Detached get_return_object() { return Detached(); }
+      std::suspend_never initial_suspend() noexcept { return {}; }
+      std::suspend_never final_suspend() noexcept { return {}; }
+      void return_void() {}
+      void unhandled_exception() { std::terminate(); }
+    };
+  };
+
+} // namespace detail
+
+/** a coroutine returning T, started by co_await or spawn() */
+template <typename T = void>
+class Task {
+public:
+  typedef detail::Promise<T> promise_type;
+
+  Task() {}
+  explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+  Task(Task &&other) : handle(other.handle) { other.handle = nullptr; }
+  Task &operator=(Task &&other) {
+    if (this != &other) { if (handle) handle.destroy(); handle = other.handle; other.handle = nullptr; }
+    return *this;
+  }
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+  ~Task() { if (handle) handle.destroy(); }
+
+  bool done() const { return !handle || handle.done(); }
+
+  bool await_ready() const { return !handle || handle.done(); }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+    handle.promise().continuation = awaiting;
+    return handle;
+  }
+  T await_resume() { return handle.promise().result(); }
+
+private:
+  std::coroutine_handle<promise_type> handle;
+};
+
+namespace detail {
+  template <typename T> Task<T> Promise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<Promise<T> >::from_promise(*this));
+  }
+  inline Task<void> Promise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<Promise<void> >::from_promise(*this));
+  }
+  inline Detached runDetached(Task<void> task) { co_await task; }
+}
+
+/** start a task that nobody awaits, it runs until its first suspension
+    right away and is freed when it returns */
+inline void spawn(Task<void> task) { detail::runDetached(std::move(task)); }
+
+/** co_await sleep_for(loop, ms): resume on the loop after ms milliseconds */
+class SleepAwaiter {
+public:
+  SleepAwaiter(EventLoop &l, int ms) : loop(l), delay(ms) {}
+  bool await_ready() const { return false; }
+  bool await_suspend(std::coroutine_handle<> h) {
+    /* no timer available: do not leave the coroutine hanging forever */
+    return loop.addTimer(delay, [h]() { h.resume(); }, false) != -1;
+  }
+  void await_resume() {}
+private:
+  EventLoop &loop;
+  int delay;
+};
+
+inline SleepAwaiter sleep_for(EventLoop &loop, int ms) { return SleepAwaiter(loop, ms); }
+
+/**
+   A UdpSocket watched by an EventLoop, with awaitable receive and send.
+
+   Datagrams that arrive while no coroutine is waiting are copied into a
+   small preallocated inbox (inbox_slots of slot_size bytes), the oldest
+   being kept when it overflows (see dropped()).
+*/
+class AsyncSocket {
+public:
+  AsyncSocket(EventLoop &l, UdpSocket &s, size_t inbox_slots = 16, size_t slot_size = 4096)
+    : loop(l), sock(s), timer(-1), result(0), held(false), head(0), count(0), lost(0) {
+    if (inbox_slots == 0) inbox_slots = 1;
+    buffers.resize(inbox_slots * slot_size);
+    for (size_t i = 0; i < inbox_slots; ++i) inbox.push_back(PacketSlot(&buffers[i * slot_size], slot_size));
+    loop.add(sock, [this](UdpSocket &, PacketSlot &ps) { deliver(ps); });
+  }
+  ~AsyncSocket() {
+    loop.remove(sock);
+    if (timer != -1) loop.cancelTimer(timer);
+  }
+
+  UdpSocket &socket() { return sock; }
+  /** datagrams that did not fit in the inbox */
+  unsigned long dropped() const { return lost; }
+
+  class RecvAwaiter {
+  public:
+    RecvAwaiter(AsyncSocket &s, int ms) : as(s), timeout_ms(ms) {}
+    bool await_ready() { return as.count != 0 || timeout_ms == 0; }
+    void await_suspend(std::coroutine_handle<> h) {
+      as.waiter = h; as.result = 0;
+      if (timeout_ms > 0) as.timer = as.loop.addTimer(timeout_ms, [this]() { as.timer = -1; as.wake(); }, false);
+    }
+    const PacketSlot *await_resume() {
+      if (as.result) { const PacketSlot *p = as.result; as.result = 0; return p; }
+      if (as.count) { as.held = true; return &as.inbox[as.head]; }
+      return 0;
+    }
+  private:
+    AsyncSocket &as;
+    int timeout_ms;
+  };
+
+  /** co_await recv(ms): the next datagram, or null after timeout_ms (-1
+      waits forever, 0 only looks at what is already there). It may
+      point into the loop's buffers: use it before the next co_await. */
+  RecvAwaiter recv(int timeout_ms = -1) {
+    release();
+    return RecvAwaiter(*this, timeout_ms);
+  }
+
+  /* udp sends do not wait for anything, but keep the code symmetric */
+  class SendAwaiter {
+  public:
+    explicit SendAwaiter(bool r) : ok(r) {}
+    bool await_ready() const { return true; }
+    void await_suspend(std::coroutine_handle<>) {}
+    bool await_resume() const { return ok; }
+  private:
+    bool ok;
+  };
+
+  /** co_await send(pw): send to the connected peer (or whoever spoke last) */
+  SendAwaiter send(PacketWriter &pw) { return SendAwaiter(sock.sendPacket(pw.packetData(), pw.packetSize())); }
+  SendAwaiter send(const void *data, size_t size) { return SendAwaiter(sock.sendPacket(data, size)); }
+  SendAwaiter sendTo(PacketWriter &pw, SockAddr &addr) {
+    return SendAwaiter(sock.sendPacketTo(pw.packetData(), pw.packetSize(), addr));
+  }
+
+private:
+  void deliver(PacketSlot &ps) {
+    if (waiter && count == 0) {
+      /* straight from the loop's buffer, no copy */
+      result = &ps;
+      wake();
+      return;
+    }
+    if (count == inbox.size()) { ++lost; return; }
+    PacketSlot &dst = inbox[(head + count) % inbox.size()];
+    dst.size = ps.size < dst.capacity ? ps.size : dst.capacity;
+    dst.truncated = ps.truncated || ps.size > dst.capacity;
+    dst.addr = ps.addr;
+    memcpy(dst.data, ps.data, dst.size);
+    ++count;
+    if (waiter) wake();
+  }
+
+  void wake() {
+    if (timer != -1) { loop.cancelTimer(timer); timer = -1; }
+    std::coroutine_handle<> h = waiter;
+    waiter = nullptr;
+    if (h) h.resume();
+  }
+
+  void release() {
+    if (held) { held = false; head = (head + 1) % inbox.size(); --count; }
+  }
+
+  EventLoop &loop;
+  UdpSocket &sock;
+  std::coroutine_handle<> waiter;
+  int timer;
+  const PacketSlot *result; /* handed over by deliver(), points into the loop's slots */
+  bool held;                /* the inbox head was returned by the last recv */
+  std::vector<char> buffers;
+  std::vector<PacketSlot> inbox;
+  size_t head, count;
+  unsigned long lost;
+};
+
+} // namespace oscpkt
+
+#endif // OSCPKT_HAVE_COROUTINES
+
+#endif // OSCPKT_CORO_HH
@@ -0,0 +1,222 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cursor.h"
+
+// ====================================================================
+//
+// ====================================================================
+TrackCursor::TrackCursor(int page)
+:  mTrail(page, 0)
+{
+   char addr[32];
+
+   mRewinds = 0;
+   mDesyncs = 0;
+
+   snprintf(addr, sizeof(addr), "/%d/track-", page);
+   mPrev.init(addr).pushFloat(1.0f);
+   snprintf(addr, sizeof(addr), "/%d/track+", page);
+   mNext.init(addr).pushFloat(1.0f);
+}
+
+// ====================================================================
+//
+// ====================================================================
+TrackCursor::~TrackCursor()
+{
+}
+
+// ====================================================================
+//
+// ====================================================================
+int TrackCursor::AddBus(const char *name)
+{
+   mCounts.push_back(0);
+
+   return mTrail.AddBus(name);
+}
+
+// ====================================================================
+//
+// ====================================================================
+void TrackCursor::SetLookup(Lookup lookup)
+{
+   mLookup = lookup;
+}
+
+// ====================================================================
+// Only the difference from where the cursor is, unless it is unknown
+// ====================================================================
+void TrackCursor::Navigate(oscpkt::PacketWriter & pw, int bus, int id, int count, const oscpkt::Message *msg, bool echo)
+{
+   int track = mTrail.GetPosition(bus);
+
+   bool select = mTrail.GetBus() != bus;
+   bool rewind = track < 1 || mCounts[bus] != count || track > count;
+   int delta = rewind ? 0 : id - track;
+
+   // Already there: step off and back so the mixer echoes the channel
+   bool nudge = echo && !rewind && delta == 0 && count > 1;
+   if (echo && !rewind && delta == 0 && count <= 1)
+   {
+      select = true;
+   }
+
+   size_t n = (select ? 1 : 0) + (msg ? 1 : 0) + (nudge ? 2 : 0);
+   n += rewind ? count + id - 1 : abs(delta);
+
+   pw.init();
+   if (n > 1)
+   {
+      pw.startBundle();
+   }
+
+   if (select)
+   {
+      pw.addMessage(mTrail.GetSelect(bus));
+      mTrail.Visit(bus, track);
+   }
+   mTrail.SetBus(bus);
+
+   if (rewind)
+   {
+      for (int i = 0; i < count; i++)
+      {
+         pw.addMessage(mPrev);
+      }
+      for (int i = 1; i < id; i++)
+      {
+         pw.addMessage(mNext);
+      }
+      // Down from anywhere to the first channel, then up one by one
+      mTrail.Visit(bus, 0);
+      for (int i = 1; i < id; i++)
+      {
+         mTrail.Visit(bus, i);
+      }
+      mRewinds++;
+   }
+   else if (nudge)
+   {
+      pw.addMessage(id > 1 ? mPrev : mNext);
+      pw.addMessage(id > 1 ? mNext : mPrev);
+      mTrail.Visit(bus, id > 1 ? id - 1 : id + 1);
+   }
+   else
+   {
+      for (int i = 0; i < delta; i++)
+      {
+         pw.addMessage(mNext);
+         mTrail.Visit(bus, track + i);
+      }
+      for (int i = 0; i > delta; i--)
+      {
+         pw.addMessage(mPrev);
+         mTrail.Visit(bus, track + i);
+      }
+   }
+   mTrail.Visit(bus, id);
+
+   mTrail.SetPosition(bus, id);
+   mCounts[bus] = count;
+
+   if (msg)
+   {
+      pw.addMessage(*msg);
+   }
+
+   if (n > 1)
+   {
+      pw.endBundle();
+   }
+}
+
+// ====================================================================
+// A page 2 bus button echoed as selected
+// ====================================================================
+void TrackCursor::OnBus(int bus)
+{
+   if (!mTrail.OnBus(bus))
+   {
+      mDesyncs++;
+   }
+}
+
+// ====================================================================
+// The page 2 channel name, echoed wherever the cursor lands
+// ====================================================================
+void TrackCursor::OnTrackName(const char *name)
+{
+   if (!mLookup || mTrail.IsEmpty())
+   {
+      // Nothing to check against, the next navigation rewinds anyway
+      return;
+   }
+
+   // The way down of a rewind could show any channel but the first,
+   // which is where the way up starts
+   int i = mTrail.Find([this, name](int bus, int track)
+   {
+      int id = mLookup(bus, name);
+      return track == 0 ? id > 1 : id == track;
+   });
+   if (i >= 0)
+   {
+      mTrail.Reached(i);
+      return;
+   }
+
+   mDesyncs++;
+   Invalidate();
+}
+
+// ====================================================================
+//
+// ====================================================================
+void TrackCursor::Invalidate()
+{
+   mTrail.Invalidate();
+}
+
+// ====================================================================
+//
+// ====================================================================
+int TrackCursor::GetBus()
+{
+   return mTrail.GetBus();
+}
+
+// ====================================================================
+//
+// ====================================================================
+int TrackCursor::GetTrack(int bus)
+{
+   return mTrail.GetPosition(bus);
+}
+
+// ====================================================================
+// Navigations that had to start from the first channel
+// ====================================================================
+unsigned long TrackCursor::GetRewinds()
+{
+   return mRewinds;
+}
+
+// ====================================================================
+// Echoes that did not match anything we sent
+// ====================================================================
+unsigned long TrackCursor::GetDesyncs()
+{
+   return mDesyncs;
+}
@@ -0,0 +1,76 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(CURSOR_H)
+#define CURSOR_H
+
+#include <functional>
+#include <vector>
+
+#include "oscpkt.h"
+#include "trail.h"
+
+// ====================================================================
+// Where the mixer's page 2 cursor is: the selected bus, and the channel
+// selected on each bus.
+//
+// Navigating used to mean a full rewind every time (one track- per
+// channel of the bus, then track+ up to the target).  With the cursor
+// known, only the difference is sent.  The echoes the mixer sends back
+// are checked against the positions our own navigations went through;
+// anything else means the cursor was moved behind our back (the
+// TotalMix window, another client), and the next navigation rewinds.
+// ====================================================================
+class TrackCursor
+{
+public:
+   // Channel id (1 based) of name on bus, < 1 when there is none
+   typedef std::function<int (int bus, const char *name)> Lookup;
+
+   TrackCursor(int page = 2);
+   virtual ~TrackCursor();
+
+   // The buses, in the order of the ids the other calls use
+   int AddBus(const char *name);
+   void SetLookup(Lookup lookup);
+
+   // Fill pw with what leaves the cursor on channel id of bus (which has
+   // count channels), followed by msg unless it is NULL.  With echo, the
+   // cursor is made to land on the channel even when it is already
+   // there, so that the mixer echoes its values.
+   void Navigate(oscpkt::PacketWriter & pw, int bus, int id, int count, const oscpkt::Message *msg, bool echo = false);
+
+   // Echoes from the mixer
+   void OnBus(int bus);
+   void OnTrackName(const char *name);
+
+   // Forget everything, the next navigation rewinds
+   void Invalidate();
+
+   int GetBus();
+   int GetTrack(int bus);
+
+   unsigned long GetRewinds();
+   unsigned long GetDesyncs();
+
+private:
+   // Channel of each bus, 0 when unknown, and the channels it had when
+   // it was set.  The last position visited is where the cursor should be.
+   NavTrail mTrail;
+   std::vector<int> mCounts;
+   oscpkt::Message mPrev;
+   oscpkt::Message mNext;
+   Lookup mLookup;
+
+   unsigned long mRewinds;
+   unsigned long mDesyncs;
+};
+
+#endif
@@ -0,0 +1,337 @@
+/*
+  This file provides a small event loop for UdpSockets and timers, so
+  that one thread can serve any number of sockets.
+
+  On linux it is built on epoll (edge triggered) and timerfd, each socket
+  is drained with recvmmsg until it has nothing left. Elsewhere it falls
+  back on select() and a list of timer deadlines. One shot timers always
+  use the deadline list: they are often short lived timeouts, and then
+  cost no system call to arm or cancel.
+
+  @code
+  EventLoop loop;
+  loop.add(sock, [](UdpSocket &s, PacketSlot &p) { ... p.data, p.size, p.addr ... });
+  loop.addTimer(50, [&]() { ... });
+  loop.run();
+  @endcode
+
+  Everything, callbacks included, runs on the thread that calls run() or
+  runOnce(). The only call allowed from another thread is wakeup().
+*/
+
+#ifndef OSCPKT_EVENTLOOP_HH
+#define OSCPKT_EVENTLOOP_HH
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "udp.h"
+
+#if defined(__linux__)
+# define OSCPKT_HAVE_EPOLL 1
+# include <sys/epoll.h>
+# include <sys/timerfd.h>
+# include <sys/eventfd.h>
+#endif
+
+namespace oscpkt {
+
+class EventLoop {
+public:
+  /** called for each datagram received on a socket */
+  typedef std::function<void (UdpSocket &, PacketSlot &)> PacketHandler;
+  typedef std::function<void ()> Handler;
+
+  /** batch is the number of datagrams read per system call, each of them
+      can be up to slot_size bytes (larger ones are flagged truncated) */
+  EventLoop(size_t batch = 16, size_t slot_size = 65536) : stopped(false), next_timer(1) {
+    if (batch == 0) batch = 1;
+    buffers.resize(batch * slot_size);
+    for (size_t i = 0; i < batch; ++i) slots.push_back(PacketSlot(&buffers[i * slot_size], slot_size));
+#ifdef OSCPKT_HAVE_EPOLL
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epfd == -1 || wakefd == -1) { setErr(strerror(errno)); return; }
+    struct epoll_event ev; memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLIN; ev.data.fd = wakefd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev);
+#else
+    /* a socket talking to itself, select() can wait on it along with the others */
+    if (waker.bindTo(0)) {
+      wake_addr = waker.local_addr;
+      ((struct sockaddr_in *)&wake_addr.addr())->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    } else setErr("wakeup socket: " + waker.errorMessage());
+#endif
+  }
+
+  ~EventLoop() {
+#ifdef OSCPKT_HAVE_EPOLL
+    for (std::map<int, Timer>::iterator it = timers.begin(); it != timers.end(); ++it) {
+      if (it->second.fd != -1) ::close(it->second.fd);
+    }
+    if (wakefd != -1) ::close(wakefd);
+    if (epfd != -1) ::close(epfd);
+#endif
+  }
+
+  bool isOk() const { return error_message.empty(); }
+  const std::string &errorMessage() const { return error_message; }
+
+  /** watch a (bound) socket, handler is called for every datagram it receives */
+  bool add(UdpSocket &sock, PacketHandler handler) {
+    if (!sock.isOk() || sock.socketHandle() == -1) return false;
+    int fd = sock.pollHandle();
+    /* switched to io_uring since: the old handle is not the one to watch */
+    std::map<UdpSocket *, int>::iterator old = registered.find(&sock);
+    if (old != registered.end() && old->second != fd) remove(sock);
+#ifdef OSCPKT_HAVE_EPOLL
+    struct epoll_event ev; memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLIN | EPOLLET; ev.data.fd = fd;
+    int op = sockets.count(fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(epfd, op, fd, &ev) != 0) { setErr(strerror(errno)); return false; }
+#endif
+    Socket &s = sockets[fd];
+    s.sock = &sock; s.handler = handler;
+    registered[&sock] = fd;
+    /* edge triggered: whatever is already queued would never be signaled */
+    pending.push_back(fd);
+    return true;
+  }
+
+  /** stop watching a socket, safe to call from a callback. The handle
+      it was added with is the one removed, whatever it polls on now. */
+  void remove(UdpSocket &sock) {
+    std::map<UdpSocket *, int>::iterator it = registered.find(&sock);
+    if (it == registered.end()) return;
+    int fd = it->second;
+    registered.erase(it);
+    sockets.erase(fd);
+#ifdef OSCPKT_HAVE_EPOLL
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, 0);
+#endif
+  }
+
+  /** call handler every interval_ms (or once when repeat is false).
+      Returns an id for cancelTimer, -1 on failure. */
+  int addTimer(int interval_ms, Handler handler, bool repeat = true) {
+    if (interval_ms < 0) interval_ms = 0;
+    Timer t;
+    t.fd = -1;
+    t.interval = std::chrono::milliseconds(interval_ms); t.repeat = repeat; t.handler = handler;
+    t.deadline = Clock::now() + t.interval;
+    int id = next_timer++;
+#ifdef OSCPKT_HAVE_EPOLL
+    if (repeat) {
+      t.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+      if (t.fd == -1) { setErr(strerror(errno)); return -1; }
+      struct itimerspec its; memset(&its, 0, sizeof its);
+      its.it_value.tv_sec = interval_ms / 1000; its.it_value.tv_nsec = (interval_ms % 1000) * 1000000L;
+      if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) its.it_value.tv_nsec = 1; /* 0 would disarm it */
+      its.it_interval = its.it_value;
+      struct epoll_event ev; memset(&ev, 0, sizeof ev);
+      ev.events = EPOLLIN; ev.data.fd = t.fd;
+      if (timerfd_settime(t.fd, 0, &its, 0) != 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, t.fd, &ev) != 0) {
+        setErr(strerror(errno)); ::close(t.fd); return -1;
+      }
+      timer_fds[t.fd] = id;
+    }
+#endif
+    timers[id] = t;
+    return id;
+  }
+
+  /** safe to call from a callback, including the timer's own */
+  void cancelTimer(int id) {
+    std::map<int, Timer>::iterator it = timers.find(id);
+    if (it == timers.end()) return;
+#ifdef OSCPKT_HAVE_EPOLL
+    if (it->second.fd != -1) {
+      ::close(it->second.fd); /* also removes it from the epoll set */
+      timer_fds.erase(it->second.fd);
+    }
+#endif
+    timers.erase(it);
+  }
+
+  /** called on the loop thread after wakeup() */
+  void onWakeup(Handler handler) { wake_handler = handler; }
+
+  /** make a blocked runOnce() return, callable from any thread */
+  void wakeup() {
+#ifdef OSCPKT_HAVE_EPOLL
+    uint64_t one = 1;
+    if (::write(wakefd, &one, sizeof one) < 0) { /* already signaled */ }
+#else
+    char c = 0;
+    waker.sendPacketTo(&c, 1, wake_addr);
+#endif
+  }
+
+  /** wait up to timeout_ms (forever when -1) for something to happen, and
+      run the callbacks. Returns the number of callbacks run, -1 on error. */
+  int runOnce(int timeout_ms = -1) {
+    if (!isOk()) return -1;
+    int count = drainPending();
+    if (count) timeout_ms = 0; /* still poll, but do not sleep */
+    timeout_ms = nextDeadline(timeout_ms);
+#ifdef OSCPKT_HAVE_EPOLL
+    struct epoll_event events[32];
+    int n = epoll_wait(epfd, events, 32, timeout_ms);
+    if (n < 0) {
+      if (errno != EINTR) setErr(strerror(errno));
+      return isOk() ? count : -1;
+    }
+    for (int i = 0; i < n; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == wakefd) {
+        uint64_t v;
+        if (::read(wakefd, &v, sizeof v) > 0 && wake_handler) { wake_handler(); ++count; }
+      } else if (timer_fds.count(fd)) {
+        uint64_t expirations;
+        if (::read(fd, &expirations, sizeof expirations) > 0) count += fireTimer(timer_fds[fd]);
+      } else {
+        count += drain(fd);
+      }
+    }
+#else
+    fd_set readset;
+    FD_ZERO(&readset);
+    int maxfd = waker.socketHandle();
+    FD_SET(waker.socketHandle(), &readset);
+    for (std::map<int, Socket>::iterator it = sockets.begin(); it != sockets.end(); ++it) {
+      FD_SET(it->first, &readset);
+      if (it->first > maxfd) maxfd = it->first;
+    }
+    struct timeval tv; memset(&tv, 0, sizeof tv);
+    tv.tv_sec = timeout_ms / 1000; tv.tv_usec = (timeout_ms % 1000) * 1000;
+    int n = select(maxfd + 1, &readset, 0, 0, timeout_ms < 0 ? 0 : &tv);
+    if (n > 0) {
+      if (FD_ISSET(waker.socketHandle(), &readset)) {
+        PacketSlot ps(&buffers[0], slots[0].capacity);
+        while (waker.receiveBatch(&ps, 1, 0)) {}
+        if (wake_handler) { wake_handler(); ++count; }
+      }
+      std::vector<int> ready;
+      for (std::map<int, Socket>::iterator it = sockets.begin(); it != sockets.end(); ++it) {
+        if (FD_ISSET(it->first, &readset)) ready.push_back(it->first);
+      }
+      for (size_t i = 0; i < ready.size(); ++i) count += drain(ready[i]);
+    }
+#endif
+    count += fireDeadlines();
+    return count;
+  }
+
+  /** run until stop() is called from a callback */
+  void run() {
+    stopped = false;
+    while (!stopped && runOnce(-1) >= 0) {}
+  }
+  void stop() { stopped = true; }
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Socket {
+    UdpSocket *sock;
+    PacketHandler handler;
+  };
+  struct Timer {
+    Clock::duration interval;
+    Clock::time_point deadline; /* unless fd is used */
+    bool repeat;
+    int fd;                     /* timerfd for repeating timers, epoll only */
+    Handler handler;
+  };
+
+  void setErr(const std::string &msg) {
+    if (error_message.empty()) error_message = msg;
+  }
+
+  /* read everything queued on the socket, until it would block */
+  int drain(int fd) {
+    int count = 0;
+    for (;;) {
+      std::map<int, Socket>::iterator it = sockets.find(fd);
+      if (it == sockets.end()) break; /* removed by a callback */
+      UdpSocket &sock = *it->second.sock;
+      size_t n = sock.receiveBatch(&slots[0], slots.size(), 0);
+      if (n == 0) break;
+      PacketHandler handler = it->second.handler; /* the entry may go away while it runs */
+      for (size_t i = 0; i < n; ++i, ++count) handler(sock, slots[i]);
+    }
+    return count;
+  }
+
+  int drainPending() {
+    int count = 0;
+    while (!pending.empty()) {
+      int fd = pending.back(); pending.pop_back();
+      count += drain(fd);
+    }
+    return count;
+  }
+
+  /* timeout_ms, shortened to the closest timer deadline */
+  int nextDeadline(int timeout_ms) {
+    Clock::time_point now = Clock::now();
+    for (std::map<int, Timer>::iterator it = timers.begin(); it != timers.end(); ++it) {
+      if (it->second.fd != -1) continue;
+      long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(it->second.deadline - now + std::chrono::microseconds(999)).count();
+      if (ms < 0) ms = 0;
+      if (timeout_ms < 0 || ms < timeout_ms) timeout_ms = (int)ms;
+    }
+    return timeout_ms;
+  }
+
+  int fireDeadlines() {
+    if (timers.empty()) return 0;
+    Clock::time_point now = Clock::now();
+    std::vector<int> due;
+    for (std::map<int, Timer>::iterator it = timers.begin(); it != timers.end(); ++it) {
+      if (it->second.fd == -1 && it->second.deadline <= now) due.push_back(it->first);
+    }
+    int count = 0;
+    for (size_t i = 0; i < due.size(); ++i) count += fireTimer(due[i]);
+    return count;
+  }
+
+  int fireTimer(int id) {
+    std::map<int, Timer>::iterator it = timers.find(id);
+    if (it == timers.end()) return 0;
+    Handler handler = it->second.handler;
+    if (!it->second.repeat) cancelTimer(id);
+    else if (it->second.fd == -1) {
+      /* skip the ticks we were too late for, like timerfd does */
+      Clock::time_point now = Clock::now();
+      do it->second.deadline += it->second.interval; while (it->second.deadline <= now && it->second.interval.count());
+      if (it->second.deadline <= now) it->second.deadline = now;
+    }
+    handler();
+    return 1;
+  }
+
+  std::string error_message;
+  bool stopped;
+  int next_timer;
+  std::vector<char> buffers;
+  std::vector<PacketSlot> slots;
+  std::map<int, Socket> sockets;
+  std::map<UdpSocket *, int> registered; /* socket -> the fd it was added with */
+  std::map<int, Timer> timers;
+  std::vector<int> pending;
+  Handler wake_handler;
+#ifdef OSCPKT_HAVE_EPOLL
+  int epfd, wakefd;
+  std::map<int, int> timer_fds; /* timerfd -> timer id */
+#else
+  UdpSocket waker;
+  SockAddr wake_addr;
+#endif
+};
+
+} // namespace oscpkt
+
+#endif // OSCPKT_EVENTLOOP_HH
@@ -0,0 +1,335 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#include <string.h>
+
+#include "iothread.h"
+
+#define SEND_RETRY_MS 5       // a send that failed is tried again this much later
+#define SEND_GIVE_UP_MS 50    // and given up on once failing for this long
+
+// ====================================================================
+//
+// ====================================================================
+IoThread::IoThread()
+:  mOutbound(256),
+   mInbound(1024),
+   mLoop(16, 4096),
+   mBatch(16)
+{
+   mRunning = false;
+   mReceived = 0;
+   mDropped = 0;
+   mUnsent = 0;
+   mFailing = false;
+   mRetryTimer = -1;
+}
+
+// ====================================================================
+//
+// ====================================================================
+IoThread::~IoThread()
+{
+   Stop();
+}
+
+// ====================================================================
+//
+// ====================================================================
+int IoThread::AddRoute(const char *pattern)
+{
+   // The router replaces the handler of a pattern added again, and does
+   // not count it, so the route it already has is kept
+   for (size_t i = 0; i < mPatterns.size(); i++)
+   {
+      if (mPatterns[i] == pattern)
+      {
+         return (int) i;
+      }
+   }
+
+   int route = (int) mPatterns.size();
+   mPatterns.push_back(pattern);
+
+   mRouter.add(pattern, [this, route](const oscpkt::MessageView & msg) { Publish(route, msg); });
+
+   return route;
+}
+
+// ====================================================================
+// Open the socket and start the thread
+// ====================================================================
+bool IoThread::Start(int localPort, const char *host, int remotePort)
+{
+   if (!mSock.bindTo(localPort))
+   {
+      mError = mSock.errorMessage();
+      return false;
+   }
+
+   char port[16];
+   snprintf(port, sizeof(port), "%d", remotePort);
+
+   struct addrinfo hints;
+   struct addrinfo *result = NULL;
+   memset(&hints, 0, sizeof(hints));
+   hints.ai_family = AF_INET;
+   hints.ai_socktype = SOCK_DGRAM;
+   if (getaddrinfo(host, port, &hints, &result) != 0 || result == NULL)
+   {
+      mError = "unable to resolve ";
+      mError += host;
+      return false;
+   }
+   memcpy(&mRemote.addr(), result->ai_addr, result->ai_addrlen);
+   freeaddrinfo(result);
+
+   if (!mLoop.isOk())
+   {
+      mError = mLoop.errorMessage();
+      return false;
+   }
+
+   mLoop.add(mSock, [this](oscpkt::UdpSocket &, oscpkt::PacketSlot & slot) { OnPacket(slot); });
+   mLoop.onWakeup([this]() { Flush(); });
+
+   mRunning = true;
+   mThread = std::thread(&IoThread::Run, this);
+
+   return true;
+}
+
+// ====================================================================
+//
+// ====================================================================
+void IoThread::Stop()
+{
+   if (mThread.joinable())
+   {
+      mRunning = false;
+      mLoop.wakeup();
+      mThread.join();
+   }
+
+   mSock.close();
+}
+
+// ====================================================================
+//
+// ====================================================================
+const std::string & IoThread::GetError()
+{
+   return mError;
+}
+
+// ====================================================================
+// Port the socket is bound to, handy when Start() was given 0
+// ====================================================================
+int IoThread::GetLocalPort()
+{
+   return mSock.boundPort();
+}
+
+// ====================================================================
+// UI thread
+// ====================================================================
+bool IoThread::Send(const void *data, size_t size)
+{
+   OutPacket *pkt = mOutbound.Back();
+   if (pkt == NULL || data == NULL || size > sizeof(pkt->data))
+   {
+      return false;
+   }
+
+   memcpy(pkt->data, data, size);
+   pkt->size = size;
+   mOutbound.Push();
+
+   mLoop.wakeup();
+
+   return true;
+}
+
+// ====================================================================
+// UI thread
+// ====================================================================
+const OscUpdate *IoThread::Front()
+{
+   return mInbound.Front();
+}
+
+// ====================================================================
+// UI thread
+// ====================================================================
+void IoThread::Pop()
+{
+   mInbound.Pop();
+}
+
+// ====================================================================
+//
+// ====================================================================
+unsigned long IoThread::GetReceived()
+{
+   return mReceived.load(std::memory_order_acquire);
+}
+
+// ====================================================================
+//
+// ====================================================================
+unsigned long IoThread::GetDropped()
+{
+   return mDropped.load(std::memory_order_relaxed);
+}
+
+// ====================================================================
+//
+// ====================================================================
+unsigned long IoThread::GetUnsent()
+{
+   return mUnsent.load(std::memory_order_relaxed);
+}
+
+// ====================================================================
+// I/O thread
+// ====================================================================
+void IoThread::Run()
+{
+   while (mRunning)
+   {
+      mLoop.runOnce(-1);
+   }
+}
+
+// ====================================================================
+// Everything the UI queued goes out, as few system calls as possible
+// ====================================================================
+void IoThread::Flush()
+{
+   OutPacket *pkt;
+   size_t cnt = 0;
+
+   while ((pkt = mOutbound.Front(cnt)) != NULL)
+   {
+      mBatch[cnt].data = pkt->data;
+      mBatch[cnt].size = pkt->size;
+      mBatch[cnt].addr = mRemote;
+      if (++cnt == mBatch.size())
+      {
+         if (!SendBatch(cnt))
+         {
+            return;
+         }
+         cnt = 0;
+      }
+   }
+
+   if (cnt)
+   {
+      SendBatch(cnt);
+   }
+}
+
+// ====================================================================
+// The first cnt queued packets, those that went out are popped.  The
+// rest stay queued, in order, and are tried again a little later, so
+// a navigation the mixer never got is not skipped.  Only one that has
+// been failing for a while is given up on, and counted.  Time, not
+// tries: every Send() from the UI flushes too.
+// ====================================================================
+bool IoThread::SendBatch(size_t cnt)
+{
+   size_t sent = mSock.sendBatch(&mBatch[0], cnt);
+
+   mOutbound.Pop(sent);
+   if (sent == cnt)
+   {
+      mFailing = false;
+      return true;
+   }
+
+   Clock::time_point now = Clock::now();
+   if (sent > 0 || !mFailing)
+   {
+      // A packet failing for the first time
+      mFailing = true;
+      mFailingSince = now;
+   }
+   else if (now - mFailingSince >= std::chrono::milliseconds(SEND_GIVE_UP_MS))
+   {
+      mOutbound.Pop();
+      mUnsent.fetch_add(1, std::memory_order_relaxed);
+      mFailing = false;
+   }
+
+   if (mRetryTimer < 0)
+   {
+      mRetryTimer = mLoop.addTimer(SEND_RETRY_MS, [this]()
+      {
+         mRetryTimer = -1;
+         Flush();
+      }, false);
+   }
+
+   return false;
+}
+
+// ====================================================================
+// I/O thread
+// ====================================================================
+void IoThread::OnPacket(oscpkt::PacketSlot & slot)
+{
+   if (!slot.truncated)
+   {
+      oscpkt::PacketViewReader pr(slot.data, slot.size);
+      mRouter.dispatch(pr);
+   }
+
+   // After the updates, so the UI sees them when it sees the count move
+   mReceived.fetch_add(1, std::memory_order_release);
+}
+
+// ====================================================================
+// I/O thread
+// ====================================================================
+void IoThread::Publish(int route, const oscpkt::MessageView & msg)
+{
+   OscUpdate *u = mInbound.Back();
+   if (u == NULL)
+   {
+      mDropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+   }
+
+   u->route = route;
+   strncpy(u->address, msg.addressPattern(), sizeof(u->address) - 1);
+   u->address[sizeof(u->address) - 1] = '\0';
+   u->param = MixerState::ParamId(u->address);
+   u->type = 0;
+   u->value = 0.0f;
+   u->text[0] = '\0';
+
+   oscpkt::MessageView::ArgReader arg(msg);
+   if (arg.isFloat())
+   {
+      u->type = 'f';
+      arg.popFloat(u->value);
+   }
+   else if (arg.isStr())
+   {
+      const char *s;
+      u->type = 's';
+      arg.popStr(s);
+      strncpy(u->text, s, sizeof(u->text) - 1);
+      u->text[sizeof(u->text) - 1] = '\0';
+   }
+
+   mInbound.Push();
+}
@@ -0,0 +1,117 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(IOTHREAD_H)
+#define IOTHREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "oscpkt.h"
+#include "eventloop.h"
+#include "mixerstate.h"
+#include "spscring.h"
+
+// ====================================================================
+// A message the UI asked for, already parsed by the I/O thread
+// ====================================================================
+struct OscUpdate
+{
+   int route;                 // what AddRoute() returned for the matching pattern
+   char address[64];          // truncated if longer
+   int param;                 // PARAM_* the address ends with, -1 when none
+   char type;                 // type tag of the first argument: 'f', 's' or 0 for anything else
+   float value;
+   char text[64];
+};
+
+// ====================================================================
+// Outgoing packet, copied into the ring by the UI
+// ====================================================================
+struct OutPacket
+{
+   size_t size;
+   char data[4096];
+};
+
+// ====================================================================
+// Owns the socket and does all of the network work on its own thread.
+// The UI thread only copies packets into one ring and reads parsed
+// updates from another, so neither side ever waits for the other.
+// ====================================================================
+class IoThread
+{
+public:
+   typedef std::chrono::steady_clock Clock;
+
+   IoThread();
+   virtual ~IoThread();
+
+   // Addresses the UI wants to hear about, anything else is dropped on
+   // the I/O thread.  Must be called before Start().  A pattern added
+   // again keeps its route.
+   int AddRoute(const char *pattern);
+
+   bool Start(int localPort, const char *host, int remotePort);
+   void Stop();
+   const std::string & GetError();
+   int GetLocalPort();
+
+   // UI thread: queue a packet, false (and dropped) when the ring is full
+   bool Send(const void *data, size_t size);
+
+   // UI thread: next update, NULL when there is none.  Release it with
+   // Pop() before asking for the next one.
+   const OscUpdate *Front();
+   void Pop();
+
+   // Datagrams received so far, including the filtered out ones
+   unsigned long GetReceived();
+
+   // Updates lost because the UI was not draining fast enough
+   unsigned long GetDropped();
+
+   // Packets given up on after the socket kept refusing them.  Any one
+   // could have been a navigation, the cursor is not where we think.
+   unsigned long GetUnsent();
+
+private:
+   void Run();
+   void Flush();
+   bool SendBatch(size_t cnt);
+   void OnPacket(oscpkt::PacketSlot & slot);
+   void Publish(int route, const oscpkt::MessageView & msg);
+
+private:
+   SpscRing<OutPacket> mOutbound;
+   SpscRing<OscUpdate> mInbound;
+
+   oscpkt::UdpSocket mSock;
+   oscpkt::SockAddr mRemote;
+   oscpkt::EventLoop mLoop;
+   oscpkt::Router mRouter;
+   std::vector<oscpkt::PacketSlot> mBatch;
+   std::vector<std::string> mPatterns;  // by route
+   std::string mError;
+
+   std::thread mThread;
+   std::atomic<bool> mRunning;
+   std::atomic<unsigned long> mReceived;
+   std::atomic<unsigned long> mDropped;
+   std::atomic<unsigned long> mUnsent;
+   bool mFailing;             // I/O thread: the packet at the front failed
+   Clock::time_point mFailingSince;
+   int mRetryTimer;           // I/O thread: -1 when no retry is pending
+};
+
+#endif
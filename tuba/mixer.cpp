@@ -0,0 +1,721 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mixer.h"
+
+// Bus selections without their page, in BUS_* order
+static const char *BusNames[BUS_COUNT] =
+{
+   "busInput",
+   "busOutput",
+   "busPlayback",
+};
+
+// ====================================================================
+//
+// ====================================================================
+Mixer::Mixer()
+{
+   mReady = false;
+   mHolding = false;
+   mActive = -1;
+   mUnsent = 0;
+   for (int b = 0; b < BUS_COUNT; b++)
+   {
+      mNamed[b] = false;
+   }
+
+   // Everything we listen to, anything else (level meters...) is dropped
+   // by the I/O thread and never reaches us
+   mRoutes[ROUTE_BUS] = mIo.AddRoute("/*/bus*");
+   mRoutes[ROUTE_TRACKNAMES] = mIo.AddRoute("/1/trackname*");
+   mRoutes[ROUTE_VALUE] = mIo.AddRoute("/2/{volume,pan,mute,solo,gain,eqEnable,eqGain1,eqGain2,eqGain3}");
+   mRoutes[ROUTE_TRACKNAME] = mIo.AddRoute("/2/trackname");
+
+   // Requests that wait for their echo
+   mRequests.SetSender([this](const void *data, size_t size) { return mIo.Send(data, size); });
+
+   mChannels[BUS_INPUT].SetName("Input");
+   mChannels[BUS_OUTPUT].SetName("Output");
+   mChannels[BUS_PLAYBACK].SetName("Playback");
+
+   // In BUS_* order
+   mCursor.AddBus("Input");
+   mCursor.AddBus("Output");
+   mCursor.AddBus("Playback");
+   mCursor.SetLookup([this](int bus, const char *name) { return GetChannels(bus)->GetChannelID(name); });
+   mStrips.AddBus("Input");
+   mStrips.AddBus("Output");
+   mStrips.AddBus("Playback");
+   mStrips.SetLookup([this](int bus, const char *name) { return GetChannels(bus)->GetChannelID(name); });
+
+   mQueries.SetNavigator([this](int bus, const std::string & name) { return SendSelect(bus, name); });
+   mQueries.SetListener([this](const char *name, const ParamValues & values) { OnEcho(name, values); });
+}
+
+// ====================================================================
+//
+// ====================================================================
+Mixer::~Mixer()
+{
+}
+
+// ====================================================================
+//
+// ====================================================================
+int Mixer::AddControl(int page, int bus, const char *name, const char *param)
+{
+   char addr[64];
+   Binding b;
+   b.page = page;
+   b.bus = bus;
+   b.name = name;
+   b.param = param;
+   b.paramId = -1;
+   b.channel = GetChannels(bus)->GetChannelID(b.name);
+   if (!b.param.empty())
+   {
+      snprintf(addr, sizeof(addr), "/%d/%s", page, param);
+      b.address = addr;
+      b.paramId = MixerState::ParamId(b.address.c_str());
+   }
+
+   mBindings.push_back(b);
+   mSeen.push_back(0);
+   mHeld.push_back(-1.0f);
+
+   return (int) mBindings.size() - 1;
+}
+
+// ====================================================================
+// Each channel is read once per idle interval, or shortly after we
+// changed it, and any echo of it in between will do instead
+// ====================================================================
+void Mixer::Watch(int ctrl)
+{
+   mWatched.push_back(ctrl);
+   mRefresh.Add(mBindings[ctrl].bus, mBindings[ctrl].name);
+}
+
+// ====================================================================
+//
+// ====================================================================
+void Mixer::SetListener(Listener listener)
+{
+   mListener = listener;
+}
+
+// ====================================================================
+//
+// ====================================================================
+void Mixer::SetEchoListener(EchoListener listener)
+{
+   mEchoListener = listener;
+}
+
+// ====================================================================
+// This many requests at a time, 1 is strictly one after the other
+// ====================================================================
+void Mixer::SetRequestWindow(int window)
+{
+   mRequests.SetWindow(window);
+}
+
+// ====================================================================
+//
+// ====================================================================
+void Mixer::SetRefreshIntervals(int idleMs, int settleMs, int gapMs)
+{
+   mRefresh.SetIntervals(idleMs, settleMs, gapMs);
+}
+
+// ====================================================================
+// Fader values go out at most this many per second, the ones in
+// between are overwritten while they wait
+// ====================================================================
+void Mixer::SetSendRate(double rate, int burst)
+{
+   mOutbox.SetRate(rate, burst);
+}
+
+// ====================================================================
+// The channel names come first, the controls need them to navigate.
+// They are asked for even without a socket, and again until they come.
+// ====================================================================
+bool Mixer::Start(int localPort, const char *host, int remotePort)
+{
+   bool ok = mIo.Start(localPort, host, remotePort);
+
+   mReady = false;
+   for (int b = 0; b < BUS_COUNT; b++)
+   {
+      mNamed[b] = false;
+   }
+   SendSet("/1/busPlayback");
+   SendSet("/1/busInput");
+   SendSet("/1/busOutput");
+   SendSet("/1/busPlayback");
+
+   return ok;
+}
+
+// ====================================================================
+//
+// ====================================================================
+void Mixer::Stop()
+{
+   mIo.Stop();
+}
+
+// ====================================================================
+//
+// ====================================================================
+const std::string & Mixer::GetError()
+{
+   return mIo.GetError();
+}
+
+// ====================================================================
+//
+// ====================================================================
+void Mixer::Frame(bool holding)
+{
+   const OscUpdate *update;
+
+   mHolding = holding;
+
+   // Once per frame, take whatever the I/O thread has parsed for us
+   while ((update = mIo.Front()) != NULL)
+   {
+      if (update->route == mRoutes[ROUTE_BUS])
+      {
+         OnOSCBus(*update);
+      }
+      else if (update->route == mRoutes[ROUTE_TRACKNAMES])
+      {
+         OnOSCTrackNames(*update);
+      }
+      else if (update->route == mRoutes[ROUTE_VALUE])
+      {
+         OnOSCValue(*update);
+      }
+      else if (update->route == mRoutes[ROUTE_TRACKNAME])
+      {
+         OnOSCTrackName(*update);
+      }
+      mIo.Pop();
+   }
+
+   // A packet the I/O thread gave up on may have been a navigation
+   unsigned long unsent = mIo.GetUnsent();
+   if (unsent != mUnsent)
+   {
+      mUnsent = unsent;
+      mCursor.Invalidate();
+      mStrips.Invalidate();
+   }
+
+   mQueries.Tick();
+
+   if (!mToggles.empty())
+   {
+      SendToggles();
+   }
+
+   mOutbox.Drain([this](int bus, int channel, int param, float value)
+   {
+      return SendControl(bus, channel, param, value);
+   });
+
+   // What a full outbox refused goes in behind what just left
+   for (size_t ctrl = 0; ctrl < mHeld.size(); ctrl++)
+   {
+      if (mHeld[ctrl] >= 0.0f)
+      {
+         PostFader((int) ctrl, mHeld[ctrl]);
+      }
+   }
+
+   // The echoes have been handled above, so this only gives up on the
+   // requests that got none
+   mRequests.Tick();
+
+   // The requests for names have been answered or given up on (after
+   // their resends), ask again for the buses still without
+   if (!mReady && mRequests.IsIdle())
+   {
+      mReady = true;
+      for (int b = 0; b < BUS_COUNT; b++)
+      {
+         if (!mNamed[b])
+         {
+            SendSet(("/1/" + std::string(BusNames[b])).c_str());
+            mReady = false;
+         }
+      }
+   }
+
+   // Nothing gets read back while a control is in hand
+   if (mReady && !holding)
+   {
+      int next = mRefresh.Next();
+      if (next >= 0)
+      {
+         Refresh(next);
+      }
+   }
+}
+
+// ====================================================================
+//
+// ====================================================================
+bool Mixer::IsReady()
+{
+   return mReady;
+}
+
+// ====================================================================
+//
+// ====================================================================
+Channels *Mixer::GetChannels(int bus)
+{
+   if (bus < 0 || bus >= BUS_COUNT)
+   {
+      return NULL;
+   }
+
+   return &mChannels[bus];
+}
+
+// ====================================================================
+//
+// ====================================================================
+MixerState & Mixer::GetState()
+{
+   return mState;
+}
+
+// ====================================================================
+//
+// ====================================================================
+const Binding & Mixer::GetBinding(int ctrl)
+{
+   return mBindings[ctrl];
+}
+
+// ====================================================================
+// A bus has been selected
+// ====================================================================
+void Mixer::OnOSCBus(const OscUpdate & update)
+{
+   if (update.type != 'f' || update.value != 1.0f)
+   {
+      return;
+   }
+
+   // The answer to a selection we asked for, if it is one
+   mRequests.OnEcho(update.address);
+
+   // "/N/" and the name
+   int bus = -1;
+   for (int i = 0; i < BUS_COUNT; i++)
+   {
+      if (strcmp(update.address + 3, BusNames[i]) == 0)
+      {
+         bus = i;
+      }
+   }
+
+   if (strncmp(update.address, "/2/", 3) == 0)
+   {
+      // The page 2 cursor, not the page 1 names
+      if (bus >= 0)
+      {
+         mCursor.OnBus(bus);
+      }
+      return;
+   }
+
+   mActive = strncmp(update.address, "/1/", 3) == 0 ? bus : -1;
+   if (mActive >= 0)
+   {
+      mStrips.OnBus(mActive);
+   }
+}
+
+// ====================================================================
+// Page 1 strip names of the active bus, for the bank in view
+// ====================================================================
+void Mixer::OnOSCTrackNames(const OscUpdate & update)
+{
+   if (mActive < 0)
+   {
+      return;
+   }
+
+   // "/1/trackname" and the strip number
+   int id = mStrips.OnTrackName(mActive, atoi(update.address + 12), update.text);
+   if (id < 1)
+   {
+      return;
+   }
+
+   Channels *chans = GetChannels(mActive);
+   int generation = chans->GetGeneration();
+   chans->SetChannelName(id, update.text);
+   mNamed[mActive] = true;
+
+   // Interfaces with more channels than the state starts with
+   mState.Grow(id);
+   if (chans->GetGeneration() != generation)
+   {
+      // The positions the cursor knows may not hold any more
+      mCursor.Invalidate();
+      ResolveChannels();
+   }
+}
+
+// ====================================================================
+// Page 2 value of the current channel
+// ====================================================================
+void Mixer::OnOSCValue(const OscUpdate & update)
+{
+   mQueries.OnValue(update.param, update.value);
+}
+
+// ====================================================================
+// Page 2 channel name, sent after all of its values
+// ====================================================================
+void Mixer::OnOSCTrackName(const OscUpdate & update)
+{
+   mCursor.OnTrackName(update.text);
+   mQueries.OnTrackName(update.text);
+}
+
+// ====================================================================
+// Read back everything the watched controls of a channel show.  Queries
+// of the same channel share one exchange.
+// ====================================================================
+void Mixer::Refresh(int index)
+{
+   for (size_t i = 0; i < mWatched.size(); i++)
+   {
+      const Binding & b = mBindings[mWatched[i]];
+      if (b.bus == mRefresh.GetBus(index) && b.name == mRefresh.GetChannel(index))
+      {
+         QueryControl(mWatched[i]);
+      }
+   }
+}
+
+// ====================================================================
+// A page 2 echo burst, whoever moved the cursor there: as good as a
+// read of every control on that channel
+// ====================================================================
+void Mixer::OnEcho(const char *channel, const ParamValues & values)
+{
+   // The echo does not say which bus, the cursor's is the likely one
+   int bus = mCursor.GetBus();
+   int id = bus >= 0 ? GetChannels(bus)->GetChannelID(channel) : -1;
+   for (int b = 0; id < 1 && b < BUS_COUNT; b++)
+   {
+      bus = b;
+      id = GetChannels(bus)->GetChannelID(channel);
+   }
+
+   if (id < 1)
+   {
+      return;
+   }
+
+   mState.Apply(bus, id, values);
+
+   if (mEchoListener)
+   {
+      mEchoListener(bus, id, values);
+   }
+
+   for (size_t i = 0; i < mWatched.size(); i++)
+   {
+      const Binding & b = mBindings[mWatched[i]];
+      if (b.bus == bus && b.channel == id)
+      {
+         mRefresh.OnFresh(b.bus, b.name);
+         UpdateControl(mWatched[i]);
+      }
+   }
+}
+
+// ====================================================================
+// Read a control's parameter
+// ====================================================================
+void Mixer::QueryControl(int ctrl)
+{
+   const Binding & b = mBindings[ctrl];
+
+   // The echo has gone through OnEcho() by the time this runs
+   mQueries.Query(b.bus, b.name, b.paramId, [this, ctrl](const ParamReply & r)
+   {
+      if (r.ok)
+      {
+         UpdateControl(ctrl);
+      }
+   });
+}
+
+// ====================================================================
+// Report what the mixer has for a control if it is newer than what was
+// reported, unless the control is in hand or was changed too recently
+// for the value to include that.  Held back values are reported with
+// the next echo.
+// ====================================================================
+void Mixer::UpdateControl(int ctrl)
+{
+   const Binding & b = mBindings[ctrl];
+
+   const MixerState::Entry *e = mState.Get(b.bus, b.channel, b.paramId);
+   if (e == NULL || e->version <= mSeen[ctrl])
+   {
+      return;
+   }
+
+   if (mHolding || mRefresh.IsSettling(b.bus, b.name))
+   {
+      return;
+   }
+
+   if (mListener)
+   {
+      mListener(ctrl, e->value);
+   }
+   mSeen[ctrl] = e->version;
+}
+
+// ====================================================================
+// Channel ids of the controls, again whenever the names change
+// ====================================================================
+void Mixer::ResolveChannels()
+{
+   for (size_t i = 0; i < mBindings.size(); i++)
+   {
+      mBindings[i].channel = GetChannels(mBindings[i].bus)->GetChannelID(mBindings[i].name);
+   }
+}
+
+// ====================================================================
+// Packet for a control: the cursor moved to its channel, then msg.
+// NULL when the channel is not known (yet).
+// ====================================================================
+oscpkt::PacketWriter *Mixer::Navigate(int ctrl, const oscpkt::Message *msg, bool echo)
+{
+   Binding & b = mBindings[ctrl];
+   Channels *chans = GetChannels(b.bus);
+
+   int id = chans->GetChannelID(b.name);
+   if (id < 1)
+   {
+      return NULL;
+   }
+
+   mCursor.Navigate(mNav, b.bus, id, chans->GetCount(), msg, echo);
+
+   return &mNav;
+}
+
+// ====================================================================
+// Packet setting a control to value, by strip on page 1 or with the
+// cursor on page 2.  NULL when the channel is not known (yet).
+// ====================================================================
+oscpkt::PacketWriter *Mixer::SetControl(int ctrl, float value)
+{
+   Binding & b = mBindings[ctrl];
+
+   if (b.page != 1)
+   {
+      mMsg.init(b.address).pushFloat(value);
+      return Navigate(ctrl, &mMsg, false);
+   }
+
+   Channels *chans = GetChannels(b.bus);
+
+   int id = chans->GetChannelID(b.name);
+   if (id < 1)
+   {
+      return NULL;
+   }
+
+   mStrips.Navigate(mNav, b.bus, id, chans->GetCount(), b.address.c_str(), value);
+
+   return &mNav;
+}
+
+// ====================================================================
+// Sender for the outbox: the control with that channel and parameter.
+// False when the I/O thread's ring is full, the value is kept for the
+// next frame then.
+// ====================================================================
+bool Mixer::SendControl(int bus, int channel, int param, float value)
+{
+   for (size_t ctrl = 0; ctrl < mBindings.size(); ctrl++)
+   {
+      Binding & b = mBindings[ctrl];
+      if (b.channel != channel || b.paramId != param || b.bus != bus)
+      {
+         continue;
+      }
+
+      oscpkt::PacketWriter *pw = SetControl((int) ctrl, value);
+      if (pw == NULL)
+      {
+         // Not reachable (yet), nothing to wait for
+         return true;
+      }
+
+      if (!mIo.Send(pw->packetData(), pw->packetSize()))
+      {
+         // The navigation never left, so where the mixer is is not
+         // where we think
+         mCursor.Invalidate();
+         mStrips.Invalidate();
+         return false;
+      }
+
+      // What the mixer should have now: an echo saying otherwise is a
+      // change, even if it repeats what it said before
+      mState.Set(b.bus, b.channel, b.paramId, value);
+      return true;
+   }
+
+   return true;
+}
+
+// ====================================================================
+// Navigation for a query, to the channel of the matching selection
+// control.  Bypasses the request window: the queries pace themselves on
+// the echo.
+// ====================================================================
+bool Mixer::SendSelect(int bus, const std::string & name)
+{
+   for (size_t ctrl = 0; ctrl < mBindings.size(); ctrl++)
+   {
+      Binding & b = mBindings[ctrl];
+      if (!b.param.empty() || b.bus != bus || b.name != name)
+      {
+         continue;
+      }
+
+      oscpkt::PacketWriter *pw = Navigate((int) ctrl, NULL, true);
+      if (pw == NULL)
+      {
+         return false;
+      }
+
+      if (!mIo.Send(pw->packetData(), pw->packetSize()))
+      {
+         // As in SendControl(), the cursor never got there
+         mCursor.Invalidate();
+         mStrips.Invalidate();
+         return false;
+      }
+      return true;
+   }
+
+   return false;
+}
+
+// ====================================================================
+// Sent from Frame(), only the last value if the control moved again in
+// between
+// ====================================================================
+void Mixer::SendFader(int ctrl, float value)
+{
+   Binding & b = mBindings[ctrl];
+
+   mRefresh.OnChanged(b.bus, b.name);
+
+   // Not reachable (yet), nothing to send
+   if (b.channel < 0 || b.paramId < 0)
+   {
+      return;
+   }
+
+   PostFader(ctrl, value);
+}
+
+// ====================================================================
+// A value the outbox refuses is held, and posted again after each
+// drain until there is room, unless a newer one gets in first
+// ====================================================================
+void Mixer::PostFader(int ctrl, float value)
+{
+   Binding & b = mBindings[ctrl];
+
+   if (mOutbox.Post(b.bus, b.channel, b.paramId, value) == Outbox::POST_FULL)
+   {
+      mHeld[ctrl] = value;
+   }
+   else
+   {
+      mHeld[ctrl] = -1.0f;
+   }
+}
+
+// ====================================================================
+// Behind any press still waiting, so they reach the mixer in order
+// ====================================================================
+void Mixer::SendToggle(int ctrl)
+{
+   mRefresh.OnChanged(mBindings[ctrl].bus, mBindings[ctrl].name);
+
+   mToggles.push_back(ctrl);
+   SendToggles();
+}
+
+// ====================================================================
+// The presses waiting, oldest first.  One the I/O thread's ring refuses
+// stays, with those behind it, for the next frame.
+// ====================================================================
+void Mixer::SendToggles()
+{
+   size_t sent = 0;
+
+   for (; sent < mToggles.size(); sent++)
+   {
+      oscpkt::PacketWriter *pw = SetControl(mToggles[sent], 1.0f);
+      if (pw == NULL)
+      {
+         // Not reachable (yet), there is nothing to press
+         continue;
+      }
+
+      if (!mIo.Send(pw->packetData(), pw->packetSize()))
+      {
+         mCursor.Invalidate();
+         mStrips.Invalidate();
+         break;
+      }
+   }
+
+   mToggles.erase(mToggles.begin(), mToggles.begin() + sent);
+}
+
+// ====================================================================
+// A selection that waits for its echo, dropped when the request window
+// is full
+// ====================================================================
+void Mixer::SendSet(const char *pattern)
+{
+   mMsg.init(pattern).pushFloat(1.0f);
+   mRequests.Send(mMsg);
+}
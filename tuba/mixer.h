@@ -0,0 +1,182 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(MIXER_H)
+#define MIXER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "bank.h"
+#include "channel.h"
+#include "cursor.h"
+#include "iothread.h"
+#include "mixerstate.h"
+#include "oscpkt.h"
+#include "outbox.h"
+#include "query.h"
+#include "refresh.h"
+#include "window.h"
+
+enum
+{
+   BUS_INPUT,
+   BUS_OUTPUT,
+   BUS_PLAYBACK,
+
+   BUS_COUNT
+};
+
+// Addresses we listen to, indexes Mixer::mRoutes
+enum
+{
+   ROUTE_BUS,
+   ROUTE_TRACKNAMES,
+   ROUTE_VALUE,
+   ROUTE_TRACKNAME,
+
+   ROUTE_COUNT
+};
+
+// ====================================================================
+// A control: its channel and the parameter to set there.  On page 2 the
+// cursor is moved to the channel first, on page 1 the bank holding it
+// is brought into view and the address gets the strip number.
+// ====================================================================
+struct Binding
+{
+   int page;
+   int bus;
+   std::string name;
+   std::string param;            // empty for a plain channel selection
+   std::string address;          // of param, empty for a selection
+   int paramId;                  // PARAM_* of param, -1 for a selection
+   int channel;                  // id of name on bus, -1 while unknown
+};
+
+// ====================================================================
+// The mixer as Tuba drives it: the channel names of each bus, what we
+// know of the values, and everything it takes to get a value there or
+// read one back (bus selection, page 2 cursor, page 1 banks, the
+// request window, the outbox, the refresh schedule) over the I/O
+// thread.
+//
+// No GUI in here.  The view adds its controls, forwards their changes,
+// calls Frame() once per frame and shows what the listener reports.
+// Everything but the I/O thread runs on the caller's thread.
+// ====================================================================
+class Mixer
+{
+public:
+   // A control's value, newer than what was last reported
+   typedef std::function<void (int ctrl, float value)> Listener;
+
+   // A page 2 echo burst of a channel, once it is in the state
+   typedef std::function<void (int bus, int channel, const ParamValues & values)> EchoListener;
+
+   Mixer();
+   virtual ~Mixer();
+
+   // Controls are numbered in the order they are added.  An empty param
+   // is a plain channel selection, which the queries navigate with.
+   int AddControl(int page, int bus, const char *name, const char *param);
+
+   // Read back now and then, changes go to the listener
+   void Watch(int ctrl);
+
+   void SetListener(Listener listener);
+   void SetEchoListener(EchoListener listener);
+
+   void SetRequestWindow(int window);
+   void SetRefreshIntervals(int idleMs, int settleMs, int gapMs);
+   void SetSendRate(double rate, int burst);
+
+   // Opens the socket and asks for the channel names.  False when the
+   // socket could not be opened, GetError() says why.
+   bool Start(int localPort, const char *host, int remotePort);
+   void Stop();
+   const std::string & GetError();
+
+   // Take what the I/O thread parsed, send what is due.  While holding
+   // (the user has a control in hand) nothing is read back or reported.
+   void Frame(bool holding);
+
+   // The channel names of every bus have been read, the controls can be
+   // used.  Until then the names are asked for again whenever the
+   // requests for them have been given up on.
+   bool IsReady();
+
+   // A fader value (0 - 1), sent from Frame() at the outbox's rate
+   void SendFader(int ctrl, float value);
+
+   // Straight out, two toggles waiting are not one.  A press the I/O
+   // thread cannot take yet is sent again from Frame().
+   void SendToggle(int ctrl);
+
+   // Navigation to the channel of a selection control, false when it
+   // cannot be reached (yet)
+   bool SendSelect(int bus, const std::string & name);
+
+   Channels *GetChannels(int bus);
+   MixerState & GetState();
+   const Binding & GetBinding(int ctrl);
+
+private:
+   void OnOSCBus(const OscUpdate & update);
+   void OnOSCTrackNames(const OscUpdate & update);
+   void OnOSCValue(const OscUpdate & update);
+   void OnOSCTrackName(const OscUpdate & update);
+
+   void Refresh(int index);
+   void OnEcho(const char *channel, const ParamValues & values);
+   void QueryControl(int ctrl);
+   void UpdateControl(int ctrl);
+   void ResolveChannels();
+
+   void SendSet(const char *pattern);
+   oscpkt::PacketWriter *Navigate(int ctrl, const oscpkt::Message *msg, bool echo);
+   oscpkt::PacketWriter *SetControl(int ctrl, float value);
+   bool SendControl(int bus, int channel, int param, float value);
+   void PostFader(int ctrl, float value);
+   void SendToggles();
+
+private:
+   IoThread mIo;
+   int mRoutes[ROUTE_COUNT];
+   bool mReady;
+   bool mHolding;
+   int mActive;                       // page 1 bus, -1 when unknown
+   bool mNamed[BUS_COUNT];            // names of the bus have come in
+   unsigned long mUnsent;             // mIo.GetUnsent() when last looked at
+
+   Channels mChannels[BUS_COUNT];
+
+   std::vector<Binding> mBindings;
+   std::vector<uint32_t> mSeen;       // mState version each control reported
+   std::vector<float> mHeld;          // value the outbox refused, < 0 when none
+   std::vector<int> mToggles;         // presses not sent yet, oldest first
+   std::vector<int> mWatched;
+   Listener mListener;
+   EchoListener mEchoListener;
+
+   TrackCursor mCursor;
+   StripBank mStrips;
+   oscpkt::PacketWriter mNav;
+
+   ParamQueries mQueries;
+   MixerState mState;
+   RefreshScheduler mRefresh;
+   Outbox mOutbox;
+   RequestWindow mRequests;
+   oscpkt::Message mMsg;
+};
+
+#endif
@@ -0,0 +1,232 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#include <string.h>
+
+#include "mixerstate.h"
+
+// In PARAM_* order
+static const char *ParamNames[PARAM_COUNT] =
+{
+   "volume",
+   "pan",
+   "mute",
+   "solo",
+   "gain",
+   "eqEnable",
+   "eqGain1",
+   "eqGain2",
+   "eqGain3",
+};
+
+// ====================================================================
+//
+// ====================================================================
+MixerState::MixerState(int buses, int channels)
+{
+   mBuses = buses;
+   mChannels = channels;
+   mVersion = 0;
+
+   mEntries.resize(buses * channels * PARAM_COUNT);
+   mTouched.resize(buses * channels);
+   Clear();
+}
+
+// ====================================================================
+//
+// ====================================================================
+MixerState::~MixerState()
+{
+}
+
+// ====================================================================
+// A handful of short names, the first character rules out most of them
+// ====================================================================
+int MixerState::ParamId(const char *address)
+{
+   const char *name = strrchr(address, '/');
+   name = name ? name + 1 : address;
+
+   for (int i = 0; i < PARAM_COUNT; i++)
+   {
+      if (name[0] == ParamNames[i][0] && strcmp(name, ParamNames[i]) == 0)
+      {
+         return i;
+      }
+   }
+
+   return -1;
+}
+
+// ====================================================================
+//
+// ====================================================================
+const char *MixerState::ParamName(int param)
+{
+   return param >= 0 && param < PARAM_COUNT ? ParamNames[param] : "";
+}
+
+// ====================================================================
+// Only a change gets a new version
+// ====================================================================
+bool MixerState::Set(int bus, int channel, int param, float value)
+{
+   int i = Index(bus, channel);
+   if (i < 0 || param < 0 || param >= PARAM_COUNT)
+   {
+      return false;
+   }
+
+   Entry & e = mEntries[i * PARAM_COUNT + param];
+   if (e.version != 0 && e.value == value)
+   {
+      return false;
+   }
+
+   e.value = value;
+   e.version = ++mVersion;
+   mTouched[i] = e.version;
+
+   return true;
+}
+
+// ====================================================================
+//
+// ====================================================================
+int MixerState::Apply(int bus, int channel, const ParamValues & values)
+{
+   int changed = 0;
+
+   for (int p = 0; p < PARAM_COUNT; p++)
+   {
+      if (values.Has(p) && Set(bus, channel, p, values.value[p]))
+      {
+         changed++;
+      }
+   }
+
+   return changed;
+}
+
+// ====================================================================
+//
+// ====================================================================
+const MixerState::Entry *MixerState::Get(int bus, int channel, int param)
+{
+   int i = Index(bus, channel);
+   if (i < 0 || param < 0 || param >= PARAM_COUNT)
+   {
+      return NULL;
+   }
+
+   return &mEntries[i * PARAM_COUNT + param];
+}
+
+// ====================================================================
+// At least doubled, channels are learned one at a time.  Each bus keeps
+// its block, only further apart.
+// ====================================================================
+void MixerState::Grow(int channels)
+{
+   if (channels <= mChannels)
+   {
+      return;
+   }
+
+   int grown = channels > mChannels * 2 ? channels : mChannels * 2;
+   std::vector<Entry> entries(mBuses * grown * PARAM_COUNT);
+   std::vector<uint32_t> touched(mBuses * grown);
+
+   for (int b = 0; b < mBuses; b++)
+   {
+      for (int c = 0; c < mChannels; c++)
+      {
+         touched[b * grown + c] = mTouched[b * mChannels + c];
+         for (int p = 0; p < PARAM_COUNT; p++)
+         {
+            entries[(b * grown + c) * PARAM_COUNT + p] = mEntries[(b * mChannels + c) * PARAM_COUNT + p];
+         }
+      }
+   }
+
+   mEntries.swap(entries);
+   mTouched.swap(touched);
+   mChannels = grown;
+}
+
+// ====================================================================
+//
+// ====================================================================
+int MixerState::GetChannels()
+{
+   return mChannels;
+}
+
+// ====================================================================
+//
+// ====================================================================
+uint32_t MixerState::GetVersion()
+{
+   return mVersion;
+}
+
+// ====================================================================
+// Untouched channels are skipped without looking at their entries
+// ====================================================================
+void MixerState::ForEachChanged(uint32_t since, const Visitor & visit)
+{
+   for (int i = 0; i < (int) mTouched.size(); i++)
+   {
+      if (mTouched[i] <= since)
+      {
+         continue;
+      }
+
+      for (int p = 0; p < PARAM_COUNT; p++)
+      {
+         const Entry & e = mEntries[i * PARAM_COUNT + p];
+         if (e.version > since)
+         {
+            visit(i / mChannels, i % mChannels + 1, p, e.value);
+         }
+      }
+   }
+}
+
+// ====================================================================
+// Back to knowing nothing, versions keep counting
+// ====================================================================
+void MixerState::Clear()
+{
+   for (size_t i = 0; i < mEntries.size(); i++)
+   {
+      mEntries[i].value = 0.0f;
+      mEntries[i].version = 0;
+   }
+   for (size_t i = 0; i < mTouched.size(); i++)
+   {
+      mTouched[i] = 0;
+   }
+}
+
+// ====================================================================
+// Of the channel in mTouched (times PARAM_COUNT in mEntries), -1 when
+// out of range
+// ====================================================================
+int MixerState::Index(int bus, int channel)
+{
+   if (bus < 0 || bus >= mBuses || channel < 1 || channel > mChannels)
+   {
+      return -1;
+   }
+
+   return bus * mChannels + channel - 1;
+}
@@ -0,0 +1,115 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(MIXERSTATE_H)
+#define MIXERSTATE_H
+
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+// Page 2 parameters, in the order of ParamId()'s table
+enum
+{
+   PARAM_VOLUME,
+   PARAM_PAN,
+   PARAM_MUTE,
+   PARAM_SOLO,
+   PARAM_GAIN,
+   PARAM_EQ_ENABLE,
+   PARAM_EQ_GAIN1,
+   PARAM_EQ_GAIN2,
+   PARAM_EQ_GAIN3,
+
+   PARAM_COUNT
+};
+
+// ====================================================================
+// The values of one page 2 echo burst, collected before the trackname
+// that says whose they are
+// ====================================================================
+struct ParamValues
+{
+   float value[PARAM_COUNT];
+   uint32_t present;             // bit per PARAM_*
+
+   ParamValues() { present = 0; }
+
+   void Clear() { present = 0; }
+   void Set(int param, float v) { value[param] = v; present |= 1u << param; }
+   bool Has(int param) const { return param >= 0 && param < PARAM_COUNT && (present & (1u << param)) != 0; }
+};
+
+// ====================================================================
+// What the mixer has, as far as we know: a value per bus, channel and
+// parameter, in one flat array indexed by small integers.  Addresses
+// are turned into parameter ids once, where the messages are parsed.
+//
+// Every entry carries the version it was last changed at (0 for never),
+// from a counter bumped on every change, so a consumer only needs to
+// remember the last version it looked at to find what is new.
+//
+// No wx in here, it is used headless by the benches.
+// ====================================================================
+class MixerState
+{
+public:
+   struct Entry
+   {
+      float value;
+      uint32_t version;          // 0 when never set
+   };
+
+   typedef std::function<void (int bus, int channel, int param, float value)> Visitor;
+
+   MixerState(int buses = 3, int channels = 128);
+   virtual ~MixerState();
+
+   // Id of the parameter an address ends with ("/2/eqGain1" or just
+   // "eqGain1"), -1 when it is not one
+   static int ParamId(const char *address);
+   static const char *ParamName(int param);
+
+   // True when the value changed.  Channels are 1 based, anything out
+   // of range is ignored.
+   bool Set(int bus, int channel, int param, float value);
+
+   // Every value of a burst, returns how many changed
+   int Apply(int bus, int channel, const ParamValues & values);
+
+   // NULL when out of range.  Good until the next Grow().
+   const Entry *Get(int bus, int channel, int param);
+
+   // Room for channels up to this id on every bus, keeping what is
+   // there.  Never shrinks.
+   void Grow(int channels);
+   int GetChannels();
+
+   // The version of the latest change
+   uint32_t GetVersion();
+
+   // Visit the entries changed after version since, channel by channel
+   void ForEachChanged(uint32_t since, const Visitor & visit);
+
+   void Clear();
+
+private:
+   int Index(int bus, int channel);
+
+private:
+   int mBuses;
+   int mChannels;
+   std::vector<Entry> mEntries;       // [bus][channel][param]
+   std::vector<uint32_t> mTouched;    // [bus][channel], latest version of its entries
+   uint32_t mVersion;
+};
+
+#endif
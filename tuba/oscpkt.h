@@ -15,9 +15,8 @@
 
   does not:
     - take into account timestamp values.
-    - provide a cpu-scalable message dispatching.
     - not suitable for use inside a realtime thread as it allocates memory when 
-    building or reading messages.
+    building or reading messages (PacketViewReader excepted).
 
 
   There are basically 3 classes of interest:
@@ -25,6 +24,15 @@
     - oscpkt::PacketReader  : read the bundles/messages embedded in an OSC packet
     - oscpkt::PacketWriter  : write bundles/messages into an OSC packet
 
+  For the receive path there is also an allocation free variant:
+    - oscpkt::MessageView      : read-only view of a message inside a packet buffer
+    - oscpkt::PacketViewReader : hand out MessageViews without copying the packet
+    - oscpkt::Router           : dispatch messages to handlers, by address or pattern
+
+  And for the send path:
+    - oscpkt::PacketQueue    : recycled writers for packets waiting to be sent
+    - oscpkt::PacketTemplate : a packet built once, with values patched in place
+
   And optionaly:
     - oscpkt::UdpSocket     : read/write OSC packets over UDP.
 
@@ -71,6 +79,23 @@ namespace oscpkt {
 #include <string>
 #include <vector>
 #include <list>
+#include <functional>
+#if defined(_MSC_VER)
+#include <stdlib.h> // _byteswap_ulong
+#include <intrin.h> // _BitScanForward64
+#endif
+#if defined(__has_include)
+# if __has_include(<bit>) && (__cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L))
+#  include <bit> // std::endian
+# endif
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define OSCPKT_HAVE_SSE2 1
+#elif defined(__ARM_NEON)
+# include <arm_neon.h>
+# define OSCPKT_HAVE_NEON 1
+#endif
 
 #define OSCPKT_OSTREAM_OUTPUT 1
 
@@ -123,31 +148,119 @@ template <typename POD> union PodBytes {
   POD  value;
 };
 
-inline bool isBigEndian() { // a compile-time constant would certainly improve performances..
+/* byte order of the host, as a compile-time constant when the compiler tells us */
+#if !defined(OSCPKT_BIG_ENDIAN)
+# if defined(__cpp_lib_endian)
+#  define OSCPKT_BIG_ENDIAN (std::endian::native == std::endian::big)
+# elif defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__)
+#  define OSCPKT_BIG_ENDIAN (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+# elif defined(_MSC_VER) || defined(_WIN32)
+#  define OSCPKT_BIG_ENDIAN 0 // every windows target is little endian
+# endif
+#endif
+
+#if defined(OSCPKT_BIG_ENDIAN)
+inline bool isBigEndian() { return OSCPKT_BIG_ENDIAN; }
+#else
+inline bool isBigEndian() { // unknown compiler, find out at runtime
   PodBytes<int32_t> p; p.value = 0x12345678;
   return p.bytes[0] == 0x12;
 }
+#endif
 
-/** read unaligned bytes into a POD type, assuming the bytes are a little endian representation */
+inline uint32_t bswap32(uint32_t x) {
+#if defined(_MSC_VER)
+  return _byteswap_ulong(x);
+#elif defined(__GNUC__)
+  return __builtin_bswap32(x);
+#else
+  return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+#endif
+}
+
+inline uint64_t bswap64(uint64_t x) {
+#if defined(_MSC_VER)
+  return _byteswap_uint64(x);
+#elif defined(__GNUC__)
+  return __builtin_bswap64(x);
+#else
+  return (uint64_t(bswap32(uint32_t(x))) << 32) | bswap32(uint32_t(x >> 32));
+#endif
+}
+
+/* conversion between host and network (big endian) byte order for a POD
+   of N bytes. 4 and 8 bytes, the only sizes OSC uses, get a register sized
+   load and a single bswap; anything else is reversed byte by byte. */
+template <typename POD, size_t N = sizeof(POD)> struct PodCodec {
+  static POD read(const char *bytes) {
+    PodBytes<POD> p;
+    for (size_t i=0; i < N; ++i)
+      p.bytes[i] = isBigEndian() ? bytes[i] : bytes[N - i - 1];
+    return p.value;
+  }
+  static void write(const POD value, char *bytes) {
+    PodBytes<POD> p; p.value = value;
+    for (size_t i=0; i < N; ++i)
+      bytes[i] = isBigEndian() ? p.bytes[i] : p.bytes[N - i - 1];
+  }
+};
+template <typename POD> struct PodCodec<POD, 4> {
+  static POD read(const char *bytes) {
+    uint32_t w; memcpy(&w, bytes, 4);
+    if (!isBigEndian()) w = bswap32(w);
+    POD v; memcpy(&v, &w, 4); return v;
+  }
+  static void write(const POD value, char *bytes) {
+    uint32_t w; memcpy(&w, &value, 4);
+    if (!isBigEndian()) w = bswap32(w);
+    memcpy(bytes, &w, 4);
+  }
+};
+template <typename POD> struct PodCodec<POD, 8> {
+  static POD read(const char *bytes) {
+    uint64_t w; memcpy(&w, bytes, 8);
+    if (!isBigEndian()) w = bswap64(w);
+    POD v; memcpy(&v, &w, 8); return v;
+  }
+  static void write(const POD value, char *bytes) {
+    uint64_t w; memcpy(&w, &value, 8);
+    if (!isBigEndian()) w = bswap64(w);
+    memcpy(bytes, &w, 8);
+  }
+};
+
+/** read unaligned bytes into a POD type, assuming the bytes are a big endian (network order) representation */
 template <typename POD> POD bytes2pod(const char *bytes) {
-  PodBytes<POD> p; 
-  for (size_t i=0; i < sizeof(POD); ++i) {
-    if (isBigEndian()) 
-      p.bytes[i] = bytes[i];
-    else
-      p.bytes[i] = bytes[sizeof(POD) - i - 1];
-  }
-  return p.value;
+  return PodCodec<POD>::read(bytes);
 }
 
-/** stored a POD type into an unaligned bytes array, using little endian representation */
+/** stored a POD type into an unaligned bytes array, using big endian (network order) representation */
 template <typename POD> void pod2bytes(const POD value, char *bytes) {
-  PodBytes<POD> p; p.value = value; 
-  for (size_t i=0; i < sizeof(POD); ++i) {
-    if (isBigEndian()) 
-      bytes[i] = p.bytes[i];
-    else
-      bytes[i] = p.bytes[sizeof(POD) - i - 1];
+  PodCodec<POD>::write(value, bytes);
+}
+
+/** convert a run of n 32-bit words (floats or int32s) between host and
+    network order. src and dst may be unaligned, and may be the same
+    buffer. Uses SSE2 / NEON when available, four words at a time. */
+inline void swapWords32(const char *src, char *dst, size_t n) {
+  if (isBigEndian()) { memmove(dst, src, n*4); return; }
+  size_t i = 0;
+#if defined(OSCPKT_HAVE_SSE2)
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + i*4));
+    v = _mm_shufflelo_epi16(_mm_shufflehi_epi16(v, 0xB1), 0xB1); // swap the 16-bit halves
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)); // then the bytes in each half
+    _mm_storeu_si128((__m128i*)(dst + i*4), v);
+  }
+#elif defined(OSCPKT_HAVE_NEON)
+  for (; i + 4 <= n; i += 4) {
+    vst1q_u8((uint8_t*)(dst + i*4), vrev32q_u8(vld1q_u8((const uint8_t*)(src + i*4))));
+  }
+#endif
+  for (size_t b = i*4; b < n*4; b += 4) { // stepping in bytes, gcc sees i*4 could wrap and warns
+    uint32_t w; memcpy(&w, src + b, 4);
+    w = bswap32(w);
+    memcpy(dst + b, &w, 4);
   }
 }
 
@@ -169,14 +282,317 @@ struct Storage {
   const char *end() const { return begin() + size(); }
   size_t size() const { return data.size(); }
   void assign(const char *beg, const char *end) { data.assign(beg, end); }
-  void clear() { data.resize(0); }
+  void clear() { data.resize(0); } // keeps the capacity, so a recycled Storage does not allocate
+  void reserve(size_t sz) { data.reserve(sz); }
 };
 
 /** check if the path matches the supplied path pattern , according to the OSC spec pattern 
     rules ('*' and '//' wildcards, '{}' alternatives, brackets etc) */
 bool fullPatternMatch(const std::string &pattern, const std::string &path);
+bool fullPatternMatch(const char *pattern, const char *path);
 /** check if the path matches the beginning of pattern */
 bool partialPatternMatch(const std::string &pattern, const std::string &path);
+bool partialPatternMatch(const char *pattern, const char *path);
+
+/**
+   an OSC address pattern that has been parsed once into an automaton,
+   for patterns that are matched over and over (handler tables, routers..).
+
+   The literal text the pattern starts with is compared in one go, as is
+   (for full matches) the literal text it ends with, so a literal pattern
+   is a memcmp. What is left in between is first walked the way
+   fullPatternMatch() does, but over the parsed pattern and for a bounded
+   number of steps; a path that needs more (backtracking on '*' or '//')
+   is matched by simulating all the positions the pattern can be in at
+   once, visiting only the live ones, so it runs in
+   O(len(path) * live positions) at worst whatever the pattern. Results are the same as fullPatternMatch()
+   and partialPatternMatch(), quirks included: a '{}' list picks the first
+   alternative that is a prefix of the path, '?' and '[]' also match '/',
+   and a partial match succeeds as soon as a '[]' or '{}' fails to match.
+
+   @code
+   static const CompiledPattern pat("/2/{volume,pan,mute}");
+   if (msg.match(pat).popFloat(f).isOkNoMoreArgs()) ...
+   @endcode
+*/
+class CompiledPattern {
+public:
+  CompiledPattern() { compile(""); }
+  explicit CompiledPattern(const char *pattern) { compile(pattern); }
+  explicit CompiledPattern(const std::string &pattern) { compile(pattern.c_str()); }
+
+  const std::string &pattern() const { return source; }
+
+  /** same as fullPatternMatch(pattern(), path) */
+  bool fullMatch(const char *path) const { return run(path, path + strlen(path), true); }
+  bool fullMatch(const std::string &path) const { return fullMatch(path.c_str()); }
+  /** match the 'len' first chars of path, which does not have to be NUL terminated */
+  bool fullMatch(const char *path, size_t len) const { return run(path, path + len, true); }
+  /** same as partialPatternMatch(pattern(), path) */
+  bool partialMatch(const char *path) const { return run(path, path + strlen(path), false); }
+  bool partialMatch(const std::string &path) const { return partialMatch(path.c_str()); }
+
+  void compile(const char *pattern) {
+    source = pattern; ops.clear(); alts.clear(); state_op.clear(); nstates = 0;
+    const char *p = pattern;
+    while (*p) {
+      Op op = Op(); op.type = OP_CHAR; op.c = *p; op.alt_beg = op.alt_end = alts.size();
+      if (*p == '?') { op.type = OP_ANY; ++p; }
+      else if (*p == '[') {
+        op.type = OP_SET;
+        if (!compileSet(p, op.set)) { op.type = OP_STALL; add(op); break; } // no closing ']'
+      } else if (*p == '*') {
+        op.type = OP_STAR;
+        while (*p == '*') ++p;
+      } else if (*p == '/' && p[1] == '/') {
+        op.type = OP_SUPER; op.extra = 1; // one more state: skipping to the next '/'
+        while (p[1] == '/') ++p;          // the last '/' is matched literally
+      } else if (*p == '{') {
+        const char *end = strchr(p, '}'), *q;
+        if (!end) { op.type = OP_FAIL; add(op); break; } // syntax error in brace list..
+        op.type = OP_BRACE;
+        do {
+          ++p;
+          q = strchr(p, ',');
+          if (q == 0 || q > end) q = end;
+          alts.push_back(std::string(p, q));
+          if (q - p > 1 && size_t(q - p - 1) > op.extra) op.extra = q - p - 1;
+          p = q;
+        } while (q != end);
+        op.alt_end = alts.size();
+        p = end+1;
+      } else ++p;
+      add(op);
+    }
+    Op op = Op(); op.type = OP_END; op.alt_beg = op.alt_end = alts.size();
+    add(op);
+
+    // the literal ops at both ends, the tail only when nothing before it
+    // can step onto it without consuming a char of it ('{}' with an empty
+    // alternative commits depending on what follows)
+    bool empty_alt = false;
+    for (size_t a = 0; a < alts.size(); ++a) empty_alt = empty_alt || alts[a].empty();
+    head.clear(); tail.clear();
+    for (first = 0; ops[first].type == OP_CHAR; ++first) head += ops[first].c;
+    tail_op = ops.size() - 1;
+    while (!empty_alt && tail_op > first && ops[tail_op-1].type == OP_CHAR) tail.insert(tail.begin(), ops[--tail_op].c);
+
+    // what becomes of a thread sitting on each op once the whole path is consumed
+    for (size_t k = ops.size(); k-- > 0; ) {
+      Op &o = ops[k];
+      bool empty_alt = false;
+      for (size_t a = o.alt_beg; a < o.alt_end && !empty_alt; ++a) empty_alt = alts[a].empty();
+      switch (o.type) {
+        case OP_END: o.end_full = true; o.end_partial = true; break;
+        case OP_STAR: o.end_full = ops[k+1].end_full; o.end_partial = ops[k+1].end_partial; break;
+        case OP_BRACE: o.end_full = empty_alt && ops[k+1].end_full; o.end_partial = !empty_alt || ops[k+1].end_partial; break;
+        case OP_FAIL: o.end_full = false; o.end_partial = false; break;
+        default: o.end_full = false; o.end_partial = true; break;
+      }
+      // and once the path up to the tail is
+      o.to_tail = k == tail_op || ((o.type == OP_STAR || o.type == OP_SUPER) && k < tail_op && ops[k+1].to_tail);
+    }
+  }
+
+private:
+  enum { OP_CHAR, OP_ANY, OP_SET, OP_STAR, OP_SUPER, OP_BRACE, OP_STALL, OP_FAIL, OP_END };
+  struct Op {
+    int type;
+    char c;                   // OP_CHAR
+    uint32_t set[8];          // OP_SET, indexed by unsigned char
+    size_t alt_beg, alt_end;  // OP_BRACE, range in alts
+    size_t state;             // index of the main state, followed by 'extra' states:
+    size_t extra;             //   OP_SUPER: skipping, OP_BRACE: chars left in the alternative, minus one
+    bool end_full, end_partial;
+    bool to_tail;             // reaches ops[tail_op] without consuming anything
+  };
+  std::string source;
+  std::vector<Op> ops;
+  std::vector<std::string> alts;
+  std::vector<uint32_t> state_op;  // op of each state
+  size_t nstates;
+  std::string head, tail;          // literal text at both ends
+  size_t first, tail_op;           // first op after head, first op of tail
+
+  void add(Op &op) {
+    op.state = nstates; nstates += 1 + op.extra;
+    state_op.insert(state_op.end(), 1 + op.extra, uint32_t(ops.size()));
+    ops.push_back(op);
+  }
+
+  /* evaluate the bracket the same way internalPatternMatch does, for every char */
+  static bool compileSet(const char *&pattern, uint32_t *set) {
+    const char *end = 0;
+    for (int i = 0; i < 256; ++i) {
+      char path = (char)i;
+      const char *p = pattern + 1;
+      bool reverse = false;
+      if (*p == '!') { reverse = true; ++p; }
+      bool match = reverse;
+      for (; *p && *p != ']'; ++p) {
+        char c0 = *p, c1 = c0;
+        if (p[1] == '-' && p[2]) { p += 2; c1 = *p; }
+        if (path >= c0 && path <= c1) { match = !reverse; }
+      }
+      if (i == 0) set[0] = set[1] = set[2] = set[3] = set[4] = set[5] = set[6] = set[7] = 0;
+      if (match) set[i >> 5] |= 1u << (i & 31);
+      end = p;
+    }
+    if (*end != ']') return false;
+    pattern = end + 1;
+    return true;
+  }
+
+  static void setBit(uint64_t *s, size_t i) { s[i >> 6] |= uint64_t(1) << (i & 63); }
+  static bool hasBit(const uint64_t *s, size_t i) { return (s[i >> 6] >> (i & 63)) & 1; }
+  static size_t lowestBit(uint64_t x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long i; _BitScanForward64(&i, x); return i;
+#elif defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    size_t i = 0; while (!(x & 1)) { x >>= 1; ++i; } return i;
+#endif
+  }
+
+  /* the alternative a thread entering op at 'path' commits to, -1 if none */
+  long chooseAlt(const Op &op, const char *path, const char *end) const {
+    for (size_t a = op.alt_beg; a < op.alt_end; ++a) {
+      if (alts[a].size() <= size_t(end - path) && memcmp(alts[a].data(), path, alts[a].size()) == 0) return long(a);
+    }
+    return -1;
+  }
+
+  /* internalPatternMatch over the ops: 1 on a match, 0 if none, -1 once
+     'budget' steps have been taken without knowing. The tail, when
+     'stop' is before 'end', is known to be there and matches only at 'stop' */
+  int walk(size_t k, const char *path, const char *stop, const char *end, bool full, long &budget) const {
+    for (;;) {
+      if (k == tail_op && stop != end) return path == stop;
+      if (--budget < 0) return -1;
+      const Op &op = ops[k];
+      if (path == end) return (full ? op.end_full : op.end_partial) ? 1 : 0;
+      switch (op.type) {
+        case OP_CHAR: if (*path != op.c) return 0; break;
+        case OP_ANY: break;
+        case OP_SET:
+          if (!((op.set[(unsigned char)*path >> 5] >> ((unsigned char)*path & 31)) & 1)) return full ? 0 : 1;
+          break;
+        case OP_STAR:
+        case OP_SUPER:
+          if (op.type == OP_STAR && ops[k+1].type == OP_END) return memchr(path, '/', end - path) == 0;
+          for (;;) {
+            int r = walk(k+1, path, stop, end, full, budget);
+            if (r != 0) return r;
+            if (path == end) return 0;
+            if (op.type == OP_STAR) {
+              if (*path == '/') return 0;
+              ++path;
+            } else if ((path = (const char *)memchr(path+1, '/', end - path - 1)) == 0) return 0;
+          }
+        case OP_BRACE: {
+          long a = chooseAlt(op, path, end);
+          if (a < 0) return full ? 0 : 1;
+          path += alts[a].size(); ++k;
+        } continue;
+        case OP_STALL: return full ? 0 : 1;
+        default: return 0; // OP_FAIL, OP_END with path left
+      }
+      ++path; ++k;
+    }
+  }
+
+  bool run(const char *path, const char *end, bool full) const {
+    size_t n = end - path;
+    if (memcmp(path, head.data(), n < head.size() ? n : head.size()) != 0) return false;
+    if (n < head.size()) return !full;                     // ran out in the head
+    if (first == ops.size() - 1) return n == head.size();  // nothing but literal text
+
+    const char *stop = end;
+    if (full && !tail.empty()) {
+      if (n - head.size() < tail.size() || memcmp(end - tail.size(), tail.data(), tail.size()) != 0) return false;
+      stop = end - tail.size();
+    }
+
+    // cheap for the patterns met in practice, handed over when it is not
+    long budget = 16 + 4 * long(n);
+    int r = walk(first, path + head.size(), stop, end, full, budget);
+    if (r >= 0) return r != 0;
+
+    size_t words = (nstates + 63) / 64;
+    uint64_t local[16];
+    std::vector<uint64_t> heap;
+    uint64_t *cur = local, *nxt = local + 8;
+    if (words > 8) { heap.resize(2*words); cur = &heap[0]; nxt = cur + words; }
+    memset(cur, 0, words*8);
+    setBit(cur, ops[first].state);
+
+    for (path += head.size(); path != stop; ++path) {
+      const char c = *path;
+      bool stalled = false;
+      uint64_t alive = 0;
+      memset(nxt, 0, words*8);
+      /* the live states in order, picking up the ones the epsilon moves
+         set on the way: they only ever go from op k to op k+1 */
+      for (size_t w = 0; w < words; ++w) {
+        uint64_t done = 0, bits;
+        while ((bits = cur[w] & ~done) != 0) {
+          size_t b = lowestBit(bits);
+          done |= uint64_t(1) << b;
+          size_t s = w*64 + b, k = state_op[s];
+          const Op &op = ops[k];
+          if (s != op.state) {
+            if (op.type == OP_SUPER) { // skipping: stays so, and lands on a '/'
+              setBit(nxt, s);
+              if (c == '/') setBit(cur, ops[k+1].state);
+            } else {                   // OP_BRACE, in the middle of an alternative
+              setBit(nxt, s == op.state + 1 ? ops[k+1].state : s-1);
+            }
+            continue;
+          }
+          switch (op.type) {
+            case OP_CHAR: if (c == op.c) setBit(nxt, ops[k+1].state); break;
+            case OP_ANY: setBit(nxt, ops[k+1].state); break;
+            case OP_SET:
+              if ((op.set[(unsigned char)c >> 5] >> ((unsigned char)c & 31)) & 1) setBit(nxt, ops[k+1].state);
+              else stalled = true;
+              break;
+            case OP_STAR:
+              setBit(cur, ops[k+1].state);
+              if (c != '/') setBit(nxt, s);
+              break;
+            case OP_SUPER:
+              setBit(cur, ops[k+1].state);
+              setBit(nxt, s+1);
+              break;
+            case OP_BRACE: {
+              long a = chooseAlt(op, path, end);
+              if (a < 0) stalled = true;
+              else if (alts[a].empty()) setBit(cur, ops[k+1].state);
+              else if (alts[a].size() == 1) setBit(nxt, ops[k+1].state);
+              else setBit(nxt, s + alts[a].size() - 1);
+            } break;
+            case OP_STALL: stalled = true; break;
+            default: break; // OP_FAIL, OP_END: the thread dies
+          }
+        }
+      }
+      if (stalled && !full) return true;
+      for (size_t w = 0; w < words; ++w) alive |= nxt[w];
+      if (!alive) return false;
+      std::swap(cur, nxt);
+    }
+
+    for (size_t k = first; k < ops.size(); ++k) {
+      const Op &op = ops[k];
+      // a '//' still skipping lands on the tail when it starts with '/'
+      if (stop != end && op.type == OP_SUPER && hasBit(cur, op.state+1) && tail[0] == '/' && ops[k+1].to_tail) return true;
+      if (!hasBit(cur, op.state)) continue;
+      if (stop != end ? op.to_tail : full ? op.end_full : op.end_partial) return true;
+    }
+    return false;
+  }
+};
 
 #if defined(OSCPKT_DEBUG)
 #define OSCPKT_SET_ERR(errcode) do { if (!err) { err = errcode; std::cerr << "set " #errcode << " at line " << __LINE__ << "\n"; } } while (0)
@@ -192,6 +608,8 @@ typedef enum { OK_NO_ERROR=0,
                // errors raised by PacketReader/PacketWriter
                INVALID_BUNDLE, INVALID_PACKET_SIZE, BUNDLE_REQUIRED_FOR_MULTI_MESSAGES } ErrorCode;
 
+class PacketTemplate;
+
 /**
    struct used to hold an OSC message that will be written or read.
 
@@ -224,6 +642,7 @@ class Message {
   std::vector<std::pair<size_t, size_t> > arguments; // array of pairs (pos,size), pos being an index into the 'storage' array.
   Storage storage; // the arguments data is stored here
   ErrorCode err;
+  friend class PacketTemplate; // records where the arguments land in the packet
 public:  
   /** ArgReader is used for popping arguments from a Message, holds a
       pointer to the original Message, and maintains a local error code */
@@ -260,6 +679,10 @@ public:
     ArgReader &popFloat(float &f) { return popPod<float>(TYPE_TAG_FLOAT, f); }
     /** retrieve a double precision floating point argument */
     ArgReader &popDouble(double &d) { return popPod<double>(TYPE_TAG_DOUBLE, d); }
+    /** retrieve n consecutive float arguments in one go */
+    ArgReader &popFloats(float *f, size_t n) { return popWords<float>(TYPE_TAG_FLOAT, f, n); }
+    /** retrieve n consecutive int32 arguments in one go */
+    ArgReader &popInt32s(int32_t *i, size_t n) { return popWords<int32_t>(TYPE_TAG_INT32, i, n); }
     /** retrieve a string argument (no check performed on its content, so it may contain any byte value except 0) */
     ArgReader &popStr(std::string &s) {
       if (precheck(TYPE_TAG_STRING)) {
@@ -312,6 +735,17 @@ public:
       } else v = POD(0);
       return *this;
     }
+    /* 32-bit arguments are stored back to back, so a run of them is converted at once */
+    template <typename POD> ArgReader &popWords(int tag, POD *v, size_t n) {
+      if (arg_idx + n > msg->arguments.size()) OSCPKT_SET_ERR(NOT_ENOUGH_ARG);
+      for (size_t k = 0; !err && k < n; ++k) {
+        if (msg->type_tags[arg_idx+k] != tag) OSCPKT_SET_ERR(TYPE_MISMATCH);
+      }
+      if (err) { for (size_t k = 0; k < n; ++k) v[k] = POD(0); return *this; }
+      if (n) swapWords32(argBeg(arg_idx), (char*)v, n);
+      arg_idx += n;
+      return *this;
+    }
     /* pre-check stuff before popping an argument from the message */
     bool precheck(int tag) { 
       if (arg_idx >= msg->arguments.size()) OSCPKT_SET_ERR(NOT_ENOUGH_ARG); 
@@ -355,6 +789,10 @@ public:
   ArgReader match(const std::string &test) const {
     return ArgReader(*this, fullPatternMatch(test.c_str(), address.c_str()) ? OK_NO_ERROR : PATTERN_MISMATCH);
   }
+  /** same as match(), with a pattern that was compiled beforehand */
+  ArgReader match(const CompiledPattern &test) const {
+    return ArgReader(*this, test.fullMatch(address) ? OK_NO_ERROR : PATTERN_MISMATCH);
+  }
   /** return true if the 'test' path matched by the first characters of addressPattern().
       For ex. ("/foo/bar").partialMatch("/foo/") is true */
   ArgReader partialMatch(const std::string &test) const {
@@ -401,6 +839,10 @@ public:
   Message &pushInt64(int64_t h) { return pushPod(TYPE_TAG_INT64, h); }
   Message &pushFloat(float f) { return pushPod(TYPE_TAG_FLOAT, f); }
   Message &pushDouble(double d) { return pushPod(TYPE_TAG_DOUBLE, d); }
+  /** push n float arguments in one go */
+  Message &pushFloats(const float *f, size_t n) { return pushWords(TYPE_TAG_FLOAT, f, n); }
+  /** push n int32 arguments in one go */
+  Message &pushInt32s(const int32_t *i, size_t n) { return pushWords(TYPE_TAG_INT32, i, n); }
   Message &pushStr(const std::string &s) {
     assert(s.size() < 2147483647); // insane values are not welcome
     type_tags += TYPE_TAG_STRING;
@@ -431,7 +873,8 @@ public:
     if (write_size) 
       pod2bytes<uint32_t>(uint32_t(ceil4(l_addr) + ceil4(l_type) + ceil4(storage.size())), s.getBytes(4));
     strcpy(s.getBytes(l_addr), address.c_str());
-    strcpy(s.getBytes(l_type), ("," + type_tags).c_str());
+    char *t = s.getBytes(l_type); // zero filled, so the final NUL is already there
+    t[0] = ','; memcpy(t+1, type_tags.data(), type_tags.size());
     if (storage.size())
       memcpy(s.getBytes(storage.size()), const_cast<Storage&>(storage).begin(), storage.size());
   }
@@ -457,7 +900,7 @@ private:
       } break;
       case TYPE_TAG_BLOB: {
         if (p == storage.end()) { OSCPKT_SET_ERR(MALFORMED_ARGUMENTS); return 0; }
-        sz = 4+bytes2pod<uint32_t>(p);
+        sz = 4+size_t(bytes2pod<uint32_t>(p)); // no wrapping to a small size
       } break;
       default: {
         OSCPKT_SET_ERR(UNHANDLED_TYPE_TAGS); return 0;
@@ -478,6 +921,16 @@ private:
     return *this;
   }
 
+  template <typename POD> Message &pushWords(int tag, const POD *v, size_t n) {
+    type_tags.append(n, (char)tag);
+    size_t pos = storage.size();
+    size_t first = arguments.size();
+    arguments.resize(first + n); // one size check, rather than one per push_back
+    for (size_t k = 0; k < n; ++k) arguments[first + k] = std::make_pair(pos + 4*k, size_t(4));
+    if (n) swapWords32((const char*)v, storage.getBytes(4*n), n);
+    return *this;
+  }
+
 #ifdef OSCPKT_OSTREAM_OUTPUT
   friend std::ostream &operator<<(std::ostream &os, const Message &msg) {
     os << "osc_address: '" << msg.address << "', types: '" << msg.type_tags << "', timetag=" << msg.time_tag << ", args=[";
@@ -502,6 +955,254 @@ private:
 #endif
 };
 
+/**
+   read-only view of an OSC message that lives inside someone else's
+   buffer (typically the datagram that was just received). Nothing is
+   copied and nothing is allocated: the address, the type tags and the
+   arguments are read straight from the packet bytes, so the view is
+   only valid as long as that buffer is.
+
+   The reading API is the same as the one of Message: match(),
+   partialMatch(), arg() and an ArgReader with the same popXXX()
+   functions, plus popStr/popBlob variants that return pointers into
+   the packet instead of copies.
+
+   Malformed data is rejected with exactly the same error codes as
+   Message::buildFromRawData().
+*/
+class MessageView {
+  TimeTag time_tag;
+  const char *beg, *end;   // the raw message
+  const char *address;     // NUL terminated, inside [beg,end)
+  const char *type_tags;   // NUL terminated, initial ',' stripped
+  const char *args;        // first argument
+  size_t nb_args;
+  ErrorCode err;
+public:
+  /** ArgReader is used for popping arguments from a MessageView. The
+      arguments are walked in order, so popping is O(1) per argument. */
+  class ArgReader {
+    const MessageView *msg;
+    ErrorCode err;
+    size_t arg_idx; // arg index of the next arg that will be popped out.
+    const char *pos; // and its data
+  public:
+    ArgReader(const MessageView &m, ErrorCode e = OK_NO_ERROR) : msg(&m), err(msg->getErr()), arg_idx(0), pos(msg->args) {
+      if (e != OK_NO_ERROR && err == OK_NO_ERROR) err=e;
+    }
+    bool isBool() { return currentTypeTag() == TYPE_TAG_TRUE || currentTypeTag() == TYPE_TAG_FALSE; }
+    bool isInt32() { return currentTypeTag() == TYPE_TAG_INT32; }
+    bool isInt64() { return currentTypeTag() == TYPE_TAG_INT64; }
+    bool isFloat() { return currentTypeTag() == TYPE_TAG_FLOAT; }
+    bool isDouble() { return currentTypeTag() == TYPE_TAG_DOUBLE; }
+    bool isStr() { return currentTypeTag() == TYPE_TAG_STRING; }
+    bool isBlob() { return currentTypeTag() == TYPE_TAG_BLOB; }
+
+    size_t nbArgRemaining() const { return msg->nb_args - arg_idx; }
+    bool isOk() const { return err == OK_NO_ERROR; }
+    operator bool() const { return isOk(); }
+    bool isOkNoMoreArgs() const { return err == OK_NO_ERROR && nbArgRemaining() == 0; }
+    ErrorCode getErr() const { return err; }
+
+    ArgReader &popInt32(int32_t &i) { return popPod<int32_t>(TYPE_TAG_INT32, i); }
+    ArgReader &popInt64(int64_t &i) { return popPod<int64_t>(TYPE_TAG_INT64, i); }
+    ArgReader &popFloat(float &f) { return popPod<float>(TYPE_TAG_FLOAT, f); }
+    ArgReader &popDouble(double &d) { return popPod<double>(TYPE_TAG_DOUBLE, d); }
+    ArgReader &popFloats(float *f, size_t n) { return popWords<float>(TYPE_TAG_FLOAT, f, n); }
+    ArgReader &popInt32s(int32_t *i, size_t n) { return popWords<int32_t>(TYPE_TAG_INT32, i, n); }
+    /** retrieve a string argument, pointing into the packet */
+    ArgReader &popStr(const char *&s) {
+      s = 0;
+      if (precheck(TYPE_TAG_STRING)) { s = pos; next(); }
+      return *this;
+    }
+    /** retrieve a copy of a string argument */
+    ArgReader &popStr(std::string &s) {
+      if (precheck(TYPE_TAG_STRING)) { s = pos; next(); }
+      return *this;
+    }
+    /** retrieve a binary blob, pointing into the packet */
+    ArgReader &popBlob(const void *&ptr, size_t &num_bytes) {
+      ptr = 0; num_bytes = 0;
+      if (precheck(TYPE_TAG_BLOB)) { ptr = pos+4; num_bytes = bytes2pod<uint32_t>(pos); next(); }
+      return *this;
+    }
+    /** retrieve a copy of a binary blob */
+    ArgReader &popBlob(std::vector<char> &b) {
+      if (precheck(TYPE_TAG_BLOB)) { b.assign(pos+4, pos+4+bytes2pod<uint32_t>(pos)); next(); }
+      return *this;
+    }
+    ArgReader &popBool(bool &b) {
+      b = false;
+      if (arg_idx >= msg->nb_args) OSCPKT_SET_ERR(NOT_ENOUGH_ARG);
+      else if (currentTypeTag() == TYPE_TAG_TRUE) b = true;
+      else if (currentTypeTag() == TYPE_TAG_FALSE) b = false;
+      else OSCPKT_SET_ERR(TYPE_MISMATCH);
+      if (err) ++arg_idx; else next();
+      return *this;
+    }
+    /** skip whatever comes next */
+    ArgReader &pop() {
+      if (arg_idx >= msg->nb_args) OSCPKT_SET_ERR(NOT_ENOUGH_ARG);
+      else if (err) ++arg_idx;
+      else next();
+      return *this;
+    }
+  private:
+    /* step over the current argument, its size was validated when the view was built */
+    void next() {
+      pos += ceil4(argSize(msg->type_tags[arg_idx], pos));
+      ++arg_idx;
+    }
+    int currentTypeTag() {
+      if (!err && arg_idx < msg->nb_args) return msg->type_tags[arg_idx];
+      else OSCPKT_SET_ERR(NOT_ENOUGH_ARG);
+      return -1;
+    }
+    template <typename POD> ArgReader &popPod(int tag, POD &v) {
+      if (precheck(tag)) {
+        v = bytes2pod<POD>(pos);
+        next();
+      } else v = POD(0);
+      return *this;
+    }
+    template <typename POD> ArgReader &popWords(int tag, POD *v, size_t n) {
+      if (arg_idx + n > msg->nb_args) OSCPKT_SET_ERR(NOT_ENOUGH_ARG);
+      for (size_t k = 0; !err && k < n; ++k) {
+        if (msg->type_tags[arg_idx+k] != tag) OSCPKT_SET_ERR(TYPE_MISMATCH);
+      }
+      if (err) { for (size_t k = 0; k < n; ++k) v[k] = POD(0); return *this; }
+      if (n) swapWords32(pos, (char*)v, n);
+      pos += 4*n; arg_idx += n;
+      return *this;
+    }
+    bool precheck(int tag) {
+      if (arg_idx >= msg->nb_args) OSCPKT_SET_ERR(NOT_ENOUGH_ARG);
+      else if (!err && currentTypeTag() != tag) OSCPKT_SET_ERR(TYPE_MISMATCH);
+      return err == OK_NO_ERROR;
+    }
+  };
+
+  MessageView() { clear(); }
+  MessageView(const void *ptr, size_t sz, TimeTag tt = TimeTag::immediate()) { init(ptr, sz, tt); }
+
+  bool isOk() const { return err == OK_NO_ERROR; }
+  ErrorCode getErr() const { return err; }
+
+  /** the type tags, with the initial ',' stripped */
+  const char *typeTags() const { return type_tags; }
+  const char *addressPattern() const { return address; }
+  TimeTag timeTag() const { return time_tag; }
+  /** the raw message bytes, e.g. for building a Message that outlives the packet */
+  const char *data() const { return beg; }
+  size_t size() const { return end - beg; }
+
+  ArgReader match(const char *test) const {
+    return ArgReader(*this, isOk() && fullPatternMatch(test, address) ? OK_NO_ERROR : PATTERN_MISMATCH);
+  }
+  ArgReader match(const std::string &test) const { return match(test.c_str()); }
+  ArgReader match(const CompiledPattern &test) const {
+    return ArgReader(*this, isOk() && test.fullMatch(address) ? OK_NO_ERROR : PATTERN_MISMATCH);
+  }
+  ArgReader partialMatch(const char *test) const {
+    return ArgReader(*this, isOk() && partialPatternMatch(address, test) ? OK_NO_ERROR : PATTERN_MISMATCH);
+  }
+  ArgReader partialMatch(const std::string &test) const { return partialMatch(test.c_str()); }
+  ArgReader arg() const { return ArgReader(*this, OK_NO_ERROR); }
+
+  /** point the view at the raw message data, with the same checks as Message::buildFromRawData */
+  void init(const void *ptr, size_t sz, TimeTag tt = TimeTag::immediate()) {
+    clear();
+    time_tag = tt;
+    beg = (const char*)ptr; end = beg + sz;
+    const char *address_end = (const char*)memchr(beg, 0, end-beg);
+    if (!address_end || !isZeroPaddingCorrect(address_end+1) || beg[0] != '/') {
+      OSCPKT_SET_ERR(MALFORMED_ADDRESS_PATTERN); return;
+    }
+
+    const char *type_tags_beg = align(address_end+1);
+    const char *type_tags_end = (const char*)memchr(type_tags_beg, 0, end-type_tags_beg);
+    if (!type_tags_end || !isZeroPaddingCorrect(type_tags_end+1) || type_tags_beg[0] != ',') {
+      OSCPKT_SET_ERR(MALFORMED_TYPE_TAGS); return;
+    }
+
+    const char *arg = align(type_tags_end+1); assert(arg <= end);
+    size_t ntags = type_tags_end - (type_tags_beg+1), iarg = 0;
+    while (isOk() && iarg < ntags) {
+      size_t len = checkArgSize(type_tags_beg[1+iarg], arg);
+      arg += ceil4(len); ++iarg;
+    }
+    if (iarg < ntags || arg != end) {
+      OSCPKT_SET_ERR(MALFORMED_ARGUMENTS);
+    }
+    if (isOk()) {
+      address = beg; type_tags = type_tags_beg+1;
+      args = align(type_tags_end+1); nb_args = ntags;
+    }
+  }
+
+  void clear() {
+    time_tag = TimeTag::immediate();
+    beg = end = args = 0; address = type_tags = "";
+    nb_args = 0; err = OK_NO_ERROR;
+  }
+
+private:
+  /* the packet buffer does not have to be 4-byte aligned, so padding is
+     computed relative to the beginning of the message */
+  const char *align(const char *p) const { return beg + ceil4(size_t(p - beg)); }
+  bool isZeroPaddingCorrect(const char *p) const {
+    for (const char *q = align(p); p < q; ++p)
+      if (*p != 0) { return false; }
+    return true;
+  }
+
+  /* size of an argument that is already known to be well formed */
+  static size_t argSize(int type, const char *p) {
+    switch (type) {
+      case TYPE_TAG_INT32:
+      case TYPE_TAG_FLOAT: return 4;
+      case TYPE_TAG_INT64:
+      case TYPE_TAG_DOUBLE: return 8;
+      case TYPE_TAG_STRING: return strlen(p)+1;
+      case TYPE_TAG_BLOB: return 4+size_t(bytes2pod<uint32_t>(p));
+      default: return 0;
+    }
+  }
+
+  /* same as Message::getArgSize */
+  size_t checkArgSize(int type, const char *p) {
+    if (err) return 0;
+    size_t sz = 0;
+    assert(p >= beg && p <= end);
+    switch (type) {
+      case TYPE_TAG_TRUE:
+      case TYPE_TAG_FALSE: sz = 0; break;
+      case TYPE_TAG_INT32:
+      case TYPE_TAG_FLOAT: sz = 4; break;
+      case TYPE_TAG_INT64:
+      case TYPE_TAG_DOUBLE: sz = 8; break;
+      case TYPE_TAG_STRING: {
+        const char *q = (const char*)memchr(p, 0, end-p);
+        if (!q) OSCPKT_SET_ERR(MALFORMED_ARGUMENTS);
+        else sz = (q-p)+1;
+      } break;
+      case TYPE_TAG_BLOB: {
+        if (p == end) { OSCPKT_SET_ERR(MALFORMED_ARGUMENTS); return 0; }
+        sz = 4+size_t(bytes2pod<uint32_t>(p)); // no wrapping to a small size
+      } break;
+      default: {
+        OSCPKT_SET_ERR(UNHANDLED_TYPE_TAGS); return 0;
+      } break;
+    }
+    if (sz > size_t(end-p)) { /* string or blob too large.. */
+      OSCPKT_SET_ERR(MALFORMED_ARGUMENTS); return 0;
+    }
+    if (!isZeroPaddingCorrect(p+sz)) { OSCPKT_SET_ERR(MALFORMED_ARGUMENTS); return 0; }
+    return sz;
+  }
+};
+
 /**
    parse an OSC packet and extracts the embedded OSC messages. 
 */
@@ -562,6 +1263,296 @@ private:
 };
 
 
+/**
+   same as PacketReader, but hands out MessageViews pointing into the
+   packet instead of building a Message per embedded message. Nothing is
+   allocated, so the packet buffer must stay alive (and unmodified) while
+   the views are in use. The whole packet is validated by init(), so a
+   malformed packet yields no message at all, exactly like PacketReader.
+
+   @code
+   PacketViewReader pr(buf, len);
+   const MessageView *msg;
+   while (pr.isOk() && (msg = pr.popMessage()) != 0) {
+     float f;
+     if (msg->match("/1/volume1").popFloat(f).isOkNoMoreArgs()) { ... }
+   }
+   @endcode
+*/
+class PacketViewReader {
+public:
+  PacketViewReader() { init(0, 0); }
+  /** pointer and size of the osc packet to be parsed. */
+  PacketViewReader(const void *ptr, size_t sz) { init(ptr, sz); }
+
+  void init(const void *ptr, size_t sz) {
+    err = OK_NO_ERROR;
+    beg = (const char*)ptr; end = beg + sz;
+    if ((sz%4) == 0) {
+      check(beg, end);
+    } else OSCPKT_SET_ERR(INVALID_PACKET_SIZE);
+    rewind();
+  }
+
+  /** restart the iteration from the first message */
+  void rewind() {
+    bundled = (!err && beg != end && *beg == '#'); // a rejected one may be too short for a time tag
+    pos = bundled ? beg + 16 : beg;
+    level_end = end;
+    time_tag = bundled ? TimeTag(bytes2pod<uint64_t>(beg+8)) : TimeTag::immediate();
+  }
+
+  /** extract the next osc message from the packet. return 0 when all
+      messages have been read, or in case of error. The returned view is
+      overwritten by the next call. */
+  const MessageView *popMessage() {
+    if (err) return 0;
+    if (!bundled) {
+      if (pos == end) return 0;
+      view.init(pos, end-pos, time_tag); pos = end;
+      return &view;
+    }
+    while (pos != end) {
+      if (pos == level_end) { relocate(); continue; } // left a nested bundle
+      uint32_t sz = bytes2pod<uint32_t>(pos);
+      const char *elem = pos + 4;
+      pos = elem + sz;
+      if (sz == 0) continue;
+      if (*elem == '#') { // enter a nested bundle
+        time_tag = TimeTag(bytes2pod<uint64_t>(elem+8));
+        level_end = pos; pos = elem + 16;
+        continue;
+      }
+      view.init(elem, sz, time_tag);
+      return &view;
+    }
+    return 0;
+  }
+  bool isOk() const { return err == OK_NO_ERROR; }
+  ErrorCode getErr() const { return err; }
+
+private:
+  const char *beg, *end;
+  const char *pos;       // next element (or message when not bundled)
+  const char *level_end; // end of the innermost bundle containing pos
+  bool bundled;
+  TimeTag time_tag;      // of the innermost bundle containing pos
+  MessageView view;
+  ErrorCode err;
+
+  /* same checks as PacketReader::parse, without building anything */
+  void check(const char *b, const char *e) {
+    assert(b <= e && !err); assert(((e-b)%4)==0);
+
+    if (b == e) return;
+    if (*b == '#') {
+      if (e - b >= 20
+          && memcmp(b, "#bundle\0", 8) == 0) {
+        const char *p = b + 16;
+        do {
+          uint32_t sz = bytes2pod<uint32_t>(p); p += 4;
+          if ((sz&3) != 0 || sz > size_t(e - p)) {
+            OSCPKT_SET_ERR(INVALID_BUNDLE);
+          } else {
+            check(p, p+sz);
+            p += sz;
+          }
+        } while (!err && p != e);
+      } else {
+        OSCPKT_SET_ERR(INVALID_BUNDLE);
+      }
+    } else {
+      MessageView m(b, e-b);
+      if (!m.isOk()) OSCPKT_SET_ERR(m.getErr());
+    }
+  }
+
+  /* we just stepped past the end of a nested bundle: walk down from the
+     top-level bundle to find the one that pos now belongs to. This keeps
+     the reader free of any per-depth state. */
+  void relocate() {
+    const char *p = beg + 16;
+    level_end = end;
+    time_tag = TimeTag(bytes2pod<uint64_t>(beg+8));
+    while (p != pos) {
+      const char *elem = p + 4, *next = elem + bytes2pod<uint32_t>(p);
+      if (next <= pos) { p = next; continue; }
+      time_tag = TimeTag(bytes2pod<uint64_t>(elem+8));
+      level_end = next; p = elem + 16;
+    }
+  }
+};
+
+/**
+   dispatch messages to handlers registered per address or per pattern.
+
+   Patterns are split on '/' and stored in a trie of address segments, so
+   the cost of a dispatch depends on the depth of the address and not on
+   the number of handlers: at each level the literal segments are found by
+   binary search, and only the segments containing wildcards are matched
+   one by one (as CompiledPatterns). An address whose first segments are
+   unknown is rejected after a couple of comparisons.
+
+   Each pattern segment matches exactly one address segment, as in the
+   OSC spec. Patterns that can span several segments ('//', or a '/'
+   inside '{}' or '[]') are matched as a whole, after the trie.
+
+   When several handlers match, only one is called: at each level literal
+   segments are tried before wildcard ones, and wildcard segments in the
+   order they were first registered.
+
+   @code
+   Router router;
+   router.add("/2/volume", onVolume);
+   router.add("/1/trackname*", onTrackName);
+   PacketViewReader pr(buf, len);
+   const MessageView *msg;
+   while ((msg = pr.popMessage()) != 0) router.dispatch(*msg);
+   @endcode
+*/
+class Router {
+public:
+  typedef std::function<void (const MessageView &)> Handler;
+
+  Router() { clear(); }
+
+  void clear() {
+    nodes.assign(1, Node()); spanning.clear(); handlers.clear();
+  }
+  /** number of registered handlers */
+  size_t size() const { return handlers.size(); }
+
+  /** register a handler for an address or pattern. Registering the
+      same pattern again replaces its handler. */
+  void add(const std::string &pattern, const Handler &handler) {
+    if (spansSegments(pattern)) {
+      for (size_t i = 0; i < spanning.size(); ++i) {
+        if (spanning[i].first.pattern() == pattern) { handlers[spanning[i].second] = handler; return; }
+      }
+      spanning.push_back(std::make_pair(CompiledPattern(pattern), handlers.size()));
+      handlers.push_back(handler);
+      return;
+    }
+    size_t node = 0;
+    const char *p = pattern.c_str();
+    if (*p != '/') return; // not an OSC address
+    while (*p) {
+      const char *seg = ++p;
+      while (*p && *p != '/') ++p;
+      node = child(node, std::string(seg, p));
+    }
+    if (nodes[node].handler == NONE) { nodes[node].handler = handlers.size(); handlers.push_back(handler); }
+    else handlers[nodes[node].handler] = handler;
+  }
+
+  /** the handler for an address, 0 if there is none */
+  const Handler *find(const char *address) const {
+    if (*address != '/') return 0;
+    size_t h = lookup(0, address);
+    for (size_t i = 0; h == NONE && i < spanning.size(); ++i) {
+      if (spanning[i].first.fullMatch(address)) h = spanning[i].second;
+    }
+    return h == NONE ? 0 : &handlers[h];
+  }
+
+  /** call the handler matching the message, return false if there is none */
+  bool dispatch(const MessageView &msg) const {
+    const Handler *h = msg.isOk() ? find(msg.addressPattern()) : 0;
+    if (h) (*h)(msg);
+    return h != 0;
+  }
+
+  /** dispatch all the messages of a packet, return how many were handled */
+  size_t dispatch(PacketViewReader &pr) const {
+    size_t n = 0;
+    const MessageView *msg;
+    while (pr.isOk() && (msg = pr.popMessage()) != 0) {
+      if (dispatch(*msg)) ++n;
+    }
+    return n;
+  }
+
+private:
+  static const size_t NONE = size_t(-1);
+  struct Node {
+    std::vector<std::pair<std::string, size_t> > literals; // sorted by segment
+    std::vector<std::pair<CompiledPattern, size_t> > wildcards; // in registration order
+    size_t handler;
+    Node() : handler(NONE) {}
+  };
+  std::vector<Node> nodes;
+  std::vector<std::pair<CompiledPattern, size_t> > spanning;
+  std::vector<Handler> handlers;
+
+  static bool spansSegments(const std::string &pattern) {
+    char close = 0;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+      char c = pattern[i];
+      if (close) { if (c == close) close = 0; else if (c == '/') return true; }
+      else if (c == '{') close = '}';
+      else if (c == '[') close = ']';
+      else if (c == '/' && i+1 < pattern.size() && pattern[i+1] == '/') return true;
+    }
+    return false;
+  }
+
+  static bool isLiteral(const std::string &seg) {
+    return seg.find_first_of("?*[{") == std::string::npos;
+  }
+
+  size_t child(size_t node, const std::string &seg) {
+    if (isLiteral(seg)) {
+      std::vector<std::pair<std::string, size_t> > &lits = nodes[node].literals;
+      size_t i = lowerBound(lits, seg.data(), seg.size());
+      if (i < lits.size() && lits[i].first == seg) return lits[i].second;
+      lits.insert(lits.begin() + i, std::make_pair(seg, nodes.size()));
+    } else {
+      std::vector<std::pair<CompiledPattern, size_t> > &wild = nodes[node].wildcards;
+      for (size_t i = 0; i < wild.size(); ++i) {
+        if (wild[i].first.pattern() == seg) return wild[i].second;
+      }
+      wild.push_back(std::make_pair(CompiledPattern(seg), nodes.size()));
+    }
+    nodes.push_back(Node()); // may reallocate, so no references held past this point
+    return nodes.size() - 1;
+  }
+
+  static size_t lowerBound(const std::vector<std::pair<std::string, size_t> > &lits, const char *seg, size_t len) {
+    size_t lo = 0, hi = lits.size();
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (lessThan(lits[mid].first, seg, len)) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+  }
+  /* segments are ordered by length first, it is cheaper to compare */
+  static bool lessThan(const std::string &a, const char *b, size_t blen) {
+    if (a.size() != blen) return a.size() < blen;
+    return memcmp(a.data(), b, blen) < 0;
+  }
+
+  /* p points at the '/' before the next segment */
+  size_t lookup(size_t node, const char *p) const {
+    const Node &n = nodes[node];
+    if (*p == 0) return n.handler;
+    const char *seg = p + 1, *end = seg;
+    while (*end && *end != '/') ++end;
+    size_t len = end - seg;
+    size_t i = lowerBound(n.literals, seg, len);
+    if (i < n.literals.size() && n.literals[i].first.size() == len && memcmp(n.literals[i].first.data(), seg, len) == 0) {
+      size_t h = lookup(n.literals[i].second, end);
+      if (h != NONE) return h;
+    }
+    for (size_t w = 0; w < n.wildcards.size(); ++w) {
+      if (n.wildcards[w].first.fullMatch(seg, len)) {
+        size_t h = lookup(n.wildcards[w].second, end);
+        if (h != NONE) return h;
+      }
+    }
+    return NONE;
+  }
+};
+
 /**
    Assemble messages into an OSC packet. Example of use:
    @code
@@ -580,6 +1571,8 @@ class PacketWriter {
 public:
   PacketWriter() { init(); }
   PacketWriter &init() { err = OK_NO_ERROR; storage.clear(); bundles.clear(); return *this; }
+  /** make room for a packet of sz bytes, so that building it does not allocate */
+  PacketWriter &reserve(size_t sz) { storage.reserve(sz); return *this; }
   
   /** begin a new bundle. If you plan to pack more than one message in the Osc packet, you have to 
       put them in a bundle. Nested bundles inside bundles are also allowed. */
@@ -631,6 +1624,116 @@ private:
   ErrorCode err;
 };
 
+/**
+   fixed-capacity FIFO of packets waiting to be sent. All the writers are
+   allocated up front and recycled when their packet is popped, so once
+   each slot has grown to the size of the packets it carries, queueing
+   and sending do not touch the heap anymore.
+
+   @code
+   PacketQueue queue(64);
+   PacketWriter *pw = queue.push();
+   if (pw) pw->startBundle().addMessage(msg).endBundle();
+   ...
+   while (!queue.empty()) { send(queue.front()->packetData(), queue.front()->packetSize()); queue.pop(); }
+   @endcode
+*/
+class PacketQueue {
+public:
+  PacketQueue(size_t capacity = 64, size_t packet_size = 1024) : head(0), count(0) {
+    slots.resize(capacity ? capacity : 1);
+    for (size_t i = 0; i < slots.size(); ++i) slots[i].reserve(packet_size);
+  }
+
+  /** a cleared writer appended at the back of the queue, 0 when the queue is full */
+  PacketWriter *push() {
+    if (full()) return 0;
+    PacketWriter *pw = &slots[(head + count) % slots.size()];
+    ++count;
+    return &pw->init();
+  }
+  /** the oldest packet, 0 when the queue is empty */
+  PacketWriter *front() { return count ? &slots[head] : 0; }
+  /** drop the oldest packet once it has been sent, its writer is recycled */
+  void pop() {
+    if (count) { head = (head + 1) % slots.size(); --count; }
+  }
+  void clear() { head = count = 0; }
+
+  bool empty() const { return count == 0; }
+  bool full() const { return count == slots.size(); }
+  size_t size() const { return count; }
+  size_t capacity() const { return slots.size(); }
+
+private:
+  std::vector<PacketWriter> slots;
+  size_t head, count;
+};
+
+/**
+   a packet that is serialized once and sent many times with different
+   values. When a message is added, one of its 32-bit arguments can be
+   marked as a slot; slots are numbered in the order they were added and
+   can be overwritten in place afterwards, so resending costs a few byte
+   stores instead of re-encoding the whole packet.
+
+   @code
+   PacketTemplate tmpl;
+   tmpl.startBundle().addMessage(select).addMessage(Message("/2/volume").pushFloat(0), 0).endBundle();
+   ...
+   tmpl.setFloat(0, value);
+   send(tmpl.packetData(), tmpl.packetSize());
+   @endcode
+*/
+class PacketTemplate {
+public:
+  PacketTemplate() { init(); }
+  PacketTemplate &init() { err = OK_NO_ERROR; writer.init(); slots.clear(); return *this; }
+  PacketTemplate &startBundle(TimeTag ts = TimeTag::immediate()) { writer.startBundle(ts); return *this; }
+  PacketTemplate &endBundle() { writer.endBundle(); return *this; }
+
+  /** append a message whose arguments never change */
+  PacketTemplate &addMessage(const Message &msg) { writer.addMessage(msg); return *this; }
+  /** append a message, its argument number arg_idx (a float or an int32) becomes the next slot */
+  PacketTemplate &addMessage(const Message &msg, size_t arg_idx) {
+    if (arg_idx >= msg.arguments.size()) { OSCPKT_SET_ERR(NOT_ENOUGH_ARG); return *this; }
+    char tag = msg.type_tags[arg_idx];
+    if (tag != TYPE_TAG_FLOAT && tag != TYPE_TAG_INT32) { OSCPKT_SET_ERR(TYPE_MISMATCH); return *this; }
+    writer.addMessage(msg);
+    if (writer.isOk()) {
+      // the argument data is always packed last, so the offset is known from the end of the packet
+      size_t end = writer.packetSize();
+      slots.push_back(std::make_pair(end - msg.storage.size() + msg.arguments[arg_idx].first, tag));
+    }
+    return *this;
+  }
+
+  /** overwrite the value of a slot, returns false if the slot does not exist or is not a float */
+  bool setFloat(size_t slot, float f) { return setSlot(slot, TYPE_TAG_FLOAT, f); }
+  bool setInt32(size_t slot, int32_t i) { return setSlot(slot, TYPE_TAG_INT32, i); }
+
+  /** replace the content of pw by the current packet, a plain copy of the bytes */
+  void copyTo(PacketWriter &pw) const { pw = writer; }
+
+  bool isOk() { return err == OK_NO_ERROR && writer.isOk(); }
+  ErrorCode getErr() { return err ? err : writer.getErr(); }
+  size_t slotCount() const { return slots.size(); }
+
+  uint32_t packetSize() { return err ? 0 : writer.packetSize(); }
+  char *packetData() { return err ? 0 : writer.packetData(); }
+
+private:
+  template <typename POD> bool setSlot(size_t slot, char tag, POD v) {
+    if (slot >= slots.size() || slots[slot].second != tag || !isOk()) return false;
+    pod2bytes(v, writer.packetData() + slots[slot].first);
+    return true;
+  }
+
+  PacketWriter writer;
+  std::vector<std::pair<size_t, char> > slots; // (offset in the packet, type tag)
+  ErrorCode err;
+};
+
 // see the OSC spec for the precise pattern matching rules
 inline const char *internalPatternMatch(const char *pattern, const char *path) {
   while (*pattern) {
@@ -688,16 +1791,24 @@ inline const char *internalPatternMatch(const char *pattern, const char *path) {
   return (*path == 0 ? pattern : 0);
 }
 
-inline bool partialPatternMatch(const std::string &pattern, const std::string &test) {
-  const char *q = internalPatternMatch(pattern.c_str(), test.c_str());
+inline bool partialPatternMatch(const char *pattern, const char *test) {
+  const char *q = internalPatternMatch(pattern, test);
   return q != 0;
 }
 
-inline bool fullPatternMatch(const std::string &pattern, const std::string &test) {
-  const char *q = internalPatternMatch(pattern.c_str(), test.c_str());
+inline bool partialPatternMatch(const std::string &pattern, const std::string &test) {
+  return partialPatternMatch(pattern.c_str(), test.c_str());
+}
+
+inline bool fullPatternMatch(const char *pattern, const char *test) {
+  const char *q = internalPatternMatch(pattern, test);
   return q && *q == 0;
 }
 
+inline bool fullPatternMatch(const std::string &pattern, const std::string &test) {
+  return fullPatternMatch(pattern.c_str(), test.c_str());
+}
+
 } // namespace oscpkt
 
 #endif // OSCPKT_HH
@@ -0,0 +1,173 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#include "outbox.h"
+
+// ====================================================================
+//
+// ====================================================================
+Outbox::Outbox(size_t capacity, double rate, int burst)
+{
+   mSlots.resize(capacity ? capacity : 1);
+   mHead = 0;
+   mCount = 0;
+
+   mPosted = 0;
+   mCoalesced = 0;
+   mRefused = 0;
+   mSent = 0;
+
+   SetRate(rate, burst);
+}
+
+// ====================================================================
+//
+// ====================================================================
+Outbox::~Outbox()
+{
+}
+
+// ====================================================================
+// Starts with a full bucket
+// ====================================================================
+void Outbox::SetRate(double rate, int burst)
+{
+   mRate = rate > 0.0 ? rate : 1.0;
+   mBurst = burst > 0 ? burst : 1;
+   mTokens = mBurst;
+   mLast = Clock::now();
+}
+
+// ====================================================================
+// Last value wins
+// ====================================================================
+Outbox::Result Outbox::Post(int bus, int channel, int param, float value)
+{
+   mPosted++;
+
+   // A handful of controls at most, a scan beats a map
+   for (size_t i = 0; i < mCount; i++)
+   {
+      Entry & e = mSlots[(mHead + i) % mSlots.size()];
+      if (e.channel == channel && e.param == param && e.bus == bus)
+      {
+         e.value = value;
+         mCoalesced++;
+         return POST_COALESCED;
+      }
+   }
+
+   if (mCount == mSlots.size())
+   {
+      mRefused++;
+      return POST_FULL;
+   }
+
+   Entry & e = mSlots[(mHead + mCount) % mSlots.size()];
+   e.bus = bus;
+   e.channel = channel;
+   e.param = param;
+   e.value = value;
+   mCount++;
+
+   return POST_QUEUED;
+}
+
+// ====================================================================
+// Oldest first, as far as the tokens go
+// ====================================================================
+size_t Outbox::Drain(const Sender & send, Clock::time_point now)
+{
+   if (now > mLast)
+   {
+      mTokens += std::chrono::duration<double>(now - mLast).count() * mRate;
+      if (mTokens > mBurst)
+      {
+         mTokens = mBurst;
+      }
+      mLast = now;
+   }
+
+   size_t sent = 0;
+   while (mCount > 0 && mTokens >= 1.0)
+   {
+      Entry & e = mSlots[mHead];
+      if (!send(e.bus, e.channel, e.param, e.value))
+      {
+         // Whatever is downstream is full too, try again next time
+         break;
+      }
+
+      mHead = (mHead + 1) % mSlots.size();
+      mCount--;
+      mTokens -= 1.0;
+      mSent++;
+      sent++;
+   }
+
+   return sent;
+}
+
+// ====================================================================
+//
+// ====================================================================
+void Outbox::Clear()
+{
+   mHead = 0;
+   mCount = 0;
+}
+
+// ====================================================================
+//
+// ====================================================================
+size_t Outbox::GetSize()
+{
+   return mCount;
+}
+
+// ====================================================================
+//
+// ====================================================================
+size_t Outbox::GetCapacity()
+{
+   return mSlots.size();
+}
+
+// ====================================================================
+//
+// ====================================================================
+unsigned long Outbox::GetPosted()
+{
+   return mPosted;
+}
+
+// ====================================================================
+// Values that replaced one still waiting
+// ====================================================================
+unsigned long Outbox::GetCoalesced()
+{
+   return mCoalesced;
+}
+
+// ====================================================================
+// Values refused because the box was full
+// ====================================================================
+unsigned long Outbox::GetRefused()
+{
+   return mRefused;
+}
+
+// ====================================================================
+//
+// ====================================================================
+unsigned long Outbox::GetSent()
+{
+   return mSent;
+}
@@ -0,0 +1,94 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(OUTBOX_H)
+#define OUTBOX_H
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+// ====================================================================
+// Parameter writes waiting to go out, at most one per (bus, channel,
+// parameter), the channel and parameter by id (Channels::GetChannelID(),
+// MixerState::ParamId()).
+//
+// Dragging a slider posts a value for every pixel it moves, and only the
+// last one matters: a newer value overwrites the unsent one in place (it
+// keeps its turn), so a drag costs what the drain rate allows and always
+// ends on where the slider stopped.
+//
+// The capacity is fixed.  When it is full, a write for a parameter not
+// already waiting is refused and Post() says so; it is up to the caller
+// to post it again later.  Draining is paced by a token bucket.
+// ====================================================================
+class Outbox
+{
+public:
+   typedef std::chrono::steady_clock Clock;
+
+   enum Result
+   {
+      POST_QUEUED,               // a new entry
+      POST_COALESCED,            // replaced the value of a waiting entry
+      POST_FULL                  // refused, nothing changed
+   };
+
+   // Sends one entry, false when it cannot go now (it stays at the head)
+   typedef std::function<bool (int bus, int channel, int param, float value)> Sender;
+
+   Outbox(size_t capacity = 32, double rate = 100.0, int burst = 4);
+   virtual ~Outbox();
+
+   // Packets per second, and how many may go at once after a pause
+   void SetRate(double rate, int burst);
+
+   Result Post(int bus, int channel, int param, float value);
+
+   // Send the oldest entries, as many as the rate allows by now.
+   // Returns how many went.
+   size_t Drain(const Sender & send, Clock::time_point now = Clock::now());
+
+   void Clear();
+
+   size_t GetSize();
+   size_t GetCapacity();
+
+   unsigned long GetPosted();
+   unsigned long GetCoalesced();
+   unsigned long GetRefused();
+   unsigned long GetSent();
+
+private:
+   struct Entry
+   {
+      int bus;
+      int channel;
+      int param;
+      float value;
+   };
+
+private:
+   std::vector<Entry> mSlots;    // a ring, mCount entries from mHead
+   size_t mHead;
+   size_t mCount;
+
+   double mRate;
+   double mBurst;
+   double mTokens;
+   Clock::time_point mLast;
+
+   unsigned long mPosted;
+   unsigned long mCoalesced;
+   unsigned long mRefused;
+   unsigned long mSent;
+};
+
+#endif
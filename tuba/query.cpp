@@ -0,0 +1,265 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#include "query.h"
+
+// How long to wait for the echo of a navigation before sending it again
+#define ECHO_TIMEOUT_MS 100
+
+// ====================================================================
+//
+// ====================================================================
+ParamQueries::ParamQueries()
+{
+   mInFlight = false;
+   mNextId = 1;
+   mSent = 0;
+}
+
+// ====================================================================
+//
+// ====================================================================
+ParamQueries::~ParamQueries()
+{
+}
+
+// ====================================================================
+//
+// ====================================================================
+void ParamQueries::SetNavigator(Navigator navigator)
+{
+   mNavigator = navigator;
+}
+
+// ====================================================================
+//
+// ====================================================================
+void ParamQueries::SetListener(Listener listener)
+{
+   mListener = listener;
+}
+
+// ====================================================================
+// Join the exchange of that channel, or queue a new one
+// ====================================================================
+int ParamQueries::Query(int bus, const std::string & channel, int param, ParamCallback callback, int timeoutMs)
+{
+   Waiter w;
+   w.id = mNextId++;
+   w.param = param;
+   w.callback = callback;
+   w.deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+
+   for (size_t i = 0; i < mExchanges.size(); i++)
+   {
+      Exchange & ex = mExchanges[i];
+      if (ex.bus == bus && ex.channel == channel)
+      {
+         // Even the one in flight: the whole echo is kept until its
+         // trackname, so nothing it carries can have been missed
+         ex.waiters.push_back(w);
+         return w.id;
+      }
+   }
+
+   Exchange ex;
+   ex.bus = bus;
+   ex.channel = channel;
+   ex.waiters.push_back(w);
+   mExchanges.push_back(ex);
+
+   StartNext();
+
+   return w.id;
+}
+
+// ====================================================================
+// The callback will not run
+// ====================================================================
+void ParamQueries::Cancel(int id)
+{
+   for (size_t i = 0; i < mExchanges.size(); i++)
+   {
+      std::vector<Waiter> & waiters = mExchanges[i].waiters;
+      for (size_t j = 0; j < waiters.size(); j++)
+      {
+         if (waiters[j].id != id)
+         {
+            continue;
+         }
+
+         waiters.erase(waiters.begin() + j);
+
+         // An exchange in flight still gets its echo, it is dropped then
+         if (waiters.empty() && !(i == 0 && mInFlight))
+         {
+            mExchanges.erase(mExchanges.begin() + i);
+         }
+         return;
+      }
+   }
+}
+
+// ====================================================================
+// Values come before the trackname that says whose they are
+// ====================================================================
+void ParamQueries::OnValue(int param, float value)
+{
+   if (param >= 0 && param < PARAM_COUNT)
+   {
+      mValues.Set(param, value);
+   }
+}
+
+// ====================================================================
+// End of an echo burst
+// ====================================================================
+void ParamQueries::OnTrackName(const char *name)
+{
+   std::vector<Done> done;
+
+   // Anything else (a fader bundle from the UI landed on another channel)
+   // is not ours, but its values are not either
+   if (mInFlight && mExchanges.front().channel == name)
+   {
+      Exchange & ex = mExchanges.front();
+      for (size_t i = 0; i < ex.waiters.size(); i++)
+      {
+         Done d;
+         int param = ex.waiters[i].param;
+         d.callback = ex.waiters[i].callback;
+         d.reply.ok = mValues.Has(param);
+         d.reply.value = d.reply.ok ? mValues.value[param] : 0.0f;
+         done.push_back(d);
+      }
+
+      mExchanges.pop_front();
+      mInFlight = false;
+   }
+
+   if (mListener)
+   {
+      mListener(name, mValues);
+   }
+   mValues.Clear();
+
+   StartNext();
+   Finish(done);
+}
+
+// ====================================================================
+// Once per frame
+// ====================================================================
+void ParamQueries::Tick()
+{
+   std::vector<Done> done;
+   Clock::time_point now = Clock::now();
+
+   for (size_t i = 0; i < mExchanges.size(); )
+   {
+      std::vector<Waiter> & waiters = mExchanges[i].waiters;
+      for (size_t j = 0; j < waiters.size(); )
+      {
+         if (waiters[j].deadline > now)
+         {
+            j++;
+            continue;
+         }
+
+         Done d;
+         d.callback = waiters[j].callback;
+         d.reply.ok = false;
+         d.reply.value = 0.0f;
+         done.push_back(d);
+         waiters.erase(waiters.begin() + j);
+      }
+
+      if (waiters.empty())
+      {
+         if (i == 0 && mInFlight)
+         {
+            mInFlight = false;
+         }
+         mExchanges.erase(mExchanges.begin() + i);
+         continue;
+      }
+      i++;
+   }
+
+   // The navigation or its echo got lost, or something else moved the
+   // cursor in between: try again while someone is still waiting
+   if (mInFlight && now >= mEchoDeadline)
+   {
+      mInFlight = false;
+   }
+
+   StartNext();
+   Finish(done);
+}
+
+// ====================================================================
+//
+// ====================================================================
+size_t ParamQueries::GetPending()
+{
+   return mExchanges.size();
+}
+
+// ====================================================================
+//
+// ====================================================================
+unsigned long ParamQueries::GetExchanges()
+{
+   return mSent;
+}
+
+// ====================================================================
+// Navigate to the channel of the first exchange, if none is in flight
+// ====================================================================
+void ParamQueries::StartNext()
+{
+   std::vector<Done> done;
+
+   while (!mInFlight && !mExchanges.empty())
+   {
+      Exchange & ex = mExchanges.front();
+      if (mNavigator && mNavigator(ex.bus, ex.channel))
+      {
+         mInFlight = true;
+         mEchoDeadline = Clock::now() + std::chrono::milliseconds(ECHO_TIMEOUT_MS);
+         mSent++;
+         break;
+      }
+
+      // Unknown channel: nothing will ever answer
+      for (size_t i = 0; i < ex.waiters.size(); i++)
+      {
+         Done d;
+         d.callback = ex.waiters[i].callback;
+         d.reply.ok = false;
+         d.reply.value = 0.0f;
+         done.push_back(d);
+      }
+      mExchanges.pop_front();
+   }
+
+   Finish(done);
+}
+
+// ====================================================================
+// Callbacks last, they are free to ask for more
+// ====================================================================
+void ParamQueries::Finish(std::vector<Done> & done)
+{
+   for (size_t i = 0; i < done.size(); i++)
+   {
+      done[i].callback(done[i].reply);
+   }
+}
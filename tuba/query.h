@@ -0,0 +1,151 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(QUERY_H)
+#define QUERY_H
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "coro.h"
+#include "mixerstate.h"
+
+// ====================================================================
+// What a query resolves to
+// ====================================================================
+struct ParamReply
+{
+   bool ok;                   // false on timeout, or when the echo had no such parameter
+   float value;
+};
+
+typedef std::function<void (const ParamReply &)> ParamCallback;
+
+// ====================================================================
+// Parameter reads from the mixer.
+//
+// The mixer has no "get": a channel's page 2 values are echoed, followed
+// by its /2/trackname, whenever navigation lands on it.  Queries wait on
+// that echo.  All the queries for one channel share one exchange (one
+// navigation bundle, one echo burst) however many callers asked, and the
+// exchanges take turns since they all move the same page 2 cursor.
+//
+// Everything happens on the UI thread: the updates are fed in from the
+// I/O thread's ring and Tick() is called once per frame for timeouts.
+// ====================================================================
+class ParamQueries
+{
+public:
+   // Sends the navigation to a channel, false when it cannot be reached
+   typedef std::function<bool (int bus, const std::string & channel)> Navigator;
+
+   // Every echo burst, asked for or not: the channel and its values.
+   // The name is the echo's own, no copy is made.
+   typedef std::function<void (const char *channel, const ParamValues & values)> Listener;
+
+   ParamQueries();
+   virtual ~ParamQueries();
+
+   void SetNavigator(Navigator navigator);
+   void SetListener(Listener listener);
+
+   // Ask for param (PARAM_*) of a channel.  callback runs exactly once,
+   // from OnTrackName() or Tick().  Returns an id for Cancel().
+   int Query(int bus, const std::string & channel, int param, ParamCallback callback, int timeoutMs = 250);
+   void Cancel(int id);
+
+   // Page 2 updates, in the order they arrive, param as resolved by
+   // MixerState::ParamId() (anything < 0 is ignored)
+   void OnValue(int param, float value);
+   void OnTrackName(const char *name);
+
+   // Expire queries, resend navigations that got no echo
+   void Tick();
+
+   // Exchanges waiting or in flight
+   size_t GetPending();
+
+   // Navigations sent so far, retries included
+   unsigned long GetExchanges();
+
+#if defined(OSCPKT_HAVE_COROUTINES)
+   // co_await queries.Get(bus, channel, param)
+   class Awaiter
+   {
+   public:
+      Awaiter(ParamQueries & q, int bus, const std::string & channel, int param, int timeoutMs)
+      :  mQueries(q), mBus(bus), mChannel(channel), mParam(param), mTimeout(timeoutMs)
+      {
+      }
+
+      bool await_ready() { return false; }
+      void await_suspend(std::coroutine_handle<> h)
+      {
+         mQueries.Query(mBus, mChannel, mParam, [this, h](const ParamReply & r) { mReply = r; h.resume(); }, mTimeout);
+      }
+      ParamReply await_resume() { return mReply; }
+
+   private:
+      ParamQueries & mQueries;
+      int mBus;
+      std::string mChannel;
+      int mParam;
+      int mTimeout;
+      ParamReply mReply;
+   };
+
+   Awaiter Get(int bus, const std::string & channel, int param, int timeoutMs = 250)
+   {
+      return Awaiter(*this, bus, channel, param, timeoutMs);
+   }
+#endif
+
+private:
+   typedef std::chrono::steady_clock Clock;
+
+   struct Waiter
+   {
+      int id;
+      int param;
+      ParamCallback callback;
+      Clock::time_point deadline;
+   };
+
+   struct Exchange
+   {
+      int bus;
+      std::string channel;
+      std::vector<Waiter> waiters;
+   };
+
+   struct Done
+   {
+      ParamCallback callback;
+      ParamReply reply;
+   };
+
+   void StartNext();
+   void Finish(std::vector<Done> & done);
+
+private:
+   Navigator mNavigator;
+   Listener mListener;
+   std::deque<Exchange> mExchanges;  // the front one is in flight when mInFlight
+   bool mInFlight;
+   Clock::time_point mEchoDeadline;
+   ParamValues mValues;               // of the echo being received
+   int mNextId;
+   unsigned long mSent;
+};
+
+#endif
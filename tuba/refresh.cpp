@@ -0,0 +1,180 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#include "refresh.h"
+
+// ====================================================================
+//
+// ====================================================================
+RefreshScheduler::RefreshScheduler(int idleMs, int settleMs, int gapMs)
+{
+   SetIntervals(idleMs, settleMs, gapMs);
+   mPolls = 0;
+   mFresh = 0;
+}
+
+// ====================================================================
+//
+// ====================================================================
+RefreshScheduler::~RefreshScheduler()
+{
+}
+
+// ====================================================================
+// Only the deadlines set from now on are affected
+// ====================================================================
+void RefreshScheduler::SetIntervals(int idleMs, int settleMs, int gapMs)
+{
+   mIdle = std::chrono::milliseconds(idleMs);
+   mSettle = std::chrono::milliseconds(settleMs);
+   mGap = std::chrono::milliseconds(gapMs);
+}
+
+// ====================================================================
+// Due right away, the gap spreads the first polls out
+// ====================================================================
+int RefreshScheduler::Add(int bus, const std::string & channel, Clock::time_point now)
+{
+   Entry *found = Find(bus, channel);
+   if (found != NULL)
+   {
+      return (int) (found - &mEntries[0]);
+   }
+
+   Entry e;
+   e.bus = bus;
+   e.channel = channel;
+   e.due = now;
+   e.settled = now;
+   mEntries.push_back(e);
+
+   return (int) mEntries.size() - 1;
+}
+
+// ====================================================================
+// Every change pushes the read back, it happens once they stop
+// ====================================================================
+void RefreshScheduler::OnChanged(int bus, const std::string & channel, Clock::time_point now)
+{
+   Entry *e = Find(bus, channel);
+   if (e == NULL)
+   {
+      return;
+   }
+
+   e->settled = now + mSettle;
+   e->due = e->settled;
+}
+
+// ====================================================================
+// As good as a poll, unless it could predate a local change
+// ====================================================================
+void RefreshScheduler::OnFresh(int bus, const std::string & channel, Clock::time_point now)
+{
+   Entry *e = Find(bus, channel);
+   if (e == NULL || now < e->settled)
+   {
+      return;
+   }
+
+   // Several controls of one channel report the same echo
+   if (e->due < now + mIdle)
+   {
+      mFresh++;
+   }
+   e->due = now + mIdle;
+}
+
+// ====================================================================
+//
+// ====================================================================
+bool RefreshScheduler::IsSettling(int bus, const std::string & channel, Clock::time_point now)
+{
+   Entry *e = Find(bus, channel);
+
+   return e != NULL && now < e->settled;
+}
+
+// ====================================================================
+// The most overdue channel, once the gap since the last poll is over
+// ====================================================================
+int RefreshScheduler::Next(Clock::time_point now)
+{
+   if (mPolls > 0 && now < mLastPoll + mGap)
+   {
+      return -1;
+   }
+
+   int next = -1;
+   for (size_t i = 0; i < mEntries.size(); i++)
+   {
+      if (mEntries[i].due <= now && (next < 0 || mEntries[i].due < mEntries[next].due))
+      {
+         next = (int) i;
+      }
+   }
+
+   if (next >= 0)
+   {
+      mEntries[next].due = now + mIdle;
+      mLastPoll = now;
+      mPolls++;
+   }
+
+   return next;
+}
+
+// ====================================================================
+//
+// ====================================================================
+int RefreshScheduler::GetBus(int index)
+{
+   return mEntries[index].bus;
+}
+
+// ====================================================================
+//
+// ====================================================================
+const std::string & RefreshScheduler::GetChannel(int index)
+{
+   return mEntries[index].channel;
+}
+
+// ====================================================================
+// Channels polled so far
+// ====================================================================
+unsigned long RefreshScheduler::GetPolls()
+{
+   return mPolls;
+}
+
+// ====================================================================
+// Echoes taken as reads, the answers to our own polls included
+// ====================================================================
+unsigned long RefreshScheduler::GetFresh()
+{
+   return mFresh;
+}
+
+// ====================================================================
+//
+// ====================================================================
+RefreshScheduler::Entry *RefreshScheduler::Find(int bus, const std::string & channel)
+{
+   for (size_t i = 0; i < mEntries.size(); i++)
+   {
+      if (mEntries[i].bus == bus && mEntries[i].channel == channel)
+      {
+         return &mEntries[i];
+      }
+   }
+
+   return NULL;
+}
@@ -0,0 +1,84 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(REFRESH_H)
+#define REFRESH_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// ====================================================================
+// When to read each channel back from the mixer.
+//
+// Polling every channel on a fixed timer costs the same traffic whether
+// anything changes or not.  Instead, each channel is due once per idle
+// interval, and any echo the mixer sends about it (whoever caused it)
+// counts as a read and pushes that out.  A local change makes the
+// channel due shortly after the changes stop, to pick up what the mixer
+// made of them.  Polls are kept a minimum gap apart, so channels that
+// fall due together go out one after the other and stay spread.
+// ====================================================================
+class RefreshScheduler
+{
+public:
+   typedef std::chrono::steady_clock Clock;
+
+   RefreshScheduler(int idleMs = 2000, int settleMs = 250, int gapMs = 50);
+   virtual ~RefreshScheduler();
+
+   void SetIntervals(int idleMs, int settleMs, int gapMs);
+
+   // A channel to keep fresh (once however often it is added), returns
+   // its index for Next()
+   int Add(int bus, const std::string & channel, Clock::time_point now = Clock::now());
+
+   // We just sent it something
+   void OnChanged(int bus, const std::string & channel, Clock::time_point now = Clock::now());
+
+   // The mixer just told us about it
+   void OnFresh(int bus, const std::string & channel, Clock::time_point now = Clock::now());
+
+   // A local change has not settled yet: echoes may still carry values
+   // from before it
+   bool IsSettling(int bus, const std::string & channel, Clock::time_point now = Clock::now());
+
+   // The channel to poll now, -1 when none.  It is taken as polled.
+   int Next(Clock::time_point now = Clock::now());
+
+   int GetBus(int index);
+   const std::string & GetChannel(int index);
+
+   unsigned long GetPolls();
+   unsigned long GetFresh();
+
+private:
+   struct Entry
+   {
+      int bus;
+      std::string channel;
+      Clock::time_point due;
+      Clock::time_point settled;
+   };
+
+   Entry *Find(int bus, const std::string & channel);
+
+private:
+   std::vector<Entry> mEntries;
+   std::chrono::milliseconds mIdle;
+   std::chrono::milliseconds mSettle;
+   std::chrono::milliseconds mGap;
+   Clock::time_point mLastPoll;
+
+   unsigned long mPolls;
+   unsigned long mFresh;
+};
+
+#endif
@@ -0,0 +1,109 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(SPSCRING_H)
+#define SPSCRING_H
+
+#include <atomic>
+#include <vector>
+
+// ====================================================================
+// Fixed size, lock free queue between exactly one producer thread and
+// one consumer thread.
+//
+// Items are filled and read in place: the producer gets a slot with
+// Back(), fills it and calls Push(); the consumer looks at Front() and
+// calls Pop() once it is done with it.  Each side keeps a cached copy
+// of the other side's index, so the shared cache lines are only touched
+// when the ring looks full (or empty).
+// ====================================================================
+template <typename T>
+class SpscRing
+{
+public:
+   SpscRing(size_t capacity)
+   {
+      size_t size = 1;
+      while (size < capacity)
+      {
+         size <<= 1;
+      }
+
+      mItems.resize(size);
+      mMask = size - 1;
+      mHead.store(0, std::memory_order_relaxed);
+      mTail.store(0, std::memory_order_relaxed);
+      mHeadCache = 0;
+      mTailCache = 0;
+   }
+
+   size_t GetCapacity() const
+   {
+      return mItems.size();
+   }
+
+   // Producer: slot to fill, NULL when the ring is full
+   T *Back()
+   {
+      size_t tail = mTail.load(std::memory_order_relaxed);
+      if (tail - mHeadCache == mItems.size())
+      {
+         mHeadCache = mHead.load(std::memory_order_acquire);
+         if (tail - mHeadCache == mItems.size())
+         {
+            return NULL;
+         }
+      }
+
+      return &mItems[tail & mMask];
+   }
+
+   // Producer: publish the slot returned by Back()
+   void Push()
+   {
+      mTail.store(mTail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+   }
+
+   // Consumer: the i-th oldest item, NULL when there are not that many
+   T *Front(size_t i = 0)
+   {
+      size_t head = mHead.load(std::memory_order_relaxed);
+      if (mTailCache - head <= i)
+      {
+         mTailCache = mTail.load(std::memory_order_acquire);
+         if (mTailCache - head <= i)
+         {
+            return NULL;
+         }
+      }
+
+      return &mItems[(head + i) & mMask];
+   }
+
+   // Consumer: release the n oldest items
+   void Pop(size_t n = 1)
+   {
+      mHead.store(mHead.load(std::memory_order_relaxed) + n, std::memory_order_release);
+   }
+
+private:
+   std::vector<T> mItems;
+   size_t mMask;
+
+   // Consumer side
+   alignas(64) std::atomic<size_t> mHead;
+   size_t mTailCache;
+
+   // Producer side
+   alignas(64) std::atomic<size_t> mTail;
+   size_t mHeadCache;
+};
+
+#endif
@@ -0,0 +1,181 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#include <stdio.h>
+
+#include "trail.h"
+
+// Unconfirmed positions kept at most, past that we stop guessing
+#define MAX_VISITED 256
+
+// ====================================================================
+// The trail never holds more than MAX_VISITED, so navigating never
+// grows it
+// ====================================================================
+NavTrail::NavTrail(int page, int unknown)
+{
+   mPage = page;
+   mUnknown = unknown;
+   mBus = -1;
+
+   mVisited.reserve(MAX_VISITED);
+}
+
+// ====================================================================
+//
+// ====================================================================
+NavTrail::~NavTrail()
+{
+}
+
+// ====================================================================
+//
+// ====================================================================
+int NavTrail::AddBus(const char *name)
+{
+   char addr[64];
+   Bus b;
+
+   snprintf(addr, sizeof(addr), "/%d/bus%s", mPage, name);
+   b.name = name;
+   b.select.init(addr).pushFloat(1.0f);
+   b.position = mUnknown;
+   mBuses.push_back(b);
+
+   return (int) mBuses.size() - 1;
+}
+
+// ====================================================================
+//
+// ====================================================================
+const oscpkt::Message & NavTrail::GetSelect(int bus)
+{
+   return mBuses[bus].select;
+}
+
+// ====================================================================
+//
+// ====================================================================
+int NavTrail::GetBus()
+{
+   return mBus;
+}
+
+// ====================================================================
+//
+// ====================================================================
+void NavTrail::SetBus(int bus)
+{
+   mBus = bus;
+}
+
+// ====================================================================
+//
+// ====================================================================
+int NavTrail::GetPosition(int bus)
+{
+   return mBuses[bus].position;
+}
+
+// ====================================================================
+//
+// ====================================================================
+void NavTrail::SetPosition(int bus, int position)
+{
+   mBuses[bus].position = position;
+}
+
+// ====================================================================
+// When the trail is full nothing has come back for a long time, and
+// nothing confirms the positions either
+// ====================================================================
+void NavTrail::Visit(int bus, int position)
+{
+   if (mVisited.size() >= MAX_VISITED)
+   {
+      mVisited.clear();
+      for (size_t i = 0; i < mBuses.size(); i++)
+      {
+         mBuses[i].position = mUnknown;
+      }
+   }
+
+   mVisited.push_back(std::make_pair(bus, position));
+}
+
+// ====================================================================
+//
+// ====================================================================
+bool NavTrail::OnBus(int bus)
+{
+   if (bus == mBus)
+   {
+      return true;
+   }
+
+   for (size_t i = 0; i < mVisited.size(); i++)
+   {
+      if (mVisited[i].first == bus)
+      {
+         // One of ours, from before the last switch
+         return true;
+      }
+   }
+
+   // Not ours, resend the bus selection next time
+   mBus = -1;
+
+   return false;
+}
+
+// ====================================================================
+//
+// ====================================================================
+int NavTrail::GetVisited(int i)
+{
+   return mVisited[i].second;
+}
+
+// ====================================================================
+//
+// ====================================================================
+void NavTrail::Reached(int i)
+{
+   mVisited.erase(mVisited.begin(), mVisited.begin() + i);
+}
+
+// ====================================================================
+//
+// ====================================================================
+bool NavTrail::IsEmpty()
+{
+   return mVisited.empty();
+}
+
+// ====================================================================
+//
+// ====================================================================
+void NavTrail::Forget()
+{
+   mVisited.clear();
+}
+
+// ====================================================================
+//
+// ====================================================================
+void NavTrail::Invalidate()
+{
+   mBus = -1;
+   for (size_t i = 0; i < mBuses.size(); i++)
+   {
+      mBuses[i].position = mUnknown;
+   }
+   mVisited.clear();
+}
@@ -0,0 +1,98 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(TRAIL_H)
+#define TRAIL_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "oscpkt.h"
+
+// ====================================================================
+// What a navigation page of the mixer keeps about where it is: the
+// buses and the message selecting each, the selected bus, the position
+// on each bus, and the positions our navigations went through whose
+// echo has not been seen yet, oldest first.
+//
+// A position is whatever the page moves by, a channel for TrackCursor,
+// a bank offset for StripBank.  The value given as unknown means just
+// that, and in the trail it stands for the way down of a rewind, which
+// could show anything.
+// ====================================================================
+class NavTrail
+{
+public:
+   NavTrail(int page, int unknown);
+   virtual ~NavTrail();
+
+   // The buses, in the order of the ids the other calls use
+   int AddBus(const char *name);
+   const oscpkt::Message & GetSelect(int bus);
+
+   int GetBus();                 // -1 when unknown
+   void SetBus(int bus);
+
+   int GetPosition(int bus);
+   void SetPosition(int bus, int position);
+
+   // Our navigation went through position on bus
+   void Visit(int bus, int position);
+
+   // A bus selection echoed.  True when it is the selected bus or one
+   // our navigations went through, otherwise the selection is forgotten.
+   bool OnBus(int bus);
+
+   // Index of the oldest visited position match(bus, position) accepts,
+   // -1 when none does
+   template <typename Match>
+   int Find(Match match)
+   {
+      for (size_t i = 0; i < mVisited.size(); i++)
+      {
+         if (match(mVisited[i].first, mVisited[i].second))
+         {
+            return (int) i;
+         }
+      }
+
+      return -1;
+   }
+
+   int GetVisited(int i);
+
+   // Echoes come in the order we moved, so whatever was visited before
+   // position i has been seen (or never will be)
+   void Reached(int i);
+
+   bool IsEmpty();
+
+   // Drop the visited positions, or everything
+   void Forget();
+   void Invalidate();
+
+private:
+   struct Bus
+   {
+      std::string name;
+      oscpkt::Message select;
+      int position;
+   };
+
+private:
+   int mPage;
+   int mUnknown;
+   std::vector<Bus> mBuses;
+   int mBus;
+   std::vector< std::pair<int, int> > mVisited;
+};
+
+#endif
@@ -35,7 +35,6 @@
 #include <wx/process.h>
 #include <wx/radiobut.h>
 #include <wx/sizer.h>
-#include <wx/socket.h>
 #include <wx/statbox.h>
 #include <wx/stattext.h>
 #include <wx/statusbr.h>
@@ -63,6 +62,57 @@
 
 #define TITLE "TUBA" 
 
+// ====================================================================
+// Where each control lives on the mixer, in CTRL_* order.  Page 1 only
+// has the strip parameters (volume, pan, mute, solo), addressed by strip
+// number without any navigation; everything else goes through page 2.
+// ====================================================================
+static const struct
+{
+   int page;
+   int bus;
+   const char *name;
+   const char *param;
+} Controls[CTRL_COUNT] =
+{
+   { 1, BUS_OUTPUT, "Speaker B",  "volume" },
+   { 1, BUS_OUTPUT, "Main",       "volume" },
+   { 1, BUS_INPUT,  "Mic 1",      "volume" },
+   { 2, BUS_INPUT,  "Mic 1",      "gain" },
+   { 1, BUS_INPUT,  "Mic 2",      "volume" },
+   { 2, BUS_INPUT,  "Mic 2",      "gain" },
+   { 1, BUS_INPUT,  "SPDIF",      "volume" },
+   { 2, BUS_OUTPUT, "Main",       "eqGain1" },
+   { 2, BUS_OUTPUT, "Speaker B",  "eqGain1" },
+   { 2, BUS_OUTPUT, "Main",       "eqGain2" },
+   { 2, BUS_OUTPUT, "Speaker B",  "eqGain2" },
+   { 2, BUS_OUTPUT, "Main",       "eqGain3" },
+   { 2, BUS_OUTPUT, "Speaker B",  "eqGain3" },
+   { 2, BUS_OUTPUT, "Main",       "eqEnable" },
+   { 2, BUS_OUTPUT, "Speaker B",  "eqEnable" },
+
+   { 2, BUS_INPUT,  "Mic 1",      "" },
+   { 2, BUS_INPUT,  "SPDIF",      "" },
+   { 2, BUS_OUTPUT, "Main",       "" },
+   { 2, BUS_OUTPUT, "Speaker B",  "" },
+};
+
+// ====================================================================
+// The controls read back from the mixer, to show what it has
+// ====================================================================
+static const int Refreshed[] =
+{
+   CTRL_MIC1VOL,
+   CTRL_MIC1GAIN,
+   CTRL_MIDI,
+   CTRL_MAIN,
+   CTRL_BASS_MAIN,
+   CTRL_MID_MAIN,
+   CTRL_TREBLE_MAIN,
+   CTRL_PHONES,
+   CTRL_EQ_MAIN,
+};
+
 // ====================================================================
 // We are an application (no, really, we are.)
 // ====================================================================
@@ -123,8 +173,7 @@ BEGIN_EVENT_TABLE(MyFrame, wxFrame)
    EVT_SLIDER(ID_MID, MyFrame::OnMid)
    EVT_SLIDER(ID_TREBLE, MyFrame::OnTreble)
    EVT_CHECKBOX(ID_EQ, MyFrame::OnEq)
-   EVT_SOCKET(wxID_ANY, MyFrame::OnSocket)
-   EVT_TIMER(wxID_ANY, MyFrame::OnTimer)
+   EVT_TIMER(ID_FRAME, MyFrame::OnFrame)
 END_EVENT_TABLE()
 
 // ====================================================================
@@ -356,34 +405,40 @@ MyFrame::MyFrame()
 
    mMain->SetFocus();
 
-   mIp = wxIPV4address();
-   mIp.LocalHost();
-   mIp.Service(9001);
-
-   mSock = new wxDatagramSocket(mIp, wxSOCKET_REUSEADDR);
-   mSock->SetNotify(wxSOCKET_INPUT_FLAG | wxSOCKET_OUTPUT_FLAG);
-   mSock->SetEventHandler(*this);
-   mSock->Notify(true);
+   // The controls, in CTRL_* order
+   for (int i = 0; i < CTRL_COUNT; i++)
+   {
+      mMixer.AddControl(Controls[i].page, Controls[i].bus, Controls[i].name, Controls[i].param);
+   }
+   for (size_t i = 0; i < WXSIZEOF(Refreshed); i++)
+   {
+      mMixer.Watch(Refreshed[i]);
+   }
+   mMixer.SetListener([this](int ctrl, float value) { OnControl(ctrl, value); });
 
-   mIp.Service(7001);
+   // Requests that wait for their echo, this many at a time (1 is
+   // strictly one after the other)
+   mMixer.SetRequestWindow(m_Config->ReadLong(wxT("RequestWindow"), 4));
 
-   mInput.SetName(wxT("Input"));
-   mOutput.SetName(wxT("Output"));
-   mPlayback.SetName(wxT("Playback"));
+   // Each channel is read once per idle interval, or shortly after we
+   // changed it, and any echo of it in between will do instead
+   mMixer.SetRefreshIntervals(m_Config->ReadLong(wxT("RefreshIdle"), 2000),
+                              m_Config->ReadLong(wxT("RefreshSettle"), 250),
+                              m_Config->ReadLong(wxT("RefreshGap"), 50));
 
-   mTimer.SetOwner(this);
+   // Slider values go out at most this many per second, the ones in
+   // between are overwritten while they wait
+   mMixer.SetSendRate(m_Config->ReadDouble(wxT("SendRate"), 100.0), m_Config->ReadLong(wxT("SendBurst"), 4));
 
+   // Shown once the channel names have been read
    mInitializing = true;
-   SendOSCSet(wxT("/1/busPlayback"));
-   SendOSCSet(wxT("/1/busInput"));
-   SendOSCSet(wxT("/1/busOutput"));
-   SendOSCSet(wxT("/1/busPlayback"));
+   if (!mMixer.Start(9001, "127.0.0.1", 7001))
+   {
+      wxLogError(wxT("Unable to open the OSC port: %s"), wxString(mMixer.GetError()));
+   }
 
-   SendOSCSetChannel(wxT("2"), wxT("Input"), wxT("Mic 1"));
-   SendOSCSetChannel(wxT("2"), wxT("Input"), wxT("SPDIF"));
-   SendOSCSetChannel(wxT("2"), wxT("Output"), wxT("Main"));
-   SendOSCSetChannel(wxT("2"), wxT("Output"), wxT("Speaker B"));
-//   SendOSCSetChannel(wxT("2"), wxT("Output"), wxT("AN 3/4"));
+   mFrameTimer.SetOwner(this, ID_FRAME);
+   mFrameTimer.Start(16);
 
    return;
 }
@@ -393,10 +448,9 @@ MyFrame::MyFrame()
 // ====================================================================
 void MyFrame::OnClose(wxCloseEvent& event)
 {
-   mTimer.Stop();
+   mFrameTimer.Stop();
 
-   mSock->Close();
-   mSock->Destroy();
+   mMixer.Stop();
 
    // Destroy dialog
    Destroy();
@@ -407,146 +461,34 @@ void MyFrame::OnClose(wxCloseEvent& event)
 // ====================================================================
 // 
 // ====================================================================
-void MyFrame::OnSocket(wxSocketEvent& event)
+void MyFrame::OnFrame(wxTimerEvent& event)
 {
-   wxDatagramSocket *sock = wxDynamicCast(event.GetSocket(), wxDatagramSocket);
-   wxIPV4address ip = wxIPV4address();
-   char buf[4096];
-   ip.Hostname(wxT("127.0.0.1"));
-   ip.Service(9001);
-
-   while (sock->IsData())
-   {
-      sock->RecvFrom(ip, buf, sizeof(buf));
-      int len = sock->LastCount();
-      oscpkt::PacketReader pr(buf, len);
-      oscpkt::Message *msg;
-
-      while (pr.isOk() && (msg = pr.popMessage()) != 0)
-      {
-         wxString pat(msg->addressPattern());
-         float val;
-         msg->arg().popFloat(val);
-         log("pat = %s, val %f", pat, val);
-         log("active %s\n", mActive);
-         if (msg->match("/*/bus*") && val == 1.0f)
-         {
-            mActive = pat;
-         }
-         else if (msg->match("/1/trackname*"))
-         {
-            Channels *chans;
-            if (mActive.IsSameAs(wxT("/1/busInput")))
-            {
-               chans = &mInput;
-            }
-            else if (mActive.IsSameAs(wxT("/1/busOutput")))
-            {
-               chans = &mOutput;
-            }
-            else if (mActive.IsSameAs(wxT("/1/busPlayback")))
-            {
-               chans = &mPlayback;
-            }
-            std::string s;
-            msg->arg().popStr(s);
-            log("name %s", wxString(s));
-            chans->SetChannelName(wxAtoi(pat.Right(1)), s.c_str());
-         }
-         else if (msg->match("/2/{volume,pan,mute,solo,gain,eqEnable,eqGain1,eqGain2,eqGain3}"))
-         {
-            mValues[pat] = val;
-         }
-         else if (msg->match("/2/trackname") && mQueued)
-         {
-            std::string str;
-            msg->arg().popStr(str);
-            log("str = %s, %f", wxString(str), mValues[ wxT("/2/volume") ]);
-            if (str == "Mic 1")
-            {
-               mMic1Vol->SetValue((int)((mValues[wxT("/2/volume")] + 0.0005f) * 1000));
-               mMic1Gain->SetValue((int)((mValues[wxT("/2/gain")] + 0.0005f) * 1000));
-            }
-            else if (str == "SPDIF")
-            {
-               mMidi->SetValue((int)((mValues[wxT("/2/volume")] + 0.0005f) * 1000));
-            }
-            else if (str == "Main")
-            {
-               mMain->SetValue((int)((mValues[wxT("/2/volume")] + 0.0005f) * 1000));
-               mBass->SetValue((int)((mValues[wxT("/2/eqGain1")] + 0.0005f) * 1000));
-               mMid->SetValue((int)((mValues[wxT("/2/eqGain2")] + 0.0005f) * 1000));
-               mTreble->SetValue((int)((mValues[wxT("/2/eqGain3")] + 0.0005f) * 1000));
-               mEq->SetValue(mValues[wxT("/2/eqEnable")] != 0.0f);
-            }
-            else if (str == "Speaker B")
-            {
-               mPhones->SetValue((int)((mValues[wxT("/2/volume")] + 0.0005f) * 1000));
-            }
-         }
-#if 0
-         if ( ! msg->match( "/" ) )
-         {
-            wxString os;
-            os << wxT("osc_address: '") << msg->addressPattern() << wxT("', types: '") << msg->typeTags() << wxT("', timetag=") << msg->timeTag() << wxT(", args=[");
-            oscpkt::Message::ArgReader arg(*msg);
-            while (arg.nbArgRemaining() && arg.isOk())
-            {
-               if (arg.isBool()) { bool b; arg.popBool(b); os << (b?"True":"False"); }
-               else if (arg.isInt32()) { wxInt32 i; arg.popInt32(i); os << i; }
-               else if (arg.isInt64()) { wxInt64 h; arg.popInt64(h); os << h << "ll"; }
-               else if (arg.isFloat()) { float f; arg.popFloat(f); os << f << "f"; }
-               else if (arg.isDouble()) { double d; arg.popDouble(d); os << d; }
-               else if (arg.isStr()) { std::string s; arg.popStr(s); os += "'" + s + "'"; }
-               else if (arg.isBlob()) { std::vector<char> b; arg.popBlob(b); os << "Blob " << b.size() << " bytes"; }
-               else assert(0); // I forgot a case..
-               if (arg.nbArgRemaining()) os << ", ";
-            }
-            os += wxT("]");
-            log( "%s", os );
-         }
-#endif
-      }
-   }
+   // Nothing gets read back while a slider is being dragged
+   mMixer.Frame(wxWindow::GetCapture() != NULL);
 
-   if (mQueued)
+   if (mInitializing && mMixer.IsReady())
    {
-      if (!mQueue.empty())
-      {
-         oscpkt::PacketWriter *pw = mQueue.front();
-         mSock->SendTo(mIp, pw->packetData(), pw->packetSize());
-         delete pw;
-         mQueue.pop();
-      }
-      else
-      {
-         if (mInitializing)
-         {
-            mInitializing = false;
-            mTimer.Start(50);
-            Update();
-            Show();
-         }
-         mQueued = false;
-      }
+      mInitializing = false;
+      Update();
+      Show();
    }
 
    return;
 }
 
 // ====================================================================
-// 
+// The mixer has something new for a control
 // ====================================================================
-
-void MyFrame::OnTimer(wxTimerEvent& event)
+void MyFrame::OnControl(int ctrl, float value)
 {
-   if (wxWindow::GetCapture() == NULL)
+   wxSlider *slider = GetSlider(ctrl);
+   if (slider != NULL)
+   {
+      slider->SetValue((int)((value + 0.0005f) * 1000));
+   }
+   else if (ctrl == CTRL_EQ_MAIN)
    {
-      SendOSCSetChannel(wxT("2"), wxT("Input"), wxT("Mic 1"));
-      SendOSCSetChannel(wxT("2"), wxT("Input"), wxT("SPDIF"));
-      SendOSCSetChannel(wxT("2"), wxT("Output"), wxT("Main"));
-      SendOSCSetChannel(wxT("2"), wxT("Output"), wxT("Speaker B"));
-//      SendOSCSetChannel(wxT("2"), wxT("Output"), wxT("AN 3/4"));
+      mEq->SetValue(value != 0.0f);
    }
 }
 
@@ -555,7 +497,7 @@ void MyFrame::OnTimer(wxTimerEvent& event)
 // ====================================================================
 void MyFrame::OnPhones(wxCommandEvent& event)
 {
-   SendOSCFader(2, BUS_OUTPUT, wxT("Speaker B"), wxT("volume"), mPhones->GetValue());
+   SendOSCFader(CTRL_PHONES, mPhones->GetValue());
 }
 
 // ====================================================================
@@ -563,7 +505,7 @@ void MyFrame::OnPhones(wxCommandEvent& event)
 // ====================================================================
 void MyFrame::OnMain(wxCommandEvent& event)
 {
-   SendOSCFader(2, BUS_OUTPUT, wxT("Main"), wxT("volume"), mMain->GetValue());
+   SendOSCFader(CTRL_MAIN, mMain->GetValue());
 }
 
 // ====================================================================
@@ -571,7 +513,7 @@ void MyFrame::OnMain(wxCommandEvent& event)
 // ====================================================================
 void MyFrame::OnMic1Vol(wxCommandEvent& event)
 {
-   SendOSCFader(2, BUS_INPUT, wxT("Mic 1"), wxT("volume"), mMic1Vol->GetValue());
+   SendOSCFader(CTRL_MIC1VOL, mMic1Vol->GetValue());
 }
 
 // ====================================================================
@@ -579,7 +521,7 @@ void MyFrame::OnMic1Vol(wxCommandEvent& event)
 // ====================================================================
 void MyFrame::OnMic1Gain(wxCommandEvent& event)
 {
-   SendOSCFader(2, BUS_INPUT, wxT("Mic 1"), wxT("gain"), mMic1Gain->GetValue());
+   SendOSCFader(CTRL_MIC1GAIN, mMic1Gain->GetValue());
 }
 
 // ====================================================================
@@ -587,7 +529,7 @@ void MyFrame::OnMic1Gain(wxCommandEvent& event)
 // ====================================================================
 void MyFrame::OnMic2Vol(wxCommandEvent& event)
 {
-   SendOSCFader(2, BUS_INPUT, wxT("Mic 2"), wxT("volume"), mMic2Vol->GetValue());
+   SendOSCFader(CTRL_MIC2VOL, mMic2Vol->GetValue());
 }
 
 // ====================================================================
@@ -595,7 +537,7 @@ void MyFrame::OnMic2Vol(wxCommandEvent& event)
 // ====================================================================
 void MyFrame::OnMic2Gain(wxCommandEvent& event)
 {
-   SendOSCFader(2, BUS_INPUT, wxT("Mic 2"), wxT("gain"), mMic2Gain->GetValue());
+   SendOSCFader(CTRL_MIC2GAIN, mMic2Gain->GetValue());
 }
 
 // ====================================================================
@@ -603,7 +545,7 @@ void MyFrame::OnMic2Gain(wxCommandEvent& event)
 // ====================================================================
 void MyFrame::OnMidi(wxCommandEvent& event)
 {
-   SendOSCFader(2, BUS_INPUT, wxT("SPDIF"), wxT("volume"), mMidi->GetValue());
+   SendOSCFader(CTRL_MIDI, mMidi->GetValue());
 }
 
 // ====================================================================
@@ -611,8 +553,8 @@ void MyFrame::OnMidi(wxCommandEvent& event)
 // ====================================================================
 void MyFrame::OnBass(wxCommandEvent& event)
 {
-   SendOSCFader(2, BUS_OUTPUT, wxT("Main"), wxT("eqGain1"), mBass->GetValue());
-   SendOSCFader(2, BUS_OUTPUT, wxT("Speaker B"), wxT("eqGain1"), mBass->GetValue());
+   SendOSCFader(CTRL_BASS_MAIN, mBass->GetValue());
+   SendOSCFader(CTRL_BASS_SPEAKERB, mBass->GetValue());
 }
 
 // ====================================================================
@@ -620,8 +562,8 @@ void MyFrame::OnBass(wxCommandEvent& event)
 // ====================================================================
 void MyFrame::OnMid(wxCommandEvent& event)
 {
-   SendOSCFader(2, BUS_OUTPUT, wxT("Main"), wxT("eqGain2"), mMid->GetValue());
-   SendOSCFader(2, BUS_OUTPUT, wxT("Speaker B"), wxT("eqGain2"), mMid->GetValue());
+   SendOSCFader(CTRL_MID_MAIN, mMid->GetValue());
+   SendOSCFader(CTRL_MID_SPEAKERB, mMid->GetValue());
 }
 
 // ====================================================================
@@ -629,8 +571,8 @@ void MyFrame::OnMid(wxCommandEvent& event)
 // ====================================================================
 void MyFrame::OnTreble(wxCommandEvent& event)
 {
-   SendOSCFader(2, BUS_OUTPUT, wxT("Main"), wxT("eqGain3"), mTreble->GetValue());
-   SendOSCFader(2, BUS_OUTPUT, wxT("Speaker B"), wxT("eqGain3"), mTreble->GetValue());
+   SendOSCFader(CTRL_TREBLE_MAIN, mTreble->GetValue());
+   SendOSCFader(CTRL_TREBLE_SPEAKERB, mTreble->GetValue());
 }
 
 // ====================================================================
@@ -638,214 +580,65 @@ void MyFrame::OnTreble(wxCommandEvent& event)
 // ====================================================================
 void MyFrame::OnEq(wxCommandEvent& event)
 {
-   SendOSCToggle(2, BUS_OUTPUT, wxT("Main"), wxT("eqEnable"));
-   SendOSCToggle(2, BUS_OUTPUT, wxT("Speaker B"), wxT("eqEnable"));
+   SendOSCToggle(CTRL_EQ_MAIN);
+   SendOSCToggle(CTRL_EQ_SPEAKERB);
 }
 
 //#define ToStdString() c_str()
 // ====================================================================
-// 
-// ====================================================================
-void MyFrame::SendOSCSetChannel(const wxString & page, const wxString & bus, const wxString & name)
-{
-   Channels *chans;
-   if (bus.IsSameAs(wxT("Input")))
-   {
-      chans = &mInput;
-   }
-   else if (bus.IsSameAs(wxT("Output")))
-   {
-      chans = &mOutput;
-   }
-   else if (bus.IsSameAs(wxT("Playback")))
-   {
-      chans = &mPlayback;
-   }
-
-   oscpkt::PacketWriter *pw = new oscpkt::PacketWriter();
-   oscpkt::Message msg;
-
-   pw->startBundle();
-   msg.init(wxString::Format(wxT("/%s/bus%s"), page, bus).ToStdString()).pushFloat(1.0f);
-   pw->addMessage(msg);
-
-   int cnt = chans->GetCount();
-   for (int i = 0; i < cnt; i++)
-   {
-      msg.init("/2/track-").pushFloat(1.0f);
-      pw->addMessage(msg);
-   }
-
-   int id = chans->GetChannelID(name);
-//   log(wxT("name = %s, id = %d"), name.c_str(), id );
-   for (int i = 1; i < id; i++)
-   {
-      msg.init("/2/track+").pushFloat(1.0f);
-      pw->addMessage(msg);
-   }
-   pw->endBundle();
-
-   if (mQueued)
-   {
-      mQueue.push(pw);
-   }
-   else
-   {
-      mSock->SendTo(mIp, pw->packetData(), pw->packetSize());
-      delete pw;
-      mQueued = true;
-   }
-}
-
-// ====================================================================
-// 
+// The slider showing a control, NULL when it has none
 // ====================================================================
-void MyFrame::SendOSCFader(int page, int bus, const wxString & name, const wxString & pattern, int value)
+wxSlider *MyFrame::GetSlider(int ctrl)
 {
-   Channels *chans;
-   switch (bus)
+   switch (ctrl)
    {
-   case BUS_INPUT:
-      chans = &mInput;
-      break;
+   case CTRL_PHONES:
+      return mPhones;
 
-   case BUS_OUTPUT:
-      chans = &mOutput;
-      break;
+   case CTRL_MAIN:
+      return mMain;
 
-   case BUS_PLAYBACK:
-      chans = &mPlayback;
-      break;
-   }
+   case CTRL_MIC1VOL:
+      return mMic1Vol;
 
-   oscpkt::PacketWriter pw;
-   oscpkt::Message msg;
+   case CTRL_MIC1GAIN:
+      return mMic1Gain;
 
-   pw.startBundle();
-   msg.init(wxString::Format(wxT("/%d/bus%s"), page, chans->GetName()).ToStdString()).pushFloat(1.0f);
-   pw.addMessage(msg);
+   case CTRL_MIC2VOL:
+      return mMic2Vol;
 
-   int cnt = chans->GetCount();
-   for (int i = 0; i < cnt; i++)
-   {
-      msg.init(wxString::Format(wxT("/%d/track-"), page).ToStdString()).pushFloat(1.0f);
-      pw.addMessage(msg);
-   }
+   case CTRL_MIC2GAIN:
+      return mMic2Gain;
 
-   int id = chans->GetChannelID(name);
-//   log(wxT("name = %s, id = %d"), name.c_str(), id);
-   for (int i = 1; i < id; i++)
-   {
-      msg.init(wxString::Format(wxT("/%d/track+"), page).ToStdString()).pushFloat(1.0f);
-      pw.addMessage(msg);
-   }
+   case CTRL_MIDI:
+      return mMidi;
 
-   msg.init(wxString::Format(wxT("/%d/%s"), page, pattern).ToStdString()).pushFloat(((float)value) / 1000.0f + 0.0005f);
-   pw.addMessage(msg);
-   pw.endBundle();
+   case CTRL_BASS_MAIN:
+      return mBass;
 
-   mSock->SendTo(mIp, pw.packetData(), pw.packetSize());
-}
+   case CTRL_MID_MAIN:
+      return mMid;
 
-// ====================================================================
-// 
-// ====================================================================
-void MyFrame::SendOSCSet(const wxString & pattern)
-{
-   SendOSCMessage(pattern, 1.0);
-}
-
-// ====================================================================
-// 
-// ====================================================================
-void MyFrame::SendOSCToggle(int page, int bus, const wxString & name, const wxString & pattern)
-{
-   Channels *chans;
-   switch (bus)
-   {
-   case BUS_INPUT:
-      chans = &mInput;
-      break;
-
-   case BUS_OUTPUT:
-      chans = &mOutput;
-      break;
-
-   case BUS_PLAYBACK:
-      chans = &mPlayback;
-      break;
+   case CTRL_TREBLE_MAIN:
+      return mTreble;
    }
 
-   oscpkt::PacketWriter pw;
-   oscpkt::Message msg;
-
-   pw.startBundle();
-   msg.init(wxString::Format(wxT("/%d/bus%s"), page, chans->GetName()).ToStdString()).pushFloat(1.0f);
-   pw.addMessage(msg);
-
-   int cnt = chans->GetCount();
-   for (int i = 0; i < cnt; i++)
-   {
-      msg.init(wxString::Format(wxT("/%d/track-"), page).ToStdString()).pushFloat(1.0f);
-      pw.addMessage(msg);
-   }
-
-   int id = chans->GetChannelID(name);
-   for (int i = 1; i < id; i++)
-   {
-      msg.init(wxString::Format(wxT("/%d/track+"), page).ToStdString()).pushFloat(1.0f);
-      pw.addMessage(msg);
-   }
-
-   msg.init(wxString::Format(wxT("/%d/%s"), page, pattern).ToStdString()).pushFloat(1.0f);
-   pw.addMessage(msg);
-   pw.endBundle();
-
-   mSock->SendTo(mIp, pw.packetData(), pw.packetSize());
-}
-
-// ====================================================================
-// 
-// ====================================================================
-void MyFrame::SendOSCString(const wxString & pattern, const wxString & value)
-{
-   SendOSCMessage(pattern, value);
+   return NULL;
 }
 
 // ====================================================================
-// 
+// Sent from the next frame, only the last value if the slider moved
+// again in between
 // ====================================================================
-void MyFrame::SendOSCMessage(const wxString & pattern, const wxString & value)
-{
-   oscpkt::Message *msg = new oscpkt::Message(pattern.ToStdString());
-   msg->pushStr(value.ToStdString());
-   QueueMessage(msg);
-}
-
-void MyFrame::QueueMessage(oscpkt::Message *msg)
+void MyFrame::SendOSCFader(int ctrl, int value)
 {
-   oscpkt::PacketWriter *pw = new oscpkt::PacketWriter();
-   pw->addMessage(*msg);
-   delete msg;
-
-   if (mQueued)
-   {
-      mQueue.push(pw);
-   }
-   else
-   {
-      mSock->SendTo(mIp, pw->packetData(), pw->packetSize());
-      delete pw;
-      mQueued = true;
-   }
+   mMixer.SendFader(ctrl, ((float)value) / 1000.0f + 0.0005f);
 }
 
 // ====================================================================
 // 
 // ====================================================================
-void MyFrame::SendOSCMessage(const wxString & pattern, float value)
+void MyFrame::SendOSCToggle(int ctrl)
 {
-   oscpkt::Message *msg = new oscpkt::Message(pattern.ToStdString());
-   msg->pushFloat(value);
-   QueueMessage(msg);
+   mMixer.SendToggle(ctrl);
 }
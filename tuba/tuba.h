@@ -11,9 +11,6 @@
 ||
 ====================================================================*/
 
-#include <map>
-#include <queue>
-
 #include <wx/defs.h>
 
 #include <wx/bmpbuttn.h>
@@ -21,17 +18,36 @@
 #include <wx/panel.h>
 #include <wx/sizer.h>
 #include <wx/slider.h>
-#include <wx/socket.h>
 #include <wx/timer.h>
 
-#include "udp.h"
-#include "channel.h"
+#include "mixer.h"
 
+// Every mixer control we drive, in the order they are added to the Mixer
 enum
 {
-   BUS_INPUT,
-   BUS_OUTPUT,
-   BUS_PLAYBACK
+   CTRL_PHONES,
+   CTRL_MAIN,
+   CTRL_MIC1VOL,
+   CTRL_MIC1GAIN,
+   CTRL_MIC2VOL,
+   CTRL_MIC2GAIN,
+   CTRL_MIDI,
+   CTRL_BASS_MAIN,
+   CTRL_BASS_SPEAKERB,
+   CTRL_MID_MAIN,
+   CTRL_MID_SPEAKERB,
+   CTRL_TREBLE_MAIN,
+   CTRL_TREBLE_SPEAKERB,
+   CTRL_EQ_MAIN,
+   CTRL_EQ_SPEAKERB,
+
+   // Channel selections only, what the refresh queries navigate with
+   CTRL_SELECT_MIC1,
+   CTRL_SELECT_SPDIF,
+   CTRL_SELECT_MAIN,
+   CTRL_SELECT_SPEAKERB,
+
+   CTRL_COUNT
 };
 
 // ====================================================================
@@ -65,7 +81,7 @@ private:
 
    void OnClose(wxCloseEvent& event);
 
-   void OnSocket(wxSocketEvent& event);
+   void OnFrame(wxTimerEvent& event);
 
    void OnPhones(wxCommandEvent& event);
    void OnMain(wxCommandEvent& event);
@@ -80,33 +96,19 @@ private:
    void OnTreble(wxCommandEvent& event);
    void OnEq(wxCommandEvent& event);
 
-   void OnTimer(wxTimerEvent& event);
+   void OnControl(int ctrl, float value);
 
-   void SendOSCMessage(const wxString & pattern, float value);
-   void SendOSCMessage(const wxString & pattern, const wxString & value);
-   void SendOSCFader(int page, int bus, const wxString & name, const wxString & pattern, int value);
-   void SendOSCSet(const wxString & pattern);
-   void SendOSCToggle(int page, int bus, const wxString & name, const wxString & pattern);
-   void SendOSCString(const wxString & pattern, const wxString & value);
-   void SendOSCSetChannel(const wxString & page, const wxString & bus, const wxString & channel);
-   void QueueMessage(oscpkt::Message *msg);
+   void SendOSCFader(int ctrl, int value);
+   void SendOSCToggle(int ctrl);
+   wxSlider *GetSlider(int ctrl);
 
 private:
    bool mInitializing;
    bool mIsOutputSelected;
    bool mIsMainSelected;
-   wxIPV4address mIp;
-   wxDatagramSocket *mSock;
-   wxTimer mTimer;
-   wxString mActive;
-
-   Channels mInput;
-   Channels mOutput;
-   Channels mPlayback;
+   wxTimer mFrameTimer;
 
-   std::map< wxString, float > mValues;
-   std::queue< oscpkt::PacketWriter * > mQueue;
-   bool mQueued;
+   Mixer mMixer;
 
    wxSlider        *mPhones;
    wxSlider        *mMain;
@@ -160,5 +162,7 @@ enum
    ID_LIST,
 
    ID_ENTER,
-   ID_CTRL_A
+   ID_CTRL_A,
+
+   ID_FRAME
 };
@@ -42,6 +42,18 @@
 # include <sys/socket.h>
 # include <netdb.h>
 # include <sys/time.h>
+# include <unistd.h>
+#endif
+#if defined(__linux__)
+# define OSCPKT_HAVE_MMSG 1 /* recvmmsg / sendmmsg */
+# if defined(__has_include)
+#  if __has_include(<linux/io_uring.h>)
+#   include <linux/io_uring.h>
+#   if defined(IORING_RECV_MULTISHOT)
+#    define OSCPKT_HAVE_IO_URING 1 /* see UdpSocket::useIoUring */
+#   endif
+#  endif
+# endif
 #endif
 #include <cstring>
 #include <cstdio>
@@ -50,6 +62,7 @@
 #include <cassert>
 #include <string>
 #include <vector>
+#include <algorithm>
 
 namespace oscpkt {
 
@@ -106,6 +119,28 @@ public:
 };
 
 
+/** one datagram of a batch, see UdpSocket::receiveBatch and UdpSocket::sendBatch.
+    The buffer belongs to the caller, so a set of slots can be reused for
+    every batch without allocating. */
+struct PacketSlot {
+  char *data;       /* the datagram bytes */
+  size_t capacity;  /* size of the data buffer, only used when receiving */
+  size_t size;      /* number of bytes received, or to send */
+  bool truncated;   /* the datagram was larger than the buffer, the end was lost */
+  SockAddr addr;    /* origin of a received datagram, destination of a sent one (remote_addr when empty) */
+
+  PacketSlot() : data(0), capacity(0), size(0), truncated(false) {}
+  PacketSlot(char *buf, size_t cap) : data(buf), capacity(cap), size(0), truncated(false) {}
+};
+
+} // namespace oscpkt
+
+#ifdef OSCPKT_HAVE_IO_URING
+# include "uring.h"
+#endif
+
+namespace oscpkt {
+
 /** 
     just a wrapper over the classical socket stuff
 
@@ -122,10 +157,20 @@ struct UdpSocket {
   SockAddr local_addr   /* initialised only for bound sockets */;
   SockAddr remote_addr; /* initialised for connected sockets. Also updated for bound sockets after each datagram received */
 
-  std::vector<char> buffer;
+  /* receive slots for receiveNextPacket, used round robin */
+  std::vector<char> ring;
+  size_t ring_slots, ring_slot_size, ring_next;
+  PacketSlot last; /* the packet returned by the last receiveNextPacket, points into ring */
+
+#ifdef OSCPKT_HAVE_IO_URING
+  UringIo *uring; /* set by useIoUring */
+#endif
 
 
-  UdpSocket() : handle(-1) { 
+  UdpSocket() : handle(-1), ring_slots(4), ring_slot_size(65536), ring_next(0) { 
+#ifdef OSCPKT_HAVE_IO_URING
+    uring = 0;
+#endif
 #ifdef WIN32
     WSADATA wsa_data;
     if (WSAStartup(MAKEWORD(2,2), &wsa_data) != 0) {
@@ -142,6 +187,9 @@ struct UdpSocket {
   }
 
   void close() {
+#ifdef OSCPKT_HAVE_IO_URING
+    delete uring; uring = 0;
+#endif
     if (handle != -1) { 
 #ifdef WIN32
       ::closesocket(handle);
@@ -167,6 +215,37 @@ struct UdpSocket {
     return s;
   }
   int  socketHandle() const { return handle; }
+  /** what to wait on for incoming data: the socket, or the io_uring when it is used */
+  int  pollHandle() const {
+#ifdef OSCPKT_HAVE_IO_URING
+    if (uring) return uring->handle();
+#endif
+    return handle;
+  }
+
+  /** switch a bound socket to io_uring (linux): receiving and sending
+      then need almost no system calls under load. nbufs buffers of
+      buf_size bytes are dedicated to reception, larger datagrams are
+      truncated. Returns false, and keeps the regular path, when
+      io_uring is not available. */
+  bool useIoUring(unsigned nbufs = 256, unsigned buf_size = 4096) {
+#ifdef OSCPKT_HAVE_IO_URING
+    if (!isOk() || handle == -1) return false;
+    if (!uring) uring = new UringIo();
+    if (uring->open(handle, nbufs, buf_size)) return true;
+    delete uring; uring = 0;
+#else
+    (void)nbufs; (void)buf_size;
+#endif
+    return false;
+  }
+  bool usingIoUring() const {
+#ifdef OSCPKT_HAVE_IO_URING
+    return uring != 0;
+#else
+    return false;
+#endif
+  }
   std::string localHostName() const { 
     /* this stuff is not very nice but this is what liblo does in order to
        find out a sensible name for the local host */
@@ -208,66 +287,103 @@ struct UdpSocket {
       false in case of failure, or timeout. When the timeout_ms is set
       to -1, it will wait forever.
       
-      The datagram is available with the getDatagramData() / getDatagramSize() functions,
-      the sender address can be retrieved with getDatagramOrigin().
+      The datagram is available with the packetData() / packetSize() functions,
+      the sender address can be retrieved with packetOrigin().
   */
   bool receiveNextPacket(int timeout_ms = -1) {
     if (!isOk() || handle == -1) { setErr("not opened.."); return false; }
-    /* 128k seems to be a reasonable value -- on linux, the max
-       datagram size appears to be a little bit less than 65536 */
-    buffer.resize(1024*128); 
-    
-    /* check if something is available */
-    if (timeout_ms >= 0) {
-      struct timeval tv; memset(&tv, 0, sizeof tv);
-      tv.tv_sec=timeout_ms/1000;
-      tv.tv_usec=(timeout_ms%1000) * 1000;
-      
-      //gettimeofday(&tv, 0); //tv.tv_usec += timeout_ms*1000;
-
-      fd_set readset;
-      FD_ZERO(&readset);
-      FD_SET(handle, &readset);
-      //int ret = select( handle+1, &readset, 0, 0, &tv );
-      int ret = select( handle+1, &readset, 0, 0, &tv );
-      if (ret <= 0) { // error, or timeout
-        return false;
-      }
-    }
+    /* the slots are allocated once, after that receiving does not touch the heap */
+    if (ring.empty()) ring.resize(ring_slots * ring_slot_size);
 
-    /* now we should be able to read without blocking.. */
-    socklen_t len = remote_addr.maxLen();
-    int nread = (int)recvfrom(handle, &buffer[0], buffer.size(), 0,
-                              &remote_addr.addr(), &len);
-    if (nread < 0) {       
-      // maybe here we should differentiate EAGAIN/EINTR/EWOULDBLOCK from real errors
-#ifdef WIN32
-      if (WSAGetLastError() != WSAEINTR && WSAGetLastError() != WSAEWOULDBLOCK && 
-          WSAGetLastError() != WSAECONNRESET && WSAGetLastError() != WSAECONNREFUSED) {
-        char s[512]; _snprintf_s(s,512,512, "system error #%d", WSAGetLastError());
-        setErr(s);
-      }
-#else
-      if (errno != EAGAIN && errno != EINTR && errno != EWOULDBLOCK &&
-          errno != ECONNRESET && errno != ECONNREFUSED) {
-        setErr(strerror(errno));
-      }
-#endif
-      if (!isOk()) close();
+    PacketSlot slot(&ring[ring_next * ring_slot_size], ring_slot_size);
+    if (receiveBatch(&slot, 1, timeout_ms) == 0) {
       return false;
     }
-    if (nread > (int)buffer.size()) {
-      /* no luck... a large datagram arrived and we truncated it.. now it is too late */
-      buffer.clear();
-    } else {
-      buffer.resize(nread);
-      std::vector<char> tmp(buffer); tmp.swap(buffer);
+    ring_next = (ring_next + 1) % ring_slots;
+    last = slot;
+    if (last.truncated) {
+      /* no luck... a datagram larger than a slot arrived, its end is lost */
+      last.size = 0;
     }
     return true;
   }
 
-  void *packetData() { return buffer.empty() ? 0 : &buffer[0]; }
-  size_t packetSize() { return buffer.size(); }
+  /** set the number and the size of the receive slots. The packet returned
+      by receiveNextPacket stays valid for the next (slots - 1) calls.
+      The default (4 slots of 64k) holds any IPv4 datagram. */
+  void setReceiveSlots(size_t slots, size_t slot_size) {
+    ring_slots = slots ? slots : 1; ring_slot_size = (slot_size + 7) & ~(size_t)7; /* keep the slots aligned */
+    ring.clear(); ring_next = 0; last = PacketSlot();
+  }
+
+  /** receive up to n datagrams into the caller's slots, with a single
+      system call on linux (recvmmsg). Waits for the first datagram like
+      receiveNextPacket, then only takes what is already queued. Returns
+      the number of slots filled, 0 on timeout or failure.
+  */
+  size_t receiveBatch(PacketSlot *slots, size_t n, int timeout_ms = -1) {
+    if (!isOk() || handle == -1) { setErr("not opened.."); return 0; }
+    if (n == 0) return 0;
+#ifdef OSCPKT_HAVE_IO_URING
+    if (uring) {
+      size_t got = uring->receive(slots, n, timeout_ms);
+      if (got) remote_addr = slots[got-1].addr;
+      return got;
+    }
+#endif
+    /* try first without waiting, so a burst costs no select() */
+    size_t got = receiveAvailable(slots, n, timeout_ms < 0);
+    if (got == 0 && timeout_ms > 0 && isOk() && waitReadable(timeout_ms)) {
+      got = receiveAvailable(slots, n, false);
+    }
+    return got;
+  }
+
+  /** send n datagrams, with a single system call on linux (sendmmsg).
+      Returns the number of datagrams sent, they are sent in order so the
+      remaining ones start at slots[returned value]. */
+  size_t sendBatch(const PacketSlot *slots, size_t n) {
+    if (!isOk() || handle == -1) { setErr("not opened.."); return 0; }
+    size_t done = 0;
+#ifdef OSCPKT_HAVE_IO_URING
+    if (uring) return uring->send(slots, n, remote_addr, isBound());
+#endif
+#ifdef OSCPKT_HAVE_MMSG
+    struct mmsghdr msgs[BATCH_CHUNK];
+    struct iovec iovs[BATCH_CHUNK];
+    while (done < n) {
+      size_t cnt = std::min(n - done, (size_t)BATCH_CHUNK);
+      for (size_t i = 0; i < cnt; ++i) {
+        const PacketSlot &ps = slots[done + i];
+        const SockAddr &dest = ps.addr.empty() ? remote_addr : ps.addr;
+        iovs[i].iov_base = ps.data; iovs[i].iov_len = ps.size;
+        memset(&msgs[i], 0, sizeof msgs[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i]; msgs[i].msg_hdr.msg_iovlen = 1;
+        if (isBound()) {
+          msgs[i].msg_hdr.msg_name = (void*)&dest.addr();
+          msgs[i].msg_hdr.msg_namelen = dest.actualLen();
+        }
+      }
+      int res = sendmmsg(handle, msgs, (unsigned)cnt, 0);
+      if (res == -1 && errno == EINTR) continue;
+      if (res <= 0) break;
+      done += res;
+      if ((size_t)res < cnt) break;
+    }
+#else
+    for (; done < n; ++done) {
+      const PacketSlot &ps = slots[done];
+      SockAddr dest = ps.addr.empty() ? remote_addr : ps.addr;
+      if (!sendPacketTo(ps.data, ps.size, dest)) break;
+    }
+#endif
+    return done;
+  }
+
+  void *packetData() { return last.size ? last.data : 0; }
+  size_t packetSize() { return last.size; }
+  /** the last datagram did not fit in a receive slot, packetSize() is 0 */
+  bool packetTruncated() const { return last.truncated; }
   SockAddr &packetOrigin() { return remote_addr; }
   
 
@@ -302,6 +418,90 @@ struct UdpSocket {
   }
 
 private:
+  enum { BATCH_CHUNK = 64 }; /* datagrams per recvmmsg / sendmmsg call */
+
+  /* errors that only mean 'nothing to read right now' are not fatal */
+  void checkReceiveError() {
+    // maybe here we should differentiate EAGAIN/EINTR/EWOULDBLOCK from real errors
+#ifdef WIN32
+    if (WSAGetLastError() != WSAEINTR && WSAGetLastError() != WSAEWOULDBLOCK && 
+        WSAGetLastError() != WSAECONNRESET && WSAGetLastError() != WSAECONNREFUSED) {
+      char s[512]; _snprintf_s(s,512,512, "system error #%d", WSAGetLastError());
+      setErr(s);
+    }
+#else
+    if (errno != EAGAIN && errno != EINTR && errno != EWOULDBLOCK &&
+        errno != ECONNRESET && errno != ECONNREFUSED) {
+      setErr(strerror(errno));
+    }
+#endif
+    if (!isOk()) close();
+  }
+
+  bool waitReadable(int timeout_ms) {
+    struct timeval tv; memset(&tv, 0, sizeof tv);
+    tv.tv_sec=timeout_ms/1000;
+    tv.tv_usec=(timeout_ms%1000) * 1000;
+    fd_set readset;
+    FD_ZERO(&readset);
+    FD_SET(handle, &readset);
+    return select( handle+1, &readset, 0, 0, &tv ) > 0;
+  }
+
+  /* take the datagrams already queued on the socket, if block is set
+     wait for the first one */
+  size_t receiveAvailable(PacketSlot *slots, size_t n, bool block) {
+    size_t got = 0;
+#ifdef OSCPKT_HAVE_MMSG
+    struct mmsghdr msgs[BATCH_CHUNK];
+    struct iovec iovs[BATCH_CHUNK];
+    while (got < n) {
+      size_t cnt = std::min(n - got, (size_t)BATCH_CHUNK);
+      for (size_t i = 0; i < cnt; ++i) {
+        PacketSlot &ps = slots[got + i];
+        iovs[i].iov_base = ps.data; iovs[i].iov_len = ps.capacity;
+        memset(&msgs[i], 0, sizeof msgs[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i]; msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &ps.addr.addr();
+        msgs[i].msg_hdr.msg_namelen = ps.addr.maxLen();
+      }
+      int res = recvmmsg(handle, msgs, (unsigned)cnt, (block && got == 0) ? MSG_WAITFORONE : MSG_DONTWAIT, 0);
+      if (res == -1 && errno == EINTR) continue;
+      if (res <= 0) { if (res < 0 && got == 0) checkReceiveError(); break; }
+      for (int i = 0; i < res; ++i) {
+        PacketSlot &ps = slots[got + i];
+        ps.size = msgs[i].msg_len;
+        ps.truncated = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+      }
+      got += res;
+      if ((size_t)res < cnt) break; // the socket queue is empty
+    }
+    if (got) remote_addr = slots[got-1].addr;
+#else
+    for (; got < n; ++got) {
+      if ((got || !block) && !waitReadable(0)) break;
+      PacketSlot &ps = slots[got];
+#ifdef WIN32
+      socklen_t len = ps.addr.maxLen();
+      int nread = (int)recvfrom(handle, ps.data, (int)ps.capacity, 0, &ps.addr.addr(), &len);
+      ps.truncated = false;
+      if (nread < 0 && WSAGetLastError() == WSAEMSGSIZE) { nread = (int)ps.capacity; ps.truncated = true; }
+#else
+      struct iovec iov; iov.iov_base = ps.data; iov.iov_len = ps.capacity;
+      struct msghdr mh; memset(&mh, 0, sizeof mh);
+      mh.msg_name = &ps.addr.addr(); mh.msg_namelen = ps.addr.maxLen();
+      mh.msg_iov = &iov; mh.msg_iovlen = 1;
+      int nread = (int)recvmsg(handle, &mh, 0);
+      ps.truncated = (mh.msg_flags & MSG_TRUNC) != 0;
+#endif
+      if (nread < 0) { if (got == 0) checkReceiveError(); break; }
+      ps.size = nread;
+      remote_addr = ps.addr;
+    }
+#endif
+    return got;
+  }
+
   bool openSocket(const std::string &hostname, int port, int options) {
     char port_string[64]; 
 #ifdef WIN32
@@ -0,0 +1,341 @@
+/*
+  io_uring transport for oscpkt::UdpSocket (linux only), used when
+  UdpSocket::useIoUring() succeeds.
+
+  Receiving is one multishot recvmsg that stays armed on the socket,
+  the kernel picks a buffer from a provided buffer ring for every
+  datagram. As long as datagrams keep coming, reading them is just a
+  look at the completion queue: no system call at all. Sending queues
+  one sendmsg per datagram and submits the whole batch with a single
+  io_uring_enter.
+
+  Talks to the kernel directly (no liburing), needs linux 6.0 for the
+  multishot recvmsg. When anything is missing open() fails and the
+  socket stays on the plain BSD path.
+*/
+
+#ifndef OSCPKT_URING_HH
+#define OSCPKT_URING_HH
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <signal.h>
+#include <unistd.h>
+
+namespace oscpkt {
+
+class UringIo {
+public:
+  UringIo() : fd(-1), sock(-1), enters(0), pending_sqes(0), rearm(false), stash_pos(0), send_left(0) {
+    sq_ptr = cq_ptr = 0; sqes = 0; buf_ring = 0; bufs = 0;
+    sq_size = cq_size = buf_ring_size = bufs_size = 0;
+  }
+  ~UringIo() { close(); }
+
+  /** number of io_uring_enter calls so far, for the benchmarks */
+  unsigned long enterCount() const { return enters; }
+  /** the ring fd, readable when there are completions waiting (for epoll) */
+  int handle() const { return fd; }
+  const std::string &errorMessage() const { return error_message; }
+
+  /** attach to a bound udp socket. nbufs receive buffers of buf_size
+      bytes are handed to the kernel, datagrams larger than buf_size
+      minus a small header come out truncated. */
+  bool open(int sock_fd, unsigned nbufs = 256, unsigned buf_size = 4096) {
+    close(); error_message.clear(); errno = 0;
+    sock = sock_fd;
+    unsigned n = 1; while (n < nbufs) n <<= 1;
+    nbufs = n > 32768 ? 32768 : n;
+    buf_count = nbufs; buf_len = buf_size;
+
+    struct io_uring_params p; memset(&p, 0, sizeof p);
+    p.flags = IORING_SETUP_CQSIZE;
+    /* a completion per buffer, plus the sends. the kernel refuses fewer
+       cq entries than sq entries, and a full sq of sends has to fit
+       next to the receives, so never less than twice SQ_ENTRIES */
+    p.cq_entries = nbufs * 2 > 2 * SQ_ENTRIES ? nbufs * 2 : 2 * SQ_ENTRIES;
+    fd = (int)syscall(__NR_io_uring_setup, SQ_ENTRIES, &p);
+    if (fd < 0) { fd = -1; return fail("io_uring_setup"); }
+    if (!(p.features & IORING_FEAT_EXT_ARG) || !(p.features & IORING_FEAT_NODROP)) return fail("io_uring too old");
+
+    sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) sq_size = cq_size = (sq_size > cq_size ? sq_size : cq_size);
+    sq_ptr = map(sq_size, IORING_OFF_SQ_RING);
+    if (!sq_ptr) return fail("mmap sq");
+    if (single) cq_ptr = sq_ptr;
+    else if (!(cq_ptr = map(cq_size, IORING_OFF_CQ_RING))) return fail("mmap cq");
+    sqes = (struct io_uring_sqe *)map(p.sq_entries * sizeof(struct io_uring_sqe), IORING_OFF_SQES);
+    if (!sqes) return fail("mmap sqes");
+    sqe_count = p.sq_entries;
+
+    sq_head = (unsigned *)(sq_ptr + p.sq_off.head);
+    sq_tail = (unsigned *)(sq_ptr + p.sq_off.tail);
+    sq_mask = *(unsigned *)(sq_ptr + p.sq_off.ring_mask);
+    sq_array = (unsigned *)(sq_ptr + p.sq_off.array);
+    cq_head = (unsigned *)(cq_ptr + p.cq_off.head);
+    cq_tail = (unsigned *)(cq_ptr + p.cq_off.tail);
+    cq_mask = *(unsigned *)(cq_ptr + p.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe *)(cq_ptr + p.cq_off.cqes);
+    sq_local = *sq_tail;
+
+    /* the provided buffer ring, and the buffers themselves */
+    buf_ring_size = nbufs * sizeof(struct io_uring_buf);
+    bufs_size = (size_t)nbufs * buf_len;
+    buf_ring = (struct io_uring_buf_ring *)anon(buf_ring_size);
+    bufs = (char *)anon(bufs_size);
+    if (!buf_ring || !bufs) return fail("mmap buffers");
+    struct io_uring_buf_reg reg; memset(&reg, 0, sizeof reg);
+    reg.ring_addr = (unsigned long)buf_ring; reg.ring_entries = nbufs; reg.bgid = BGID;
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) return fail("register buffer ring");
+    br_tail = 0;
+    for (unsigned i = 0; i < nbufs; ++i) recycle(i);
+    publishBuffers();
+
+    /* what the kernel writes in front of each datagram */
+    memset(&recv_tmpl, 0, sizeof recv_tmpl);
+    recv_tmpl.msg_namelen = sizeof(struct sockaddr_storage);
+    stash.reserve(nbufs);
+    stash_pos = 0;
+
+    /* arm the receive, an old kernel refuses it right away */
+    armReceive();
+    if (enter(pending_sqes, 0, 0, -1) < 0) return fail("io_uring_enter");
+    reap(0, 0);
+    if (!error_message.empty() || rearm) return fail("multishot recvmsg not supported");
+    return true;
+  }
+
+  void close() {
+    if (fd != -1) ::close(fd); /* cancels the pending receive */
+    if (sqes) munmap(sqes, sqe_count * sizeof(struct io_uring_sqe));
+    if (cq_ptr && cq_ptr != sq_ptr) munmap(cq_ptr, cq_size);
+    if (sq_ptr) munmap(sq_ptr, sq_size);
+    if (buf_ring) munmap(buf_ring, buf_ring_size);
+    if (bufs) munmap(bufs, bufs_size);
+    fd = -1; sq_ptr = cq_ptr = 0; sqes = 0; buf_ring = 0; bufs = 0;
+    pending_sqes = 0; rearm = false;
+    stash.clear(); stash_pos = 0;
+  }
+
+  /** same contract as UdpSocket::receiveBatch */
+  size_t receive(PacketSlot *slots, size_t n, int timeout_ms) {
+    size_t got = deliver(slots, n);
+    if (got == 0 && timeout_ms != 0 && error_message.empty()) {
+      if (enter(pending_sqes, 1, IORING_ENTER_GETEVENTS, timeout_ms) >= 0 || errno == ETIME || errno == EINTR) {
+        got = deliver(slots, n);
+      }
+    }
+    if (rearm || pending_sqes) { /* only after ENOBUFS, or a cancelled receive */
+      if (rearm) armReceive();
+      enter(pending_sqes, 0, 0, -1);
+    }
+    return got;
+  }
+
+  /** same contract as UdpSocket::sendBatch. Waits for the completions,
+      so the caller's buffers are free again on return. */
+  size_t send(const PacketSlot *slots, size_t n, const SockAddr &default_addr, bool with_addr) {
+    size_t done = 0;
+    while (done < n) {
+      size_t cnt = n - done;
+      if (cnt > SEND_MAX) cnt = SEND_MAX;
+      for (size_t i = 0; i < cnt; ++i) {
+        const PacketSlot &ps = slots[done + i];
+        const SockAddr &dest = ps.addr.empty() ? default_addr : ps.addr;
+        send_iov[i].iov_base = ps.data; send_iov[i].iov_len = ps.size;
+        memset(&send_msg[i], 0, sizeof send_msg[i]);
+        send_msg[i].msg_iov = &send_iov[i]; send_msg[i].msg_iovlen = 1;
+        if (with_addr) {
+          send_msg[i].msg_name = (void *)&dest.addr();
+          send_msg[i].msg_namelen = dest.actualLen();
+        }
+        struct io_uring_sqe *sqe = nextSqe();
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = sock;
+        sqe->addr = (unsigned long)&send_msg[i];
+        sqe->len = 1;
+        sqe->user_data = i;
+        send_res[i] = 1; /* not completed yet */
+      }
+      send_left = cnt;
+      int res = enter(pending_sqes, (unsigned)cnt, IORING_ENTER_GETEVENTS, -1);
+      while (res >= 0 || errno == EINTR) {
+        reap(0, 0);
+        if (send_left == 0) break;
+        res = enter(0, 1, IORING_ENTER_GETEVENTS, -1);
+      }
+      if (send_left) return done; /* the ring is broken, should not happen */
+      size_t ok = 0;
+      while (ok < cnt && send_res[ok] >= 0) ++ok;
+      done += ok;
+      if (ok < cnt) break;
+    }
+    return done;
+  }
+
+private:
+  enum { SQ_ENTRIES = 128, SEND_MAX = 64, BGID = 7 };
+  static const unsigned long long RECV_TAG = ~0ULL;
+
+  struct Stashed { unsigned bid; int res; };
+
+  bool fail(const char *what) {
+    if (error_message.empty()) {
+      error_message = what;
+      if (errno) { error_message += ": "; error_message += strerror(errno); }
+    }
+    close();
+    return false;
+  }
+
+  char *map(size_t sz, unsigned long long off) {
+    void *p = mmap(0, sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, off);
+    return p == MAP_FAILED ? 0 : (char *)p;
+  }
+  static void *anon(size_t sz) {
+    void *p = mmap(0, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? 0 : p;
+  }
+
+  struct io_uring_sqe *nextSqe() {
+    unsigned idx = sq_local & sq_mask;
+    struct io_uring_sqe *sqe = &sqes[idx];
+    memset(sqe, 0, sizeof *sqe);
+    sq_array[idx] = idx;
+    ++sq_local; ++pending_sqes;
+    __atomic_store_n(sq_tail, sq_local, __ATOMIC_RELEASE);
+    return sqe;
+  }
+
+  void armReceive() {
+    struct io_uring_sqe *sqe = nextSqe();
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = sock;
+    sqe->addr = (unsigned long)&recv_tmpl;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BGID;
+    sqe->user_data = RECV_TAG;
+    rearm = false;
+  }
+
+  int enter(unsigned to_submit, unsigned min_complete, unsigned flags, int timeout_ms) {
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg; memset(&arg, 0, sizeof arg);
+    void *argp = 0; size_t argsz = 0;
+    if (timeout_ms >= 0 && min_complete) {
+      ts.tv_sec = timeout_ms / 1000; ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+      arg.sigmask_sz = _NSIG / 8; arg.ts = (unsigned long)&ts;
+      argp = &arg; argsz = sizeof arg; flags |= IORING_ENTER_EXT_ARG;
+    }
+    ++enters;
+    int res = (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, argp, argsz);
+    if (res > 0) pending_sqes -= ((unsigned)res < pending_sqes ? (unsigned)res : pending_sqes);
+    return res;
+  }
+
+  void recycle(unsigned bid) {
+    /* not buf_ring->bufs: in C++ the empty struct in front of that flexible
+       array takes a byte, which moves it away from where the kernel reads */
+    struct io_uring_buf *b = (struct io_uring_buf *)buf_ring + (br_tail & (buf_count - 1));
+    b->addr = (unsigned long)(bufs + (size_t)bid * buf_len);
+    b->len = buf_len;
+    b->bid = (unsigned short)bid;
+    ++br_tail;
+  }
+  void publishBuffers() { __atomic_store_n(&buf_ring->tail, br_tail, __ATOMIC_RELEASE); }
+
+  /* walk the completion queue: sends are accounted for, received
+     datagrams are copied into the slots (up to n) or stashed */
+  size_t reap(PacketSlot *slots, size_t n) {
+    size_t got = 0;
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    bool recycled = false;
+    for (; head != tail; ++head) {
+      struct io_uring_cqe *cqe = &cqes[head & cq_mask];
+      if (cqe->user_data != RECV_TAG) {
+        if (cqe->user_data < SEND_MAX) { send_res[cqe->user_data] = cqe->res; if (send_left) --send_left; }
+        continue;
+      }
+      if (!(cqe->flags & IORING_CQE_F_MORE)) rearm = true;
+      if (cqe->res < 0) {
+        if (cqe->res != -ENOBUFS && cqe->res != -ECANCELED) { errno = -cqe->res; setErrno("recvmsg"); }
+        continue;
+      }
+      if (!(cqe->flags & IORING_CQE_F_BUFFER)) continue;
+      Stashed st; st.bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT; st.res = cqe->res;
+      if (got < n) { copyOut(st, slots[got++]); recycled = true; }
+      else stash.push_back(st);
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    if (recycled) publishBuffers();
+    return got;
+  }
+
+  size_t deliver(PacketSlot *slots, size_t n) {
+    size_t got = 0;
+    while (got < n && stash_pos < stash.size()) copyOut(stash[stash_pos++], slots[got++]);
+    if (stash_pos) { stash.erase(stash.begin(), stash.begin() + stash_pos); stash_pos = 0; }
+    if (got) publishBuffers();
+    if (got < n) got += reap(slots + got, n - got);
+    return got;
+  }
+
+  void copyOut(const Stashed &st, PacketSlot &ps) {
+    const char *buf = bufs + (size_t)st.bid * buf_len;
+    const struct io_uring_recvmsg_out *out = (const struct io_uring_recvmsg_out *)buf;
+    const char *name = buf + sizeof *out;
+    const char *payload = name + recv_tmpl.msg_namelen + recv_tmpl.msg_controllen;
+    size_t avail = st.res - (payload - buf); /* what actually landed in the buffer */
+    size_t sz = out->payloadlen < avail ? out->payloadlen : avail;
+    ps.truncated = (out->flags & MSG_TRUNC) != 0;
+    if (sz > ps.capacity) { sz = ps.capacity; ps.truncated = true; }
+    memcpy(ps.data, payload, sz);
+    ps.size = sz;
+    size_t nl = out->namelen < ps.addr.maxLen() ? out->namelen : ps.addr.maxLen();
+    memcpy(&ps.addr.addr(), name, nl);
+    recycle(st.bid);
+  }
+
+  void setErrno(const char *what) {
+    if (error_message.empty()) { error_message = what; error_message += ": "; error_message += strerror(errno); }
+  }
+
+  int fd, sock;
+  unsigned long enters;
+  std::string error_message;
+
+  char *sq_ptr, *cq_ptr;
+  size_t sq_size, cq_size;
+  struct io_uring_sqe *sqes;
+  unsigned sqe_count;
+  unsigned *sq_head, *sq_tail, *sq_array, sq_mask, sq_local;
+  unsigned *cq_head, *cq_tail, cq_mask;
+  struct io_uring_cqe *cqes;
+  unsigned pending_sqes;
+  bool rearm;
+
+  struct io_uring_buf_ring *buf_ring;
+  char *bufs;
+  size_t buf_ring_size, bufs_size;
+  unsigned buf_count, buf_len;
+  unsigned short br_tail;
+
+  struct msghdr recv_tmpl;
+  std::vector<Stashed> stash;
+  size_t stash_pos;
+
+  struct msghdr send_msg[SEND_MAX];
+  struct iovec send_iov[SEND_MAX];
+  int send_res[SEND_MAX];
+  size_t send_left;
+};
+
+} // namespace oscpkt
+
+#endif // OSCPKT_URING_HH
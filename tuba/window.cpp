@@ -0,0 +1,232 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#include "window.h"
+
+// ====================================================================
+//
+// ====================================================================
+RequestWindow::RequestWindow(size_t window, size_t capacity, int timeoutMs, int retries)
+:  mTimeout(timeoutMs),
+   mQueue(capacity)
+{
+   mWindow = window ? window : 1;
+   mRetries = retries;
+   mCompleted = 0;
+   mResends = 0;
+   mTimeouts = 0;
+}
+
+// ====================================================================
+//
+// ====================================================================
+RequestWindow::~RequestWindow()
+{
+}
+
+// ====================================================================
+//
+// ====================================================================
+void RequestWindow::SetSender(Sender sender)
+{
+   mSender = sender;
+}
+
+// ====================================================================
+// Takes effect as requests complete, nothing in flight is recalled
+// ====================================================================
+void RequestWindow::SetWindow(size_t window)
+{
+   mWindow = window ? window : 1;
+   Pump(Clock::now());
+}
+
+// ====================================================================
+//
+// ====================================================================
+void RequestWindow::SetTimeout(int timeoutMs)
+{
+   mTimeout = std::chrono::milliseconds(timeoutMs);
+}
+
+// ====================================================================
+// 0 gives up on the first timeout
+// ====================================================================
+void RequestWindow::SetRetries(int retries)
+{
+   mRetries = retries;
+}
+
+// ====================================================================
+// Most of what we set is echoed at its own address
+// ====================================================================
+bool RequestWindow::Send(const oscpkt::Message & msg)
+{
+   return Send(msg, msg.addressPattern());
+}
+
+// ====================================================================
+//
+// ====================================================================
+bool RequestWindow::Send(const oscpkt::Message & msg, const std::string & echo)
+{
+   oscpkt::PacketWriter *pw = mQueue.push();
+   if (pw == NULL)
+   {
+      return false;
+   }
+
+   pw->addMessage(msg);
+   mEchoes.push_back(echo);
+
+   Pump(Clock::now());
+
+   return true;
+}
+
+// ====================================================================
+// The oldest request waiting for that address, earlier ones waiting for
+// something else stay in flight
+// ====================================================================
+bool RequestWindow::OnEcho(const char *address)
+{
+   for (size_t i = 0; i < mInFlight.size(); i++)
+   {
+      if (mInFlight[i].echo == address)
+      {
+         mInFlight.erase(mInFlight.begin() + i);
+         mCompleted++;
+         Pump(Clock::now());
+         return true;
+      }
+   }
+
+   return false;
+}
+
+// ====================================================================
+// Once per frame
+// ====================================================================
+void RequestWindow::Tick(Clock::time_point now)
+{
+   // In the order they were sent, which the echoes are matched in, so
+   // the resent ones stay where they are
+   for (size_t i = 0; i < mInFlight.size(); )
+   {
+      InFlight & f = mInFlight[i];
+      if (f.deadline > now)
+      {
+         i++;
+         continue;
+      }
+
+      if (f.tries >= mRetries)
+      {
+         mInFlight.erase(mInFlight.begin() + i);
+         mTimeouts++;
+         continue;
+      }
+
+      // A failed send counts as a try, the socket may be gone for good
+      f.tries++;
+      if (mSender)
+      {
+         mSender(&f.data[0], f.data.size());
+      }
+      mResends++;
+
+      f.deadline = now + mTimeout * (1 << f.tries);
+      i++;
+   }
+
+   Pump(now);
+}
+
+// ====================================================================
+//
+// ====================================================================
+bool RequestWindow::IsIdle()
+{
+   return mQueue.empty() && mInFlight.empty();
+}
+
+// ====================================================================
+//
+// ====================================================================
+size_t RequestWindow::GetWindow()
+{
+   return mWindow;
+}
+
+// ====================================================================
+//
+// ====================================================================
+size_t RequestWindow::GetInFlight()
+{
+   return mInFlight.size();
+}
+
+// ====================================================================
+//
+// ====================================================================
+size_t RequestWindow::GetQueued()
+{
+   return mQueue.size();
+}
+
+// ====================================================================
+// Requests answered by their echo
+// ====================================================================
+unsigned long RequestWindow::GetCompleted()
+{
+   return mCompleted;
+}
+
+// ====================================================================
+// Requests sent again after a timeout
+// ====================================================================
+unsigned long RequestWindow::GetResends()
+{
+   return mResends;
+}
+
+// ====================================================================
+// Requests given up on
+// ====================================================================
+unsigned long RequestWindow::GetTimeouts()
+{
+   return mTimeouts;
+}
+
+// ====================================================================
+// Fill the window from the queue
+// ====================================================================
+void RequestWindow::Pump(Clock::time_point now)
+{
+   while (mInFlight.size() < mWindow && !mQueue.empty() && mSender)
+   {
+      oscpkt::PacketWriter *pw = mQueue.front();
+      if (!mSender(pw->packetData(), pw->packetSize()))
+      {
+         // Try again next tick
+         break;
+      }
+
+      InFlight f;
+      f.echo = mEchoes.front();
+      f.deadline = now + mTimeout;
+      f.data.assign(pw->packetData(), pw->packetData() + pw->packetSize());
+      f.tries = 0;
+      mInFlight.push_back(f);
+
+      mQueue.pop();
+      mEchoes.pop_front();
+   }
+}
@@ -0,0 +1,103 @@
+/* ====================================================================
+||
+|| Tuba - Totalmix UBA (ugly, but accessible)
+||
+|| Written by:  Leland Lucius (tuba@homerow.net>
+||
+|| Copyright:   GPL v3
+||
+==================================================================== */
+
+#if !defined(WINDOW_H)
+#define WINDOW_H
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "oscpkt.h"
+
+// ====================================================================
+// Requests to the mixer that wait for their answer, with up to a
+// window of them in flight at once.
+//
+// The mixer has no request ids.  What it does have is the echo: a bus
+// selection is answered with the bus address (and the names of its
+// strips), a control with its own address and new value.  Each request
+// says which address answers it, and an echo completes the oldest
+// request in flight waiting for that address.  Anything else that comes
+// in (meters, the other page) is no answer to anything.
+//
+// A window of 1 is the old stop-and-wait.  Requests whose echo does not
+// come within the timeout are sent again, a few times, the timeout
+// doubling each time, and then given up on, so a lost datagram neither
+// loses the request nor stalls the ones behind it for long.
+// ====================================================================
+class RequestWindow
+{
+public:
+   typedef std::chrono::steady_clock Clock;
+
+   // Puts a packet on the wire, false when it could not
+   typedef std::function<bool (const void *data, size_t size)> Sender;
+
+   RequestWindow(size_t window = 1, size_t capacity = 64, int timeoutMs = 250, int retries = 3);
+   virtual ~RequestWindow();
+
+   void SetSender(Sender sender);
+   void SetWindow(size_t window);
+   void SetTimeout(int timeoutMs);
+   void SetRetries(int retries);
+
+   // Queue msg, answered by the echo of its own address or of echo.
+   // False (and dropped) when the queue is full.
+   bool Send(const oscpkt::Message & msg);
+   bool Send(const oscpkt::Message & msg, const std::string & echo);
+
+   // An address the mixer sent, true when it answered a request
+   bool OnEcho(const char *address);
+
+   // Send again or give up on requests past their timeout, send more if
+   // there is room
+   void Tick(Clock::time_point now = Clock::now());
+
+   // Nothing waiting and nothing in flight
+   bool IsIdle();
+
+   size_t GetWindow();
+   size_t GetInFlight();
+   size_t GetQueued();
+
+   unsigned long GetCompleted();
+   unsigned long GetResends();
+   unsigned long GetTimeouts();
+
+private:
+   struct InFlight
+   {
+      std::string echo;
+      Clock::time_point deadline;
+      std::vector<char> data;    // to send it again
+      int tries;                 // resends so far
+   };
+
+   void Pump(Clock::time_point now);
+
+private:
+   Sender mSender;
+   size_t mWindow;
+   std::chrono::milliseconds mTimeout;
+   int mRetries;
+
+   oscpkt::PacketQueue mQueue;        // waiting to go out
+   std::deque<std::string> mEchoes;   // of the ones in mQueue, in order
+   std::deque<InFlight> mInFlight;    // oldest first
+
+   unsigned long mCompleted;
+   unsigned long mResends;
+   unsigned long mTimeouts;
+};
+
+#endif